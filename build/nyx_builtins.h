@@ -0,0 +1,219 @@
+/* Generated by `nyx --emit-builtin-snapshot` (NYX_LANG_VERSION 0.6.13); do not edit. */
+
+static const uint64_t k_builtin_image_nymath[] = {
+    0x000000014358594eULL, 0x0000019801020304ULL, 0x000000000000014fULL, 0x5873422c93321fa8ULL,
+    0x0000000000000399ULL, 0x10dda564522fee8eULL, 0x000033312e362e30ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000c00000001ULL, 0x0000000100000001ULL,
+    0x0000000c00000000ULL, 0x000000020000000fULL, 0x0000000700000005ULL, 0x0000001500000001ULL,
+    0x0000000500000002ULL, 0x0000000900000003ULL, 0x000000030000000bULL, 0x000000040000000fULL,
+    0x0000000d00000003ULL, 0x0000002800000017ULL, 0x0000000300000000ULL, 0x0000000000000011ULL,
+    0x0000000100000000ULL, 0x0000000300000010ULL, 0x0000000a00000016ULL, 0x0000001d00000003ULL,
+    0x000000040000001eULL, 0x0000001e00000003ULL, 0x0000000000000019ULL, 0x00000010ffffffffULL,
+    0x0000000900000004ULL, 0x0000000400000004ULL, 0x0000001b00000010ULL, 0x0000000f00000000ULL,
+    0x0000000500000006ULL, 0x000000020000001dULL, 0x0000002d0000002bULL, 0x0000000500000002ULL,
+    0x0000000900000007ULL, 0x000000070000000bULL, 0x000000040000000fULL, 0x0000000d00000007ULL,
+    0x000000280000002fULL, 0x0000000700000004ULL, 0x0000003100000011ULL, 0x0000001000000001ULL,
+    0x0000001600000007ULL, 0x0000000700000004ULL, 0x000000330000001dULL, 0xffffffff00000000ULL,
+    0x0000000800000010ULL, 0x0000000400000009ULL, 0x0000001000000008ULL, 0x0000000000000035ULL,
+    0x0000000a0000000fULL, 0x0000003700000005ULL, 0x0000004500000002ULL, 0x0000000200000047ULL,
+    0x0000000b00000005ULL, 0x0000000b00000009ULL, 0x0000000f0000000bULL, 0x0000000b00000004ULL,
+    0x000000490000000dULL, 0x0000000400000029ULL, 0x000000110000000bULL, 0x000000010000004bULL,
+    0x0000000b00000010ULL, 0x0000000400000016ULL, 0x0000001d0000000bULL, 0x000000000000004dULL,
+    0x00000010ffffffffULL, 0x000000090000000cULL, 0x0000000c00000004ULL, 0x0000004f00000010ULL,
+    0x0000000f00000000ULL, 0x000000050000000eULL, 0x0000000300000051ULL, 0x0000006300000061ULL,
+    0x0000000300000066ULL, 0x0000000f00000005ULL, 0x0000000b00000009ULL, 0x0000000f0000000fULL,
+    0x0000000f00000004ULL, 0x000000690000000dULL, 0x0000000400000028ULL, 0x000000110000000fULL,
+    0x000000010000006bULL, 0x0000000f00000010ULL, 0x0000000400000017ULL, 0x0000001e0000000fULL,
+    0x000000000000006eULL, 0x00000005ffffffffULL, 0x0000000900000010ULL, 0x000000100000000bULL,
+    0x000000040000000fULL, 0x0000000d00000010ULL, 0x0000002900000071ULL, 0x0000001000000004ULL,
+    0x0000007300000011ULL, 0x0000001000000001ULL, 0x0000001700000010ULL, 0x0000001000000004ULL,
+    0x000000760000001eULL, 0xffffffff00000000ULL, 0x0000001100000010ULL, 0x0000000400000009ULL,
+    0x0000001000000011ULL, 0x0000000000000079ULL, 0x000000130000000fULL, 0x0000007b00000005ULL,
+    0x0000008900000002ULL, 0x000000050000008eULL, 0x0000001400000005ULL, 0x0000000b00000009ULL,
+    0x0000001100000014ULL, 0x0000001400000004ULL, 0x000000920000000dULL, 0x0000000000000028ULL,
+    0x0000001300000014ULL, 0x0000000000000000ULL, 0x0000001000000001ULL, 0x0000001800000014ULL,
+    0x0000001400000000ULL, 0x000000000000001fULL, 0x0000000000000000ULL, 0x00000000ffffffffULL,
+    0x0000000900000015ULL, 0x0000000000000096ULL, 0x0000001300000015ULL, 0x0000000000000001ULL,
+    0x0000001600000000ULL, 0x0000009a00000009ULL, 0x0000001600000000ULL, 0x0000000000000011ULL,
+    0x0000000700000000ULL, 0x0000000900000017ULL, 0x000000170000000bULL, 0x0000000400000012ULL,
+    0x0000001000000017ULL, 0x000000280000009cULL, 0x0000001700000004ULL, 0x0000009e00000014ULL,
+    0x0000000100000002ULL, 0x0000000d00000018ULL, 0x0000000b000000a2ULL, 0x0000001700000018ULL,
+    0x0000001800000004ULL, 0x000000a600000013ULL, 0x000000040000001fULL, 0x0000001900000018ULL,
+    0x00000001000000aaULL, 0x0000000d00000019ULL, 0x0000000b000000afULL, 0x0000001300000019ULL,
+    0x0000001900000004ULL, 0x000000b100000011ULL, 0x000000000000001dULL, 0x0000001500000019ULL,
+    0x0000000000000001ULL, 0x0000001b00000010ULL, 0x0000000400000009ULL, 0x000000100000001bULL,
+    0x00000000000000b3ULL, 0x0000001d0000000fULL, 0x000000b700000005ULL, 0x000000c500000001ULL,
+    0x0000000000000003ULL, 0x000000090000001eULL, 0x00000000000000c8ULL, 0x000000130000001eULL,
+    0x0000000000000000ULL, 0x0000001f00000008ULL, 0x000000cc00000009ULL, 0x00000004ffffffffULL,
+    0x000000130000001fULL, 0x00000001000000ceULL, 0x0000001f00000001ULL, 0x000000d100000019ULL,
+    0x0000001f0000000bULL, 0x0000000400000023ULL, 0x0000001f0000001fULL, 0x0000001d000000d5ULL,
+    0x0000001f00000004ULL, 0x000000d900000025ULL, 0x0000002000000010ULL, 0x0000000400000009ULL,
+    0x0000001000000020ULL, 0x00000000000000dbULL, 0x0000002200000000ULL, 0x000000df00000005ULL,
+    0x0000002200000004ULL, 0x000000e30000000fULL, 0x0000002300000000ULL, 0x000000f100000005ULL,
+    0x0000002300000004ULL, 0x000000f50000000fULL, 0x0000002400000000ULL, 0x0000010300000005ULL,
+    0x0000002400000004ULL, 0x000001070000000fULL, 0x0000002500000000ULL, 0x0000011500000005ULL,
+    0x0000002500000004ULL, 0x0000011b00000011ULL, 0x0000002600000000ULL, 0x0000012b00000005ULL,
+    0x0000002600000004ULL, 0x0000012f0000000fULL, 0x0000002700000000ULL, 0x0000013d00000005ULL,
+    0x0000002700000004ULL, 0x000001410000000fULL, 0x5f006874616d796eULL, 0x6874616d5f796e5fULL,
+    0x780078007362615fULL, 0x6e5f5f0078007800ULL, 0x6d5f6874616d5f79ULL, 0x6100620061006e69ULL,
+    0x5f00620061006200ULL, 0x6874616d5f796e5fULL, 0x6200610078616d5fULL, 0x6200610062006100ULL,
+    0x616d5f796e5f5f00ULL, 0x706d616c635f6874ULL, 0x6968006f6c007800ULL, 0x6f6c006f6c007800ULL,
+    0x6968006968007800ULL, 0x5f796e5f5f007800ULL, 0x776f705f6874616dULL, 0x7865006573616200ULL,
+    0x6361007078650070ULL, 0x7865006900690063ULL, 0x6361006363610070ULL, 0x6900657361620063ULL,
+    0x5f00636361006900ULL, 0x6874616d5f796e5fULL, 0x007378006d75735fULL, 0x7378007800636361ULL,
+    0x6363610063636100ULL, 0x6100636361007800ULL, 0x5f796e5f5f007362ULL, 0x7362615f6874616dULL,
+    0x6e5f5f006e696d00ULL, 0x6d5f6874616d5f79ULL, 0x5f0078616d006e69ULL, 0x6874616d5f796e5fULL,
+    0x616c630078616d5fULL, 0x5f796e5f5f00706dULL, 0x616c635f6874616dULL, 0x5f00776f7000706dULL,
+    0x6874616d5f796e5fULL, 0x6d757300776f705fULL, 0x616d5f796e5f5f00ULL, 0x00006d75735f6874ULL,
+};
+
+static const uint64_t k_builtin_image_nyarrays[] = {
+    0x000000014358594eULL, 0x000000f901020304ULL, 0x00000000000000fdULL, 0x95a0501fd7818b29ULL,
+    0x000000000000023dULL, 0x6c18fdb210bf4784ULL, 0x000033312e362e30ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000c00000001ULL, 0x0000000100000001ULL,
+    0x0000000800000000ULL, 0x000000020000000fULL, 0x0000000900000005ULL, 0x0000001b00000001ULL,
+    0x0000000500000002ULL, 0x0000000900000003ULL, 0x000000030000000bULL, 0x0000000c00000015ULL,
+    0x0000001000000003ULL, 0x0000000300000004ULL, 0x0000001e0000000dULL, 0x0000000400000001ULL,
+    0x0000001100000003ULL, 0x0000002600000022ULL, 0x0000000300000000ULL, 0x0000000000000018ULL,
+    0x0000000100000000ULL, 0x0000000300000010ULL, 0x000000030000001dULL, 0x0000002400000003ULL,
+    0xffffffff00000000ULL, 0x0000000400000010ULL, 0x0000000800000009ULL, 0x0000001200000004ULL,
+    0x0000000400000004ULL, 0x0000002500000010ULL, 0x0000000400000000ULL, 0x0000000000000013ULL,
+    0x0000000000000000ULL, 0x000000060000000fULL, 0x0000002800000005ULL, 0x0000003900000001ULL,
+    0x0000000500000002ULL, 0x0000000900000007ULL, 0x000000070000000bULL, 0x0000000c00000015ULL,
+    0x0000001000000007ULL, 0x0000000700000004ULL, 0x0000003c0000000dULL, 0x0000000400000001ULL,
+    0x0000001100000007ULL, 0x0000002600000040ULL, 0x0000000700000000ULL, 0x0000000000000018ULL,
+    0x0000000100000000ULL, 0x0000000700000010ULL, 0x000000030000001dULL, 0x0000002400000007ULL,
+    0xffffffff00000000ULL, 0x0000000800000010ULL, 0x0000000800000009ULL, 0x0000001200000008ULL,
+    0x0000000800000004ULL, 0x0000004300000010ULL, 0x000000080000000bULL, 0x0000000c0000001bULL,
+    0x0000001600000008ULL, 0x0000000800000004ULL, 0x0000004600000013ULL, 0x0000000400000001ULL,
+    0x0000001700000008ULL, 0x0000001e0000004aULL, 0x0000000800000000ULL, 0x000000010000001dULL,
+    0x0000000000000000ULL, 0x0000000a0000000fULL, 0x0000004d00000005ULL, 0x0000005d00000001ULL,
+    0x0000000000000003ULL, 0x000000090000000bULL, 0x0000000000000060ULL, 0x000000130000000bULL,
+    0x0000000000000000ULL, 0x0000000c00000008ULL, 0x0000006400000009ULL, 0x00000004ffffffffULL,
+    0x000000130000000cULL, 0x0000000100000066ULL, 0x0000000c00000001ULL, 0x0000006900000019ULL,
+    0x0000000c0000000bULL, 0x0000000400000023ULL, 0x0000001f0000000cULL, 0x0000001d0000006dULL,
+    0x0000000c00000004ULL, 0x0000007100000025ULL, 0x0000000d00000010ULL, 0x0000000400000009ULL,
+    0x000000100000000dULL, 0x0000000000000073ULL, 0x0000000f0000000fULL, 0x0000007700000005ULL,
+    0x0000008d00000001ULL, 0x0000001000000001ULL, 0x0000000900000010ULL, 0x0000001000000006ULL,
+    0x0000000500000010ULL, 0x0000001100000010ULL, 0x0000000400000002ULL, 0x0000001200000010ULL,
+    0x0000000400000090ULL, 0x0000001500000010ULL, 0x0000009400000092ULL, 0x0000000400000096ULL,
+    0x0000002400000010ULL, 0xffffffff00000098ULL, 0x0000000000000000ULL, 0x0000000500000012ULL,
+    0x000000040000009bULL, 0x0000001100000012ULL, 0x00000000000000a1ULL, 0x0000000500000013ULL,
+    0x00000004000000b3ULL, 0x0000001000000013ULL, 0x00000000000000b8ULL, 0x0000000500000014ULL,
+    0x00000004000000c9ULL, 0x0000000f00000014ULL, 0x00000000000000cdULL, 0x0000000500000015ULL,
+    0x00000004000000ddULL, 0x0000001500000015ULL, 0x7261796e000000e7ULL, 0x6e5f5f0073796172ULL,
+    0x7379617272615f79ULL, 0x780074737269665fULL, 0x7378006e656c0073ULL, 0x796e5f5f00737800ULL,
+    0x5f7379617272615fULL, 0x007378007473616cULL, 0x78007378006e656cULL, 0x7378006e656c0073ULL,
+    0x72615f796e5f5f00ULL, 0x6d75735f73796172ULL, 0x0063636100737800ULL, 0x6363610073780078ULL,
+    0x6100780063636100ULL, 0x5f796e5f5f006363ULL, 0x655f737961727261ULL, 0x65746172656d756eULL,
+    0x0078006900737800ULL, 0x6600737800780069ULL, 0x6e5f5f0074737269ULL, 0x7379617272615f79ULL,
+    0x6c0074737269665fULL, 0x796e5f5f00747361ULL, 0x5f7379617272615fULL, 0x6d7573007473616cULL,
+    0x72615f796e5f5f00ULL, 0x6d75735f73796172ULL, 0x6172656d756e6500ULL, 0x5f796e5f5f006574ULL,
+    0x655f737961727261ULL, 0x65746172656d756eULL, 0x0000000000000000ULL,
+};
+
+static const uint64_t k_builtin_image_nyobjects[] = {
+    0x000000014358594eULL, 0x000000ae01020304ULL, 0x00000000000000e7ULL, 0xe7e8d621132a96e1ULL,
+    0x00000000000001adULL, 0xb45d7b06a48c2d52ULL, 0x000033312e362e30ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000c00000001ULL, 0x0000000100000001ULL,
+    0x0000000400000000ULL, 0x000000020000000fULL, 0x0000000a00000005ULL, 0x0000001d00000002ULL,
+    0x000000040000001fULL, 0x0000000300000000ULL, 0x0000002100000009ULL, 0x000000030000000cULL,
+    0x000000040000001dULL, 0x0000001300000003ULL, 0x0000000000000025ULL, 0x0000000400000008ULL,
+    0x0000003000000009ULL, 0x0000000400000032ULL, 0x0000001600000004ULL, 0x0000000100000034ULL,
+    0x0000000400000004ULL, 0x0000000c0000001bULL, 0x0000002500000004ULL, 0x0000000400000004ULL,
+    0x000000360000001bULL, 0x0000000400000003ULL, 0x0000002600000004ULL, 0x0000000400000041ULL,
+    0x0000002b00000004ULL, 0x0000000400000045ULL, 0x0000002e00000004ULL, 0x0000000800000047ULL,
+    0x0000000900000005ULL, 0x0000004b00000049ULL, 0x0000000500000004ULL, 0x0000004d00000016ULL,
+    0x0000000400000001ULL, 0x0000001b00000005ULL, 0x000000050000000cULL, 0x0000000400000025ULL,
+    0x0000001b00000005ULL, 0x000000030000004fULL, 0x0000000500000004ULL, 0x0000005a00000026ULL,
+    0x0000000500000004ULL, 0x0000005e0000002bULL, 0x0000000500000004ULL, 0x000000600000002eULL,
+    0x0000000600000010ULL, 0x0000000400000009ULL, 0x0000001000000006ULL, 0x0000000000000062ULL,
+    0x000000080000000fULL, 0x0000006600000005ULL, 0x0000007a00000003ULL, 0x000000820000007eULL,
+    0x0000000500000002ULL, 0x0000000900000009ULL, 0x000000090000000cULL, 0x0000000400000010ULL,
+    0x0000000d00000009ULL, 0x000000020000008bULL, 0x0000000900000004ULL, 0x0000008f00000011ULL,
+    0x0000000900000004ULL, 0x0000009300000016ULL, 0x0000001000000001ULL, 0x0000001e00000009ULL,
+    0x000000090000000cULL, 0x000000040000002fULL, 0x0000002500000009ULL, 0x0000000200000097ULL,
+    0x0000000900000004ULL, 0x000000a200000030ULL, 0x0000000900000004ULL, 0x000000a600000035ULL,
+    0xffffffff00000001ULL, 0x0000000a00000010ULL, 0x0000000400000009ULL, 0x000000100000000aULL,
+    0x00000000000000aaULL, 0x0000000c00000000ULL, 0x000000b300000005ULL, 0x0000000c00000004ULL,
+    0x000000b900000011ULL, 0x0000000d00000000ULL, 0x000000cc00000005ULL, 0x0000000d00000004ULL,
+    0x000000d300000012ULL, 0x7463656a626f796eULL, 0x6f5f796e5f5f0073ULL, 0x6d5f737463656a62ULL,
+    0x6200610065677265ULL, 0x6a626f0074756f00ULL, 0x0077656e5f746365ULL, 0x626f00610076006bULL,
+    0x7465735f7463656aULL, 0x76006b0074756f00ULL, 0x6f00620076006b00ULL, 0x65735f7463656a62ULL,
+    0x006b0074756f0074ULL, 0x5f5f0074756f0076ULL, 0x63656a626f5f796eULL, 0x6f5f7465675f7374ULL,
+    0x656b006a626f0072ULL, 0x61626c6c61660079ULL, 0x6f00736168006b63ULL, 0x6f0079656b006a62ULL,
+    0x65675f7463656a62ULL, 0x656b006a626f0074ULL, 0x61626c6c61660079ULL, 0x656772656d006b63ULL,
+    0x626f5f796e5f5f00ULL, 0x656d5f737463656aULL, 0x5f74656700656772ULL, 0x5f796e5f5f00726fULL,
+    0x5f737463656a626fULL, 0x0000726f5f746567ULL,
+};
+
+static const uint64_t k_builtin_image_nyjson[] = {
+    0x000000014358594eULL, 0x0000009c01020304ULL, 0x00000000000000a5ULL, 0x55a4f1c8690b3756ULL,
+    0x00000000000001b6ULL, 0x2b0c1c1f5ffad7adULL, 0x000033312e362e30ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000c00000001ULL, 0x0000000100000001ULL,
+    0x0000000400000000ULL, 0x000000020000000fULL, 0x0000000700000005ULL, 0x0000001700000001ULL,
+    0x0000000500000004ULL, 0x0000000900000003ULL, 0x000000030000000bULL, 0x0000000400000012ULL,
+    0x0000000d00000003ULL, 0x000000260000001cULL, 0x0000000300000001ULL, 0x0000002100000015ULL,
+    0x0000001000000001ULL, 0x0000001f00000003ULL, 0x0000000300000002ULL, 0x0000000100000026ULL,
+    0xffffffff00000000ULL, 0x0000000400000005ULL, 0x0000000b00000009ULL, 0x0000001200000004ULL,
+    0x0000000400000004ULL, 0x000000260000000dULL, 0x0000000100000026ULL, 0x0000001500000004ULL,
+    0x000000010000002bULL, 0x0000000400000010ULL, 0x0000000200000020ULL, 0x0000002700000004ULL,
+    0x0000000000000000ULL, 0x00000005ffffffffULL, 0x0000000900000005ULL, 0x000000050000000bULL,
+    0x0000000400000012ULL, 0x0000000d00000005ULL, 0x0000002600000031ULL, 0x0000000500000001ULL,
+    0x0000003600000015ULL, 0x0000001000000001ULL, 0x0000001f00000005ULL, 0x0000000500000003ULL,
+    0x0000000000000026ULL, 0x0000000effffffffULL, 0x0000000900000006ULL, 0x0000001000000001ULL,
+    0x0000000d00000007ULL, 0x000000070000000cULL, 0x0000000400000017ULL, 0x0000001400000007ULL,
+    0x000000010000003bULL, 0x0000000700000004ULL, 0x0000003f00000018ULL, 0x0000004400000000ULL,
+    0x0000001000000001ULL, 0x0000000d00000009ULL, 0x0000000900000004ULL, 0x0000004800000014ULL,
+    0x0000000f00000000ULL, 0x000000050000000cULL, 0x000000010000004dULL, 0x0000000100000061ULL,
+    0x0000000d00000010ULL, 0x0000000c00000009ULL, 0x000000130000000dULL, 0x0000000d00000004ULL,
+    0x0000006700000010ULL, 0x0000000400000001ULL, 0x000000140000000dULL, 0x000000010000006bULL,
+    0x0000000f00000000ULL, 0x0000007100000005ULL, 0x0000000f00000004ULL, 0x0000007700000011ULL,
+    0x0000001000000000ULL, 0x0000008700000005ULL, 0x0000001000000004ULL, 0x0000009100000015ULL,
+    0x5f006e6f736a796eULL, 0x6e6f736a5f796e5fULL, 0x740065737261705fULL, 0x7478657400747865ULL,
+    0x6574006575727400ULL, 0x65736c6166007478ULL, 0x756e007478657400ULL, 0x7400746e69006c6cULL,
+    0x0072726500747865ULL, 0x6e5f5f0074786574ULL, 0x735f6e6f736a5f79ULL, 0x796669676e697274ULL,
+    0x730065756c617600ULL, 0x65756c6176007274ULL, 0x5f00657372617000ULL, 0x6e6f736a5f796e5fULL,
+    0x730065737261705fULL, 0x796669676e697274ULL, 0x736a5f796e5f5f00ULL, 0x6e697274735f6e6fULL,
+    0x0000000079666967ULL,
+};
+
+static const uint64_t k_builtin_image_nyhttp[] = {
+    0x000000014358594eULL, 0x0000009801020304ULL, 0x00000000000000e3ULL, 0x34c92c0f9f284221ULL,
+    0x00000000000001a9ULL, 0x860104bb26d9064eULL, 0x000033312e362e30ULL, 0x0000000000000000ULL,
+    0x0000000000000000ULL, 0x0000000000000000ULL, 0x0000000c00000001ULL, 0x0000000100000001ULL,
+    0x0000000600000000ULL, 0x000000020000000fULL, 0x0000000700000005ULL, 0x0000001500000001ULL,
+    0x0000000000000002ULL, 0x0000000900000003ULL, 0x0000000c0000001aULL, 0x0000001800000003ULL,
+    0x0000000300000004ULL, 0x0000001f00000014ULL, 0x0000000400000001ULL, 0x0000001900000003ULL,
+    0x0000001000000024ULL, 0x0000000900000004ULL, 0x0000000400000007ULL, 0x0000000400000010ULL,
+    0x0000000200000029ULL, 0x0000001500000004ULL, 0x0000002c00000001ULL, 0x0000000400000000ULL,
+    0x000000c800000023ULL, 0x0000003300000000ULL, 0x0000000400000004ULL, 0x000000380000002eULL,
+    0x000000040000003dULL, 0x0000003a00000004ULL, 0x0000000000000042ULL, 0x000000060000000fULL,
+    0x0000004700000005ULL, 0x0000005600000001ULL, 0x0000000000000002ULL, 0x0000000900000007ULL,
+    0x0000000c0000005bULL, 0x0000002100000007ULL, 0x0000000700000004ULL, 0x0000006000000014ULL,
+    0x0000000400000001ULL, 0x0000002200000007ULL, 0x000000100000006eULL, 0x0000000900000008ULL,
+    0x000000080000000cULL, 0x000000040000001aULL, 0x0000001000000008ULL, 0x0000000200000073ULL,
+    0x0000000800000004ULL, 0x0000007e0000001bULL, 0x0000000800000001ULL, 0x0000008300000021ULL,
+    0x0000000f00000001ULL, 0x000000050000000aULL, 0x0000000100000088ULL, 0x0000000100000095ULL,
+    0x0000000b00000010ULL, 0x0000000c00000009ULL, 0x0000001a0000000bULL, 0x0000000b00000004ULL,
+    0x0000009a00000010ULL, 0x0000000400000002ULL, 0x0000001b0000000bULL, 0x00000001000000a5ULL,
+    0x000000210000000bULL, 0x00000001000000aaULL, 0x0000000d00000000ULL, 0x000000ad00000005ULL,
+    0x0000000d00000004ULL, 0x000000b10000000fULL, 0x0000000e00000000ULL, 0x000000bf00000005ULL,
+    0x0000000e00000004ULL, 0x000000c400000010ULL, 0x0000000f00000000ULL, 0x000000d300000005ULL,
+    0x0000000f00000004ULL, 0x000000d60000000eULL, 0x5f0070747468796eULL, 0x707474685f796e5fULL,
+    0x746170007465675fULL, 0x720079646f620068ULL, 0x6874617000646165ULL, 0x74617473006b6f00ULL,
+    0x0079646f62007375ULL, 0x7461700079646f62ULL, 0x5f00687461700068ULL, 0x707474685f796e5fULL,
+    0x617000747865745fULL, 0x0070736572006874ULL, 0x7474685f796e5f5fULL, 0x6170007465675f70ULL,
+    0x63656a626f006874ULL, 0x6572007465675f74ULL, 0x0079646f62007073ULL, 0x7474685f796e5f5fULL,
+    0x736572006b6f5f70ULL, 0x7463656a626f0070ULL, 0x736572007465675fULL, 0x746567006b6f0070ULL,
+    0x74685f796e5f5f00ULL, 0x74007465675f7074ULL, 0x796e5f5f00747865ULL, 0x65745f707474685fULL,
+    0x5f5f006b6f007478ULL, 0x5f707474685f796eULL, 0x0000000000006b6fULL,
+};
+
+static const BuiltinSnapshot k_builtin_snapshots[] = {
+    {"nymath", k_builtin_image_nymath, 2047},
+    {"nyarrays", k_builtin_image_nyarrays, 1329},
+    {"nyobjects", k_builtin_image_nyobjects, 1007},
+    {"nyjson", k_builtin_image_nyjson, 869},
+    {"nyhttp", k_builtin_image_nyhttp, 915},
+};
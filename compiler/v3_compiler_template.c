@@ -4,11 +4,27 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <setjmp.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* -j parses imports on a pool of pthreads; builds without them load each import in turn. */
+#ifndef NYX_THREADS
+#if defined(_WIN32)
+#define NYX_THREADS 0
+#else
+#define NYX_THREADS 1
+#endif
+#endif
+#if NYX_THREADS
+#include <pthread.h>
+#define NYX_THREAD_LOCAL __thread
+#else
+#define NYX_THREAD_LOCAL
+#endif
+
 #define MAX_TOKEN_TEXT 1024
 #ifndef NYX_LANG_VERSION
 #define NYX_LANG_VERSION "0.8.0"
@@ -319,7 +335,11 @@ static void fail(const char *msg) {
     exit(1);
 }
 
+/* Set while a -j worker parses: syntax errors unwind to it instead of exiting (see prefetch_parse). */
+static NYX_THREAD_LOCAL jmp_buf *g_fail_recover = NULL;
+
 static void fail_at(int line, int col, const char *msg) {
+    if (g_fail_recover != NULL) longjmp(*g_fail_recover, 1);
     fprintf(stderr, "Error at %d:%d: %s\n", line, col, msg);
     exit(1);
 }
@@ -1729,24 +1749,146 @@ static Block *parse_program(Parser *p) {
     return program;
 }
 
-static void load_program_recursive(const char *path, Block *out, StrSet *visited) {
-    if (!strset_add(visited, path)) return;
+/*
+ * -j N: before import expansion, N threads read and parse the input and the files its
+ * top-level imports reach, transitively. load_program_recursive then expands imports in the
+ * usual order and takes each tree from here. A file that could not be read or parsed is
+ * loaded again in turn, which reports the error exactly as without -j.
+ */
+typedef struct {
+    char *path;
+    Block *program;
+} PrefetchEntry;
 
-    char *source = NULL;
-    const char *builtin_src = builtin_module_source(path);
-    if (builtin_src) {
-        source = xstrdup(builtin_src);
-    } else {
-        source = read_file(path);
+typedef struct {
+    PrefetchEntry *items;
+    int count;
+    int cap;
+    int next; /* first entry no worker has claimed yet */
+    int busy; /* workers reading or parsing an entry right now */
+} ImportPrefetch;
+
+static ImportPrefetch g_prefetch = {NULL, 0, 0, 0, 0};
+
+#if NYX_THREADS
+static int g_parse_jobs = 1;
+static pthread_mutex_t g_prefetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_prefetch_cond = PTHREAD_COND_INITIALIZER;
+
+static void prefetch_add(const char *path) {
+    for (int i = 0; i < g_prefetch.count; i++) {
+        if (strcmp(g_prefetch.items[i].path, path) == 0) return;
     }
-    if (!source) {
-        fprintf(stderr, "Error: could not read input source: %s\n", path);
-        exit(1);
+    if (g_prefetch.count == g_prefetch.cap) {
+        g_prefetch.cap = g_prefetch.cap == 0 ? 64 : g_prefetch.cap * 2;
+        g_prefetch.items = (PrefetchEntry *)xrealloc(g_prefetch.items, (size_t)g_prefetch.cap * sizeof(PrefetchEntry));
     }
+    PrefetchEntry *e = &g_prefetch.items[g_prefetch.count++];
+    e->path = xstrdup(path);
+    e->program = NULL;
+}
 
+/* parse_program on a worker thread; NULL when the text does not parse. */
+static Block *prefetch_parse(const char *source) {
+    jmp_buf recover;
+    if (setjmp(recover) != 0) {
+        g_fail_recover = NULL;
+        return NULL;
+    }
+    g_fail_recover = &recover;
     Parser p;
     parser_init(&p, source);
     Block *program = parse_program(&p);
+    g_fail_recover = NULL;
+    return program;
+}
+
+static void *prefetch_run(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&g_prefetch_mutex);
+    while (1) {
+        while (g_prefetch.next == g_prefetch.count && g_prefetch.busy > 0) {
+            pthread_cond_wait(&g_prefetch_cond, &g_prefetch_mutex);
+        }
+        if (g_prefetch.next == g_prefetch.count) break;
+        int index = g_prefetch.next++;
+        char *path = g_prefetch.items[index].path;
+        g_prefetch.busy++;
+        pthread_mutex_unlock(&g_prefetch_mutex);
+
+        char *source = read_file(path);
+        Block *program = source != NULL ? prefetch_parse(source) : NULL;
+        free(source);
+        StrSet found;
+        strset_init(&found);
+        for (int i = 0; program != NULL && i < program->count; i++) {
+            Stmt *s = program->items[i];
+            if (s->kind != ST_IMPORT || is_builtin_module_path(s->as.import_stmt.path)) continue;
+            char *child = resolve_import_path(path, s->as.import_stmt.path);
+            strset_add(&found, child);
+            free(child);
+        }
+
+        pthread_mutex_lock(&g_prefetch_mutex);
+        g_prefetch.items[index].program = program;
+        for (int i = 0; i < found.count; i++) {
+            prefetch_add(found.items[i]);
+            free(found.items[i]);
+        }
+        free(found.items);
+        g_prefetch.busy--;
+        pthread_cond_broadcast(&g_prefetch_cond);
+    }
+    pthread_cond_broadcast(&g_prefetch_cond);
+    pthread_mutex_unlock(&g_prefetch_mutex);
+    return NULL;
+}
+
+/* Parses the import graph of `input_path` on g_parse_jobs threads, the calling one included. */
+static void import_prefetch(const char *input_path) {
+    int extra = g_parse_jobs - 1;
+    pthread_t *threads = (pthread_t *)xmalloc((size_t)extra * sizeof(pthread_t));
+    prefetch_add(input_path);
+    int started = 0;
+    while (started < extra && pthread_create(&threads[started], NULL, prefetch_run, NULL) == 0) started++;
+    prefetch_run(NULL);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    free(threads);
+}
+#endif
+
+static Block *prefetch_take(const char *path) {
+    for (int i = 0; i < g_prefetch.count; i++) {
+        PrefetchEntry *e = &g_prefetch.items[i];
+        if (e->program == NULL || strcmp(e->path, path) != 0) continue;
+        Block *program = e->program;
+        e->program = NULL;
+        return program;
+    }
+    return NULL;
+}
+
+static void load_program_recursive(const char *path, Block *out, StrSet *visited) {
+    if (!strset_add(visited, path)) return;
+
+    char *source = NULL;
+    Block *program = prefetch_take(path);
+    if (program == NULL) {
+        const char *builtin_src = builtin_module_source(path);
+        if (builtin_src) {
+            source = xstrdup(builtin_src);
+        } else {
+            source = read_file(path);
+        }
+        if (!source) {
+            fprintf(stderr, "Error: could not read input source: %s\n", path);
+            exit(1);
+        }
+
+        Parser p;
+        parser_init(&p, source);
+        program = parse_program(&p);
+    }
 
     for (int i = 0; i < program->count; i++) {
         Stmt *s = program->items[i];
@@ -4132,6 +4274,9 @@ static int compile_file(const char *input_path, const char *output_path) {
     Block *program = new_block();
     StrSet visited;
     strset_init(&visited);
+#if NYX_THREADS
+    if (g_parse_jobs > 1) import_prefetch(input_path);
+#endif
     load_program_recursive(input_path, program, &visited);
 
     StrSet fn_names;
@@ -4186,7 +4331,7 @@ static int compile_file(const char *input_path, const char *output_path) {
 
 int main(int argc, char **argv) {
     if (argc < 3) {
-        fprintf(stderr, "Usage: v3_compiler <input.ny> <output.c> [--emit-self]\n");
+        fprintf(stderr, "Usage: v3_compiler <input.ny> <output.c> [--emit-self] [-j N]\n");
         return 1;
     }
 
@@ -4194,5 +4339,21 @@ int main(int argc, char **argv) {
         return copy_file(__FILE__, argv[2]);
     }
 
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "-j") != 0) continue;
+        char *endp = NULL;
+        long v = i + 1 < argc ? strtol(argv[i + 1], &endp, 10) : 0;
+        if (endp == NULL || endp == argv[i + 1] || *endp != '\0' || v < 1 || v > 256) {
+            fprintf(stderr, "Error: -j expects an integer in [1, 256]\n");
+            return 1;
+        }
+#if NYX_THREADS
+        g_parse_jobs = (int)v;
+#else
+        if (v > 1) fprintf(stderr, "Warning: -j needs a pthreads build; parsing imports in turn\n");
+#endif
+        i++;
+    }
+
     return compile_file(argv[1], argv[2]);
 }
@@ -1,22 +1,55 @@
 #if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
 #define _CRT_SECURE_NO_WARNINGS
 #endif
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE /* MAP_ANONYMOUS for the JIT's code pages */
+#endif
 
 #include <ctype.h>
 #include <errno.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #if defined(_WIN32)
+#include <direct.h>
 #include <io.h>
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif
 
-#define MAX_TOKEN_TEXT 1024
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NYX_SSE2 1
+#else
+#define NYX_SSE2 0
+#endif
+/* -j parses imports on a pool of pthreads; builds without them parse each import on demand. */
+#ifndef NYX_THREADS
+#if defined(_WIN32)
+#define NYX_THREADS 0
+#else
+#define NYX_THREADS 1
+#endif
+#endif
+#if NYX_THREADS
+#include <pthread.h>
+#define NYX_THREAD_LOCAL __thread
+#else
+#define NYX_THREAD_LOCAL
+#endif
+#if defined(__x86_64__) && defined(__linux__)
+#define NYX_JIT 1
+#else
+#define NYX_JIT 0
+#endif
 #ifndef NYX_LANG_VERSION
 #define NYX_LANG_VERSION "0.8.0"
 #endif
@@ -75,13 +108,18 @@ typedef enum {
     TOK_DOT,
     TOK_COLON,
     TOK_COMMA,
-    TOK_SEMI
+    TOK_SEMI,
+    /* Never produced by the lexer: `x * 2^k` after -O strength reduction. */
+    TOK_SHL
 } TokenType;
 
+/* The text is a span of the source, or for a string literal with escapes of the Lexer's `escaped` buffer. */
 typedef struct {
     TokenType type;
     long long int_val;
-    char text[MAX_TOKEN_TEXT];
+    size_t start;
+    size_t len;
+    int escaped;
     int line;
     int col;
 } Token;
@@ -91,16 +129,34 @@ typedef struct {
     size_t len;
     size_t pos;
     int line;
-    int col;
+    size_t line_start; /* offset of the current line; columns count bytes from it */
+    char *escaped; /* decoded string literals that contained escapes, back to back */
+    size_t escaped_len;
+    size_t escaped_cap;
 } Lexer;
 
+/* Set while a -j worker parses: syntax errors unwind to it instead of exiting (see prefetch_parse). */
+static NYX_THREAD_LOCAL jmp_buf *g_die_recover = NULL;
+
 static void die_at(int line, int col, const char *msg) {
+    if (g_die_recover != NULL) longjmp(*g_die_recover, 1);
     fprintf(stderr, "Error at %d:%d: %s\n", line, col, msg);
     exit(1);
 }
 
+/*
+ * Every allocation carries a header holding its slot in the tracker, so registering,
+ * moving (realloc) and releasing a block are O(1) no matter how many blocks are live.
+ */
+typedef union {
+    int index;
+    long long align_ll;
+    long double align_ld;
+    void *align_p;
+} AllocHeader;
+
 typedef struct {
-    void **items;
+    AllocHeader **items;
     int count;
     int cap;
     int initialized;
@@ -108,6 +164,23 @@ typedef struct {
 } AllocTracker;
 
 static AllocTracker g_alloc_tracker = {0};
+static long long g_malloc_calls = 0;
+#if NYX_THREADS
+static int g_alloc_shared = 0; /* -j parser threads are running: the tracker needs the lock */
+static pthread_mutex_t g_alloc_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void alloc_lock(void) {
+#if NYX_THREADS
+    if (g_alloc_shared) pthread_mutex_lock(&g_alloc_mutex);
+#endif
+}
+
+static void alloc_unlock(void) {
+#if NYX_THREADS
+    if (g_alloc_shared) pthread_mutex_unlock(&g_alloc_mutex);
+#endif
+}
 
 static void alloc_tracker_cleanup(void);
 
@@ -120,22 +193,15 @@ static void alloc_tracker_init(void) {
     }
 }
 
-static int alloc_tracker_find(void *p) {
-    for (int i = 0; i < g_alloc_tracker.count; i++) {
-        if (g_alloc_tracker.items[i] == p) return i;
-    }
-    return -1;
-}
-
-static void alloc_tracker_add(void *p) {
-    if (!p || g_alloc_tracker.cleaning) return;
+static void alloc_tracker_add(AllocHeader *h) {
+    h->index = -1;
+    if (g_alloc_tracker.cleaning) return;
     alloc_tracker_init();
 
-    if (alloc_tracker_find(p) >= 0) return;
-
     if (g_alloc_tracker.count == g_alloc_tracker.cap) {
         int next_cap = g_alloc_tracker.cap == 0 ? 256 : g_alloc_tracker.cap * 2;
-        void **next_items = (void **)realloc(g_alloc_tracker.items, (size_t)next_cap * sizeof(void *));
+        AllocHeader **next_items =
+            (AllocHeader **)realloc(g_alloc_tracker.items, (size_t)next_cap * sizeof(AllocHeader *));
         if (!next_items) {
             fprintf(stderr, "Out of memory\n");
             exit(1);
@@ -144,49 +210,54 @@ static void alloc_tracker_add(void *p) {
         g_alloc_tracker.cap = next_cap;
     }
 
-    g_alloc_tracker.items[g_alloc_tracker.count++] = p;
+    h->index = g_alloc_tracker.count;
+    g_alloc_tracker.items[g_alloc_tracker.count++] = h;
 }
 
-static void alloc_tracker_remove(void *p) {
-    if (!p || !g_alloc_tracker.initialized || g_alloc_tracker.cleaning) return;
-    int idx = alloc_tracker_find(p);
-    if (idx < 0) return;
-    g_alloc_tracker.items[idx] = g_alloc_tracker.items[g_alloc_tracker.count - 1];
-    g_alloc_tracker.count--;
+static void alloc_tracker_remove(AllocHeader *h) {
+    if (g_alloc_tracker.cleaning || h->index < 0) return;
+    AllocHeader *last = g_alloc_tracker.items[--g_alloc_tracker.count];
+    g_alloc_tracker.items[h->index] = last;
+    last->index = h->index;
 }
 
 static void *xmalloc(size_t n) {
-    void *p = malloc(n);
-    if (!p) {
+    AllocHeader *h = (AllocHeader *)malloc(sizeof(AllocHeader) + n);
+    if (!h) {
         fprintf(stderr, "Out of memory\n");
         exit(1);
     }
-    alloc_tracker_add(p);
-    return p;
+    alloc_lock();
+    g_malloc_calls++;
+    alloc_tracker_add(h);
+    alloc_unlock();
+    return h + 1;
 }
 
 static void *xrealloc(void *p, size_t n) {
     if (!p) return xmalloc(n);
 
-    int idx = alloc_tracker_find(p);
-    void *q = realloc(p, n);
+    /* Held across realloc: another thread's xfree may rewrite this block's index meanwhile. */
+    alloc_lock();
+    g_malloc_calls++;
+    AllocHeader *q = (AllocHeader *)realloc((AllocHeader *)p - 1, sizeof(AllocHeader) + n);
     if (!q) {
         fprintf(stderr, "Out of memory\n");
         exit(1);
     }
 
-    if (idx >= 0) {
-        g_alloc_tracker.items[idx] = q;
-    } else {
-        alloc_tracker_add(q);
-    }
-    return q;
+    if (q->index >= 0 && !g_alloc_tracker.cleaning) g_alloc_tracker.items[q->index] = q;
+    alloc_unlock();
+    return q + 1;
 }
 
 static void xfree(void *p) {
     if (!p) return;
-    alloc_tracker_remove(p);
-    free(p);
+    AllocHeader *h = (AllocHeader *)p - 1;
+    alloc_lock();
+    alloc_tracker_remove(h);
+    alloc_unlock();
+    free(h);
 }
 
 static char *xstrdup(const char *s) {
@@ -225,22 +296,53 @@ static char *str_concat(const char *a, const char *b) {
     return out;
 }
 
+/* Character classes for the lexer, ASCII only like the C locale; bytes from 0x80 up are CH_OTHER. */
+enum { CH_OTHER = 0, CH_SPACE = 1, CH_DIGIT = 2, CH_ALPHA = 4, CH_IDENT = CH_DIGIT | CH_ALPHA };
+
+static const unsigned char k_char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,
+    0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 4,
+    0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0,
+};
+
 static void lexer_init(Lexer *lx, const char *src) {
     lx->src = src;
     lx->len = strlen(src);
     lx->pos = 0;
     lx->line = 1;
-    lx->col = 1;
+    lx->line_start = 0;
+    lx->escaped = NULL;
+    lx->escaped_len = 0;
+    lx->escaped_cap = 0;
 }
 
-static int lexer_peek(Lexer *lx) {
-    if (lx->pos >= lx->len) return 0;
-    return (unsigned char)lx->src[lx->pos];
+static void lexer_escaped_push(Lexer *lx, const char *text, size_t n) {
+    if (lx->escaped_len + n > lx->escaped_cap) {
+        size_t next_cap = lx->escaped_cap == 0 ? 256 : lx->escaped_cap * 2;
+        while (next_cap < lx->escaped_len + n) next_cap *= 2;
+        lx->escaped = (char *)xrealloc(lx->escaped, next_cap);
+        lx->escaped_cap = next_cap;
+    }
+    memcpy(lx->escaped + lx->escaped_len, text, n);
+    lx->escaped_len += n;
+}
+
+static const char *token_chars(const Lexer *lx, const Token *tok) {
+    return (tok->escaped ? lx->escaped : lx->src) + tok->start;
+}
+
+static int lexer_col(const Lexer *lx) {
+    return (int)(lx->pos - lx->line_start) + 1;
 }
 
-static int lexer_peek_next(Lexer *lx) {
-    if (lx->pos + 1 >= lx->len) return 0;
-    return (unsigned char)lx->src[lx->pos + 1];
+/* The source is NUL-terminated, so peeking at `len` yields 0 without a bounds check. */
+static int lexer_peek(Lexer *lx) {
+    return (unsigned char)lx->src[lx->pos];
 }
 
 static int lexer_next_char(Lexer *lx) {
@@ -248,26 +350,67 @@ static int lexer_next_char(Lexer *lx) {
     int ch = (unsigned char)lx->src[lx->pos++];
     if (ch == '\n') {
         lx->line++;
-        lx->col = 1;
-    } else {
-        lx->col++;
+        lx->line_start = lx->pos;
     }
     return ch;
 }
 
+#if NYX_SSE2
+/* Bit i set for each byte of the 16 at `s` equal to a, b or c. */
+static unsigned lexer_match16(const char *s, char a, char b, char c) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)s);
+    __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(a)), _mm_cmpeq_epi8(v, _mm_set1_epi8(b)));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+    return (unsigned)_mm_movemask_epi8(m);
+}
+
+static size_t lexer_lowest_bit(unsigned mask) {
+    size_t n = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+}
+#endif
+
+/* Position of the first byte from `pos` that is not a space, tab or CR; these never move the line. */
+static size_t lexer_skip_blanks(const Lexer *lx, size_t pos) {
+#if NYX_SSE2
+    while (pos + 16 <= lx->len) {
+        unsigned blank = lexer_match16(lx->src + pos, ' ', '\t', '\r') ^ 0xFFFFu;
+        if (blank != 0) return pos + lexer_lowest_bit(blank);
+        pos += 16;
+    }
+#endif
+    while (lx->src[pos] == ' ' || lx->src[pos] == '\t' || lx->src[pos] == '\r') pos++;
+    return pos;
+}
+
+/* Position of the first '"', '\\' or newline from `pos`, or `len`. */
+static size_t lexer_scan_string(const Lexer *lx, size_t pos) {
+#if NYX_SSE2
+    while (pos + 16 <= lx->len) {
+        unsigned hit = lexer_match16(lx->src + pos, '"', '\\', '\n');
+        if (hit != 0) return pos + lexer_lowest_bit(hit);
+        pos += 16;
+    }
+#endif
+    while (pos < lx->len && lx->src[pos] != '"' && lx->src[pos] != '\\' && lx->src[pos] != '\n') pos++;
+    return pos;
+}
+
 static void skip_ws_and_comments(Lexer *lx) {
     while (1) {
+        lx->pos = lexer_skip_blanks(lx, lx->pos);
         int ch = lexer_peek(lx);
-        if (ch == 0) return;
-        if (isspace(ch)) {
-            lexer_next_char(lx);
-            continue;
-        }
         if (ch == '#') {
-            while (ch != 0 && ch != '\n') ch = lexer_next_char(lx);
+            const char *nl = (const char *)memchr(lx->src + lx->pos, '\n', lx->len - lx->pos);
+            lx->pos = nl != NULL ? (size_t)(nl - lx->src) : lx->len;
             continue;
         }
-        return;
+        if (!(k_char_class[ch] & CH_SPACE)) return;
+        lexer_next_char(lx);
     }
 }
 
@@ -275,164 +418,149 @@ static Token make_token(TokenType t, int line, int col) {
     Token tok;
     tok.type = t;
     tok.int_val = 0;
-    tok.text[0] = '\0';
+    tok.start = 0;
+    tok.len = 0;
+    tok.escaped = 0;
     tok.line = line;
     tok.col = col;
     return tok;
 }
 
-static TokenType keyword_type(const char *ident) {
-    if (strcmp(ident, "let") == 0) return TOK_LET;
-    if (strcmp(ident, "if") == 0) return TOK_IF;
-    if (strcmp(ident, "else") == 0) return TOK_ELSE;
-    if (strcmp(ident, "switch") == 0) return TOK_SWITCH;
-    if (strcmp(ident, "case") == 0) return TOK_CASE;
-    if (strcmp(ident, "default") == 0) return TOK_DEFAULT;
-    if (strcmp(ident, "while") == 0) return TOK_WHILE;
-    if (strcmp(ident, "for") == 0) return TOK_FOR;
-    if (strcmp(ident, "in") == 0) return TOK_IN;
-    if (strcmp(ident, "break") == 0) return TOK_BREAK;
-    if (strcmp(ident, "continue") == 0) return TOK_CONTINUE;
-    if (strcmp(ident, "class") == 0) return TOK_CLASS;
-    if (strcmp(ident, "module") == 0) return TOK_MODULE;
-    if (strcmp(ident, "typealias") == 0) return TOK_TYPEDEF;
-    if (strcmp(ident, "try") == 0) return TOK_TRY;
-    if (strcmp(ident, "catch") == 0) return TOK_CATCH;
-    if (strcmp(ident, "throw") == 0) return TOK_THROW;
-    if (strcmp(ident, "fn") == 0) return TOK_FN;
-    if (strcmp(ident, "return") == 0) return TOK_RETURN;
-    if (strcmp(ident, "import") == 0) return TOK_IMPORT;
-    if (strcmp(ident, "true") == 0) return TOK_TRUE;
-    if (strcmp(ident, "false") == 0) return TOK_FALSE;
-    if (strcmp(ident, "null") == 0) return TOK_NULL;
+/*
+ * Keywords by perfect hash: slot (2 * first + last + 34 * length) & 63 is unique for each of them.
+ * Adding a keyword means checking that its slot is free, or picking new multipliers.
+ */
+typedef struct {
+    const char *name;
+    TokenType type;
+} Keyword;
+
+static const Keyword k_keywords[64] = {
+    [4] = {"in", TOK_IN},          [7] = {"try", TOK_TRY},         [9] = {"throw", TOK_THROW},
+    [11] = {"module", TOK_MODULE}, [13] = {"typealias", TOK_TYPEDEF}, [16] = {"null", TOK_NULL},
+    [18] = {"import", TOK_IMPORT}, [21] = {"true", TOK_TRUE},      [24] = {"catch", TOK_CATCH},
+    [25] = {"break", TOK_BREAK},   [26] = {"switch", TOK_SWITCH},  [27] = {"false", TOK_FALSE},
+    [30] = {"return", TOK_RETURN}, [35] = {"class", TOK_CLASS},    [36] = {"for", TOK_FOR},
+    [42] = {"default", TOK_DEFAULT}, [50] = {"let", TOK_LET},      [51] = {"case", TOK_CASE},
+    [55] = {"else", TOK_ELSE},     [59] = {"continue", TOK_CONTINUE}, [60] = {"if", TOK_IF},
+    [61] = {"while", TOK_WHILE},   [62] = {"fn", TOK_FN},
+};
+
+static TokenType keyword_type(const char *text, size_t len) {
+    const Keyword *kw = &k_keywords[((unsigned char)text[0] * 2u + (unsigned char)text[len - 1] + (unsigned)len * 34u) & 63u];
+    if (kw->name != NULL && strncmp(kw->name, text, len) == 0 && kw->name[len] == '\0') return kw->type;
     return TOK_IDENT;
 }
 
+/* The operator just consumed, or `two` when `second` follows it. */
+static Token lexer_op(Lexer *lx, int second, TokenType two, TokenType one, int line, int col) {
+    if (lexer_peek(lx) == second) {
+        lx->pos++;
+        return make_token(two, line, col);
+    }
+    return make_token(one, line, col);
+}
+
 static Token lexer_next_token(Lexer *lx) {
     skip_ws_and_comments(lx);
 
     int line = lx->line;
-    int col = lx->col;
+    int col = lexer_col(lx);
     int ch = lexer_peek(lx);
 
     if (ch == 0) {
         return make_token(TOK_EOF, line, col);
     }
 
-    if (isdigit(ch)) {
-        Token tok = make_token(TOK_INT, line, col);
-        size_t start = lx->pos;
-        while (isdigit(lexer_peek(lx))) lexer_next_char(lx);
-        size_t n = lx->pos - start;
-        if (n >= MAX_TOKEN_TEXT) die_at(line, col, "integer literal too long");
-        memcpy(tok.text, lx->src + start, n);
-        tok.text[n] = '\0';
-        errno = 0;
-        tok.int_val = strtoll(tok.text, NULL, 10);
-        if (errno != 0) die_at(line, col, "invalid integer literal");
-        return tok;
-    }
-
-    if (isalpha(ch) || ch == '_') {
-        Token tok = make_token(TOK_IDENT, line, col);
-        size_t start = lx->pos;
-        while (isalnum(lexer_peek(lx)) || lexer_peek(lx) == '_') lexer_next_char(lx);
-        size_t n = lx->pos - start;
-        if (n >= MAX_TOKEN_TEXT) die_at(line, col, "identifier too long");
-        memcpy(tok.text, lx->src + start, n);
-        tok.text[n] = '\0';
-        tok.type = keyword_type(tok.text);
-        return tok;
+    switch (k_char_class[ch]) {
+        case CH_DIGIT: {
+            Token tok = make_token(TOK_INT, line, col);
+            tok.start = lx->pos;
+            while (k_char_class[ch = lexer_peek(lx)] & CH_DIGIT) {
+                int d = ch - '0';
+                if (tok.int_val > (LLONG_MAX - d) / 10) die_at(line, col, "invalid integer literal");
+                tok.int_val = tok.int_val * 10 + d;
+                lx->pos++;
+            }
+            tok.len = lx->pos - tok.start;
+            return tok;
+        }
+        case CH_ALPHA: {
+            Token tok = make_token(TOK_IDENT, line, col);
+            tok.start = lx->pos;
+            while (k_char_class[lexer_peek(lx)] & CH_IDENT) lx->pos++;
+            tok.len = lx->pos - tok.start;
+            tok.type = keyword_type(lx->src + tok.start, tok.len);
+            return tok;
+        }
+        default:
+            break;
     }
 
     if (ch == '"') {
         Token tok = make_token(TOK_STRING, line, col);
-        char buf[MAX_TOKEN_TEXT];
-        size_t n = 0;
-
-        lexer_next_char(lx); /* consume opening quote */
-
+        lx->pos++; /* consume opening quote */
+        tok.start = lx->pos;
+        int c;
         while (1) {
-            int c = lexer_peek(lx);
-            if (c == 0) die_at(line, col, "unterminated string literal");
-            if (c == '"') {
-                lexer_next_char(lx);
-                break;
-            }
-            if (c == '\\') {
-                lexer_next_char(lx);
-                int e = lexer_peek(lx);
-                if (e == 0) die_at(line, col, "unterminated string escape");
-                char out;
-                switch (e) {
-                    case 'n': out = '\n'; break;
-                    case 't': out = '\t'; break;
-                    case 'r': out = '\r'; break;
-                    case '"': out = '"'; break;
-                    case '\\': out = '\\'; break;
-                    default: out = (char)e; break;
+            lx->pos = lexer_scan_string(lx, lx->pos);
+            c = lexer_peek(lx);
+            if (c != '\n') break;
+            lexer_next_char(lx);
+        }
+        tok.len = lx->pos - tok.start;
+        if (c == '\\') {
+            /* Decoded into the side buffer, starting with the plain prefix. */
+            tok.escaped = 1;
+            tok.start = lx->escaped_len;
+            lexer_escaped_push(lx, lx->src + lx->pos - tok.len, tok.len);
+            while (c != '"') {
+                if (c == 0) die_at(line, col, "unterminated string literal");
+                if (c == '\\') {
+                    lx->pos++;
+                    int e = lexer_peek(lx);
+                    if (e == 0) die_at(line, col, "unterminated string escape");
+                    char out;
+                    switch (e) {
+                        case 'n': out = '\n'; break;
+                        case 't': out = '\t'; break;
+                        case 'r': out = '\r'; break;
+                        case '"': out = '"'; break;
+                        case '\\': out = '\\'; break;
+                        default: out = (char)e; break;
+                    }
+                    lexer_escaped_push(lx, &out, 1);
+                    lexer_next_char(lx);
+                } else if (c == '\n') {
+                    lexer_escaped_push(lx, "\n", 1);
+                    lexer_next_char(lx);
                 }
-                if (n + 1 >= MAX_TOKEN_TEXT) die_at(line, col, "string literal too long");
-                buf[n++] = out;
-                lexer_next_char(lx);
-                continue;
+                size_t run = lx->pos;
+                lx->pos = lexer_scan_string(lx, run);
+                lexer_escaped_push(lx, lx->src + run, lx->pos - run);
+                c = lexer_peek(lx);
             }
-            if (n + 1 >= MAX_TOKEN_TEXT) die_at(line, col, "string literal too long");
-            buf[n++] = (char)lexer_next_char(lx);
+            tok.len = lx->escaped_len - tok.start;
         }
-
-        buf[n] = '\0';
-        memcpy(tok.text, buf, n + 1);
+        if (c == 0) die_at(line, col, "unterminated string literal");
+        lx->pos++; /* consume closing quote */
         return tok;
     }
 
-    if (ch == '=' && lexer_peek_next(lx) == '=') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_EQ, line, col);
-    }
-    if (ch == '!' && lexer_peek_next(lx) == '=') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_NEQ, line, col);
-    }
-    if (ch == '&' && lexer_peek_next(lx) == '&') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_ANDAND, line, col);
-    }
-    if (ch == '|' && lexer_peek_next(lx) == '|') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_OROR, line, col);
-    }
-    if (ch == '?' && lexer_peek_next(lx) == '?') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_COALESCE, line, col);
-    }
-    if (ch == '<' && lexer_peek_next(lx) == '=') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_LE, line, col);
-    }
-    if (ch == '>' && lexer_peek_next(lx) == '=') {
-        lexer_next_char(lx);
-        lexer_next_char(lx);
-        return make_token(TOK_GE, line, col);
-    }
-
-    lexer_next_char(lx);
+    lx->pos++;
     switch (ch) {
-        case '=': return make_token(TOK_ASSIGN, line, col);
+        case '=': return lexer_op(lx, '=', TOK_EQ, TOK_ASSIGN, line, col);
+        case '!': return lexer_op(lx, '=', TOK_NEQ, TOK_BANG, line, col);
+        case '<': return lexer_op(lx, '=', TOK_LE, TOK_LT, line, col);
+        case '>': return lexer_op(lx, '=', TOK_GE, TOK_GT, line, col);
+        case '&': return lexer_op(lx, '&', TOK_ANDAND, TOK_ILLEGAL, line, col);
+        case '|': return lexer_op(lx, '|', TOK_OROR, TOK_ILLEGAL, line, col);
+        case '?': return lexer_op(lx, '?', TOK_COALESCE, TOK_ILLEGAL, line, col);
         case '+': return make_token(TOK_PLUS, line, col);
         case '-': return make_token(TOK_MINUS, line, col);
         case '*': return make_token(TOK_STAR, line, col);
         case '/': return make_token(TOK_SLASH, line, col);
         case '%': return make_token(TOK_PERCENT, line, col);
-        case '!': return make_token(TOK_BANG, line, col);
-        case '<': return make_token(TOK_LT, line, col);
-        case '>': return make_token(TOK_GT, line, col);
         case '(': return make_token(TOK_LPAREN, line, col);
         case ')': return make_token(TOK_RPAREN, line, col);
         case '{': return make_token(TOK_LBRACE, line, col);
@@ -450,6 +578,7 @@ static Token lexer_next_token(Lexer *lx) {
 typedef struct Expr Expr;
 typedef struct Stmt Stmt;
 typedef struct Block Block;
+typedef uint32_t ExprId; /* slot in the expression table (see expr_at); 0 means none */
 
 typedef enum {
     EXPR_INT,
@@ -467,52 +596,61 @@ typedef enum {
     EXPR_CALL
 } ExprKind;
 
+/* Rare, bulky node shapes live in side records so they do not widen every Expr or Stmt. */
+struct ArrayComp {
+    ExprId value_expr;
+    ExprId iter_expr;
+    ExprId filter_expr;
+    char *iter_name;
+    char *iter_value_name;
+};
+
+typedef struct {
+    char *key;
+    ExprId value;
+} ObjectField;
+
+/* 32 bytes: every child is an ExprId, and lists are ExprId arrays in the AST arena. */
 struct Expr {
     ExprKind kind;
     int line;
     int col;
+    int core; /* EXPR_CALL: CoreBuiltin the callee names, if the arity fits one */
     union {
         long long int_val;
         int bool_val;
         char *str_val;
         char *ident;
         struct {
-            Expr **items;
+            ExprId *items;
             int count;
         } array;
+        struct ArrayComp *array_comp;
         struct {
-            Expr *value_expr;
-            char *iter_name;
-            char *iter_value_name;
-            Expr *iter_expr;
-            Expr *filter_expr;
-        } array_comp;
-        struct {
-            char **keys;
-            Expr **values;
+            ObjectField *fields;
             int count;
         } object;
         struct {
-            Expr *left;
-            Expr *index;
+            ExprId left;
+            ExprId index;
         } index;
         struct {
-            Expr *left;
+            ExprId left;
             char *member;
         } dot;
         struct {
             TokenType op;
-            Expr *right;
+            ExprId right;
         } unary;
         struct {
-            Expr *left;
+            ExprId left;
             TokenType op;
-            Expr *right;
+            ExprId right;
         } binary;
         struct {
-            Expr *callee;
-            Expr **args;
+            ExprId callee;
             int argc;
+            ExprId *args;
         } call;
     } as;
 };
@@ -543,6 +681,18 @@ struct Block {
     Stmt **items;
     int count;
     int cap;
+    int may_capture; /* -1 until block_may_capture has looked */
+    int hot;         /* --tiered: calls into a function body, iterations of a loop body; -1 = stays put */
+};
+
+struct SwitchStmt {
+    ExprId value;
+    ExprId *case_values;
+    Block **case_blocks;
+    int case_count;
+    Block *default_block;
+    struct SwitchTable *table; /* see switch_table_for */
+    int table_checked;
 };
 
 struct Stmt {
@@ -552,45 +702,39 @@ struct Stmt {
     union {
         struct {
             char *name;
-            Expr *value;
+            ExprId value;
         } let_stmt;
         struct {
             char *name;
-            Expr *value;
+            ExprId value;
         } assign_stmt;
         struct {
-            Expr *object;
+            ExprId object;
             char *member;
-            Expr *value;
+            ExprId value;
         } set_member_stmt;
         struct {
-            Expr *object;
-            Expr *index;
-            Expr *value;
+            ExprId object;
+            ExprId index;
+            ExprId value;
         } set_index_stmt;
         struct {
-            Expr *expr;
+            ExprId expr;
         } expr_stmt;
         struct {
-            Expr *cond;
+            ExprId cond;
             Block *then_block;
             Block *else_block;
         } if_stmt;
+        struct SwitchStmt *switch_stmt;
         struct {
-            Expr *value;
-            Expr **case_values;
-            Block **case_blocks;
-            int case_count;
-            Block *default_block;
-        } switch_stmt;
-        struct {
-            Expr *cond;
+            ExprId cond;
             Block *body;
         } while_stmt;
         struct {
             char *iter_name;
             char *iter_value_name;
-            Expr *iter_expr;
+            ExprId iter_expr;
             Block *body;
         } for_stmt;
         struct {
@@ -603,7 +747,7 @@ struct Stmt {
         } module_stmt;
         struct {
             char *name;
-            Expr *value;
+            ExprId value;
         } type_stmt;
         struct {
             Block *try_block;
@@ -617,10 +761,11 @@ struct Stmt {
             Block *body;
         } fn_stmt;
         struct {
-            Expr *value;
+            ExprId value;
+            int tail_call; /* `return f(...)` in a function body, outside any try */
         } return_stmt;
         struct {
-            Expr *value;
+            ExprId value;
         } throw_stmt;
         struct {
             char *path;
@@ -628,16 +773,98 @@ struct Stmt {
     } as;
 };
 
-static Expr *new_expr(ExprKind kind, int line, int col) {
-    Expr *e = (Expr *)xmalloc(sizeof(Expr));
+/*
+ * Statements, blocks, child arrays, side records and names are bump-allocated in parse order from
+ * large chunks: a function body's nodes sit next to each other and carry no allocator headers
+ * (expressions have a table of their own, see new_expr).
+ * Nothing frees AST memory (bytecode, closures and Env bindings point into it), so chunks are
+ * never released before exit. Each -j parser thread fills chunks of its own.
+ */
+#define AST_CHUNK_SIZE (64 * 1024)
+
+static NYX_THREAD_LOCAL char *g_ast_chunk = NULL;
+static NYX_THREAD_LOCAL size_t g_ast_chunk_used = 0;
+static NYX_THREAD_LOCAL long long g_ast_bytes = 0; /* --ast-stats; workers add theirs when done */
+static NYX_THREAD_LOCAL long long g_ast_nodes = 0;
+static NYX_THREAD_LOCAL long long g_ast_lines = 0;
+
+static void *ast_alloc(size_t n) {
+    n = (n + 7) & ~(size_t)7;
+    g_ast_bytes += (long long)n;
+    if (n > AST_CHUNK_SIZE / 4) return xmalloc(n); /* oversized: a block of its own */
+    if (g_ast_chunk == NULL || g_ast_chunk_used + n > AST_CHUNK_SIZE) {
+        g_ast_chunk = (char *)xmalloc(AST_CHUNK_SIZE);
+        g_ast_chunk_used = 0;
+    }
+    void *out = g_ast_chunk + g_ast_chunk_used;
+    g_ast_chunk_used += n;
+    return out;
+}
+
+/* Moves a child array the parser grew on the heap into the arena. */
+static void *ast_seal(void *items, size_t bytes) {
+    if (items == NULL) return NULL;
+    void *out = ast_alloc(bytes);
+    memcpy(out, items, bytes);
+    xfree(items);
+    return out;
+}
+
+static char *ast_strndup(const char *text, size_t n) {
+    char *out = (char *)ast_alloc(n + 1);
+    memcpy(out, text, n);
+    out[n] = '\0';
+    return out;
+}
+
+/*
+ * Expressions sit in one table of fixed-size chunks and refer to each other by ExprId, a
+ * 32-bit index: the high bits pick the chunk and the low bits the slot. Chunks never move, so
+ * bytecode, caches and the JIT may keep Expr pointers. Each -j parser thread takes whole chunks
+ * and hands out the ids inside them on its own.
+ */
+#define EXPR_CHUNK_BITS 14
+#define EXPR_CHUNK_NODES (1u << EXPR_CHUNK_BITS)
+#define EXPR_CHUNK_MAX (1u << (32 - EXPR_CHUNK_BITS))
+
+static Expr *g_expr_chunks[EXPR_CHUNK_MAX];
+static unsigned g_expr_chunk_count = 0;
+static NYX_THREAD_LOCAL ExprId g_expr_next = 0; /* this thread's unused ids are [next, end) */
+static NYX_THREAD_LOCAL ExprId g_expr_end = 0;
+
+static Expr *expr_at(ExprId id) {
+    return id == 0 ? NULL : &g_expr_chunks[id >> EXPR_CHUNK_BITS][id & (EXPR_CHUNK_NODES - 1)];
+}
+
+static void expr_chunk_new(void) {
+    Expr *chunk = (Expr *)xmalloc((size_t)EXPR_CHUNK_NODES * sizeof(Expr));
+    alloc_lock();
+    unsigned k = g_expr_chunk_count++;
+    if (k < EXPR_CHUNK_MAX - 1) g_expr_chunks[k] = chunk;
+    alloc_unlock();
+    if (k >= EXPR_CHUNK_MAX - 1) {
+        fprintf(stderr, "Error: too many expressions\n");
+        exit(1);
+    }
+    g_expr_next = k == 0 ? 1 : (ExprId)k << EXPR_CHUNK_BITS; /* id 0 stays unused */
+    g_expr_end = (ExprId)(k + 1) << EXPR_CHUNK_BITS;
+}
+
+static ExprId new_expr(ExprKind kind, int line, int col) {
+    if (g_expr_next == g_expr_end) expr_chunk_new();
+    ExprId id = g_expr_next++;
+    Expr *e = expr_at(id);
+    g_ast_nodes++;
+    g_ast_bytes += (long long)sizeof(Expr);
     e->kind = kind;
     e->line = line;
     e->col = col;
-    return e;
+    return id;
 }
 
 static Stmt *new_stmt(StmtKind kind, int line, int col) {
-    Stmt *s = (Stmt *)xmalloc(sizeof(Stmt));
+    Stmt *s = (Stmt *)ast_alloc(sizeof(Stmt));
+    g_ast_nodes++;
     s->kind = kind;
     s->line = line;
     s->col = col;
@@ -645,10 +872,13 @@ static Stmt *new_stmt(StmtKind kind, int line, int col) {
 }
 
 static Block *new_block(void) {
-    Block *b = (Block *)xmalloc(sizeof(Block));
+    Block *b = (Block *)ast_alloc(sizeof(Block));
+    g_ast_nodes++;
     b->items = NULL;
     b->count = 0;
     b->cap = 0;
+    b->may_capture = -1;
+    b->hot = 0;
     return b;
 }
 
@@ -665,16 +895,30 @@ static void block_add_stmt(Block *b, Stmt *s) {
     b->items[b->count++] = s;
 }
 
+/* Once the parser is done adding statements. */
+static void block_seal(Block *b) {
+    b->items = (Stmt **)ast_seal(b->items, (size_t)b->count * sizeof(Stmt *));
+    b->cap = b->count;
+}
+
 typedef struct {
     Lexer lx;
     Token cur;
     Token peek;
+    int fn_depth;
+    int try_depth;
 } Parser;
 
+static char *token_strdup(const Parser *p, const Token *tok) {
+    return ast_strndup(token_chars(&p->lx, tok), tok->len);
+}
+
 static void parser_init(Parser *p, const char *source) {
     lexer_init(&p->lx, source);
     p->cur = lexer_next_token(&p->lx);
     p->peek = lexer_next_token(&p->lx);
+    p->fn_depth = 0;
+    p->try_depth = 0;
 }
 
 static void next_token(Parser *p) {
@@ -731,59 +975,66 @@ static int precedence(TokenType t) {
     }
 }
 
-static Expr *parse_expression(Parser *p, int prec);
+static ExprId parse_expression(Parser *p, int prec);
 
-static Expr *parse_array_literal(Parser *p) {
+static ExprId parse_array_literal(Parser *p) {
     int line = p->cur.line;
     int col = p->cur.col;
-    Expr *e = new_expr(EXPR_ARRAY, line, col);
-    e->as.array.items = NULL;
-    e->as.array.count = 0;
-
     next_token(p); /* first element or ] */
 
     if (p->cur.type == TOK_RBRACKET) {
+        ExprId e_id = new_expr(EXPR_ARRAY, line, col);
+        Expr *e = expr_at(e_id);
+        e->as.array.items = NULL;
+        e->as.array.count = 0;
         next_token(p);
-        return e;
+        return e_id;
     }
 
-    Expr *first = parse_expression(p, PREC_LOWEST);
+    ExprId first = parse_expression(p, PREC_LOWEST);
 
     if (p->cur.type == TOK_FOR) {
-        Expr *comp = new_expr(EXPR_ARRAY_COMP, line, col);
-        comp->as.array_comp.value_expr = first;
-        comp->as.array_comp.iter_value_name = NULL;
+        ExprId comp_id = new_expr(EXPR_ARRAY_COMP, line, col);
+        Expr *comp = expr_at(comp_id);
+        comp->as.array_comp = (struct ArrayComp *)ast_alloc(sizeof(struct ArrayComp));
+        comp->as.array_comp->value_expr = first;
+        comp->as.array_comp->iter_value_name = NULL;
 
         next_token(p);
         expect_current(p, TOK_IDENT, "expected iterator variable name after for");
-        comp->as.array_comp.iter_name = xstrdup(p->cur.text);
+        comp->as.array_comp->iter_name = token_strdup(p, &p->cur);
 
         next_token(p);
         if (p->cur.type == TOK_COMMA) {
             next_token(p);
             expect_current(p, TOK_IDENT, "expected second iterator variable name");
-            comp->as.array_comp.iter_value_name = xstrdup(p->cur.text);
+            comp->as.array_comp->iter_value_name = token_strdup(p, &p->cur);
             next_token(p);
         }
         expect_current(p, TOK_IN, "expected 'in' in array comprehension");
 
         next_token(p);
-        comp->as.array_comp.iter_expr = parse_expression(p, PREC_LOWEST);
-        comp->as.array_comp.filter_expr = NULL;
+        comp->as.array_comp->iter_expr = parse_expression(p, PREC_LOWEST);
+        comp->as.array_comp->filter_expr = 0;
 
         if (p->cur.type == TOK_IF) {
             next_token(p);
-            comp->as.array_comp.filter_expr = parse_expression(p, PREC_LOWEST);
+            comp->as.array_comp->filter_expr = parse_expression(p, PREC_LOWEST);
         }
 
         expect_current(p, TOK_RBRACKET, "expected ']' to close array comprehension");
         next_token(p);
-        return comp;
+        return comp_id;
     }
 
+    ExprId e_id = new_expr(EXPR_ARRAY, line, col);
+
+    Expr *e = expr_at(e_id);
+    e->as.array.items = NULL;
+    e->as.array.count = 0;
     while (1) {
         int idx = e->as.array.count;
-        e->as.array.items = (Expr **)xrealloc(e->as.array.items, (size_t)(idx + 1) * sizeof(Expr *));
+        e->as.array.items = (ExprId *)xrealloc(e->as.array.items, (size_t)(idx + 1) * sizeof(ExprId));
         e->as.array.items[idx] = first;
         e->as.array.count++;
 
@@ -794,27 +1045,28 @@ static Expr *parse_array_literal(Parser *p) {
 
     expect_current(p, TOK_RBRACKET, "expected ']' to close array literal");
     next_token(p);
-    return e;
+    e->as.array.items = (ExprId *)ast_seal(e->as.array.items, (size_t)e->as.array.count * sizeof(ExprId));
+    return e_id;
 }
 
-static Expr *parse_object_literal(Parser *p) {
+static ExprId parse_object_literal(Parser *p) {
     int line = p->cur.line;
     int col = p->cur.col;
-    Expr *e = new_expr(EXPR_OBJECT, line, col);
-    e->as.object.keys = NULL;
-    e->as.object.values = NULL;
+    ExprId e_id = new_expr(EXPR_OBJECT, line, col);
+    Expr *e = expr_at(e_id);
+    e->as.object.fields = NULL;
     e->as.object.count = 0;
 
     next_token(p); /* first key or } */
     if (p->cur.type == TOK_RBRACE) {
         next_token(p);
-        return e;
+        return e_id;
     }
 
     while (1) {
         char *key = NULL;
         if (p->cur.type == TOK_IDENT || p->cur.type == TOK_STRING) {
-            key = xstrdup(p->cur.text);
+            key = token_strdup(p, &p->cur);
         } else {
             die_at(p->cur.line, p->cur.col, "expected identifier or string as object key");
         }
@@ -823,12 +1075,11 @@ static Expr *parse_object_literal(Parser *p) {
         expect_current(p, TOK_COLON, "expected ':' after object key");
         next_token(p);
 
-        Expr *value = parse_expression(p, PREC_LOWEST);
+        ExprId value = parse_expression(p, PREC_LOWEST);
         int idx = e->as.object.count;
-        e->as.object.keys = (char **)xrealloc(e->as.object.keys, (size_t)(idx + 1) * sizeof(char *));
-        e->as.object.values = (Expr **)xrealloc(e->as.object.values, (size_t)(idx + 1) * sizeof(Expr *));
-        e->as.object.keys[idx] = key;
-        e->as.object.values[idx] = value;
+        e->as.object.fields = (ObjectField *)xrealloc(e->as.object.fields, (size_t)(idx + 1) * sizeof(ObjectField));
+        e->as.object.fields[idx].key = key;
+        e->as.object.fields[idx].value = value;
         e->as.object.count++;
 
         if (p->cur.type == TOK_COMMA) {
@@ -840,57 +1091,63 @@ static Expr *parse_object_literal(Parser *p) {
 
     expect_current(p, TOK_RBRACE, "expected '}' to close object literal");
     next_token(p);
-    return e;
+    e->as.object.fields = (ObjectField *)ast_seal(e->as.object.fields, (size_t)e->as.object.count * sizeof(ObjectField));
+    return e_id;
 }
 
-static Expr *parse_prefix(Parser *p) {
+static ExprId parse_prefix(Parser *p) {
     Token tok = p->cur;
 
     if (tok.type == TOK_INT) {
-        Expr *e = new_expr(EXPR_INT, tok.line, tok.col);
+        ExprId e_id = new_expr(EXPR_INT, tok.line, tok.col);
+        Expr *e = expr_at(e_id);
         e->as.int_val = tok.int_val;
         next_token(p);
-        return e;
+        return e_id;
     }
 
     if (tok.type == TOK_STRING) {
-        Expr *e = new_expr(EXPR_STRING, tok.line, tok.col);
-        e->as.str_val = xstrdup(tok.text);
+        ExprId e_id = new_expr(EXPR_STRING, tok.line, tok.col);
+        Expr *e = expr_at(e_id);
+        e->as.str_val = token_strdup(p, &tok);
         next_token(p);
-        return e;
+        return e_id;
     }
 
     if (tok.type == TOK_TRUE || tok.type == TOK_FALSE) {
-        Expr *e = new_expr(EXPR_BOOL, tok.line, tok.col);
+        ExprId e_id = new_expr(EXPR_BOOL, tok.line, tok.col);
+        Expr *e = expr_at(e_id);
         e->as.bool_val = (tok.type == TOK_TRUE) ? 1 : 0;
         next_token(p);
-        return e;
+        return e_id;
     }
 
     if (tok.type == TOK_NULL) {
-        Expr *e = new_expr(EXPR_NULL, tok.line, tok.col);
+        ExprId e_id = new_expr(EXPR_NULL, tok.line, tok.col);
         next_token(p);
-        return e;
+        return e_id;
     }
 
     if (tok.type == TOK_IDENT) {
-        Expr *e = new_expr(EXPR_IDENT, tok.line, tok.col);
-        e->as.ident = xstrdup(tok.text);
+        ExprId e_id = new_expr(EXPR_IDENT, tok.line, tok.col);
+        Expr *e = expr_at(e_id);
+        e->as.ident = token_strdup(p, &tok);
         next_token(p);
-        return e;
+        return e_id;
     }
 
     if (tok.type == TOK_MINUS || tok.type == TOK_BANG) {
-        Expr *e = new_expr(EXPR_UNARY, tok.line, tok.col);
+        ExprId e_id = new_expr(EXPR_UNARY, tok.line, tok.col);
+        Expr *e = expr_at(e_id);
         e->as.unary.op = tok.type;
         next_token(p);
         e->as.unary.right = parse_expression(p, PREC_PREFIX);
-        return e;
+        return e_id;
     }
 
     if (tok.type == TOK_LPAREN) {
         next_token(p);
-        Expr *inside = parse_expression(p, PREC_LOWEST);
+        ExprId inside = parse_expression(p, PREC_LOWEST);
         expect_current(p, TOK_RPAREN, "expected ')' ");
         next_token(p);
         return inside;
@@ -905,29 +1162,78 @@ static Expr *parse_prefix(Parser *p) {
     }
 
     die_at(tok.line, tok.col, "unexpected token in expression");
-    return NULL;
+    return 0;
 }
 
-static Expr *parse_call_expr(Parser *p, Expr *callee) {
+/*
+ * Builtins with their own opcodes (and, in the tree walker, a direct C call): a call whose callee
+ * is one of these names with a matching arity skips the lookup and the generic call machinery.
+ * Defining or assigning the name anywhere sets its bit in g_core_rebound, after which every such
+ * call goes back to looking the name up.
+ */
+typedef enum {
+    CORE_NONE,
+    CORE_LEN,
+    CORE_PUSH,
+    CORE_POP,
+    CORE_HAS,
+    CORE_OBJECT_GET,
+    CORE_RANGE
+} CoreBuiltin;
+
+static const char *const k_core_builtin_names[] = {NULL, "len", "push", "pop", "has", "object_get", "range"};
+static const int k_core_builtin_arity[] = {0, 1, 2, 1, 2, 2, 0};
+static unsigned g_core_rebound = 0;
+
+static int core_builtin_named(const char *name) {
+    int k;
+    switch (name[0]) {
+        case 'l': k = CORE_LEN; break;
+        case 'p': k = name[1] == 'u' ? CORE_PUSH : CORE_POP; break;
+        case 'h': k = CORE_HAS; break;
+        case 'o': k = CORE_OBJECT_GET; break;
+        case 'r': k = CORE_RANGE; break;
+        default: return CORE_NONE;
+    }
+    return strcmp(name, k_core_builtin_names[k]) == 0 ? k : CORE_NONE;
+}
+
+static int core_builtin_call(const Expr *call) {
+    const Expr *callee = expr_at(call->as.call.callee);
+    if (callee->kind != EXPR_IDENT) return CORE_NONE;
+    int k = core_builtin_named(callee->as.ident);
+    int argc = call->as.call.argc;
+    if (k == CORE_RANGE) return argc == 1 || argc == 2 ? k : CORE_NONE;
+    return k != CORE_NONE && argc == k_core_builtin_arity[k] ? k : CORE_NONE;
+}
+
+/* Whether `k` still names the builtin everywhere. */
+static int core_builtin_intact(int k) {
+    return k != CORE_NONE && !(g_core_rebound & (1u << k));
+}
+
+static ExprId parse_call_expr(Parser *p, ExprId callee) {
     int line = p->cur.line;
     int col = p->cur.col;
-    Expr *e = new_expr(EXPR_CALL, line, col);
+    ExprId e_id = new_expr(EXPR_CALL, line, col);
+    Expr *e = expr_at(e_id);
     e->as.call.callee = callee;
     e->as.call.args = NULL;
     e->as.call.argc = 0;
+    e->core = CORE_NONE;
 
     next_token(p); /* first arg or ) */
 
     if (p->cur.type == TOK_RPAREN) {
         next_token(p);
-        return e;
+        return e_id;
     }
 
     while (1) {
-        Expr *arg = parse_expression(p, PREC_LOWEST);
+        ExprId arg = parse_expression(p, PREC_LOWEST);
 
         int idx = e->as.call.argc;
-        e->as.call.args = (Expr **)xrealloc(e->as.call.args, (size_t)(idx + 1) * sizeof(Expr *));
+        e->as.call.args = (ExprId *)xrealloc(e->as.call.args, (size_t)(idx + 1) * sizeof(ExprId));
         if (!e->as.call.args) {
             fprintf(stderr, "Out of memory\n");
             exit(1);
@@ -944,13 +1250,16 @@ static Expr *parse_call_expr(Parser *p, Expr *callee) {
 
     expect_current(p, TOK_RPAREN, "expected ')' after call arguments");
     next_token(p);
-    return e;
+    e->as.call.args = (ExprId *)ast_seal(e->as.call.args, (size_t)e->as.call.argc * sizeof(ExprId));
+    e->core = core_builtin_call(e);
+    return e_id;
 }
 
-static Expr *parse_index_expr(Parser *p, Expr *left) {
+static ExprId parse_index_expr(Parser *p, ExprId left) {
     int line = p->cur.line;
     int col = p->cur.col;
-    Expr *e = new_expr(EXPR_INDEX, line, col);
+    ExprId e_id = new_expr(EXPR_INDEX, line, col);
+    Expr *e = expr_at(e_id);
     e->as.index.left = left;
 
     next_token(p);
@@ -958,37 +1267,40 @@ static Expr *parse_index_expr(Parser *p, Expr *left) {
 
     expect_current(p, TOK_RBRACKET, "expected ']' after index expression");
     next_token(p);
-    return e;
+    return e_id;
 }
 
-static Expr *parse_dot_expr(Parser *p, Expr *left) {
+static ExprId parse_dot_expr(Parser *p, ExprId left) {
     int line = p->cur.line;
     int col = p->cur.col;
-    Expr *e = new_expr(EXPR_DOT, line, col);
+    ExprId e_id = new_expr(EXPR_DOT, line, col);
+    Expr *e = expr_at(e_id);
     e->as.dot.left = left;
 
     next_token(p);
     expect_current(p, TOK_IDENT, "expected identifier after '.'");
-    e->as.dot.member = xstrdup(p->cur.text);
+    e->as.dot.member = token_strdup(p, &p->cur);
     next_token(p);
-    return e;
+    return e_id;
 }
 
-static Expr *parse_infix_expr(Parser *p, Expr *left) {
+static ExprId parse_infix_expr(Parser *p, ExprId left) {
     Token tok = p->cur;
     int op_prec = precedence(tok.type);
 
-    Expr *e = new_expr(EXPR_BINARY, tok.line, tok.col);
+    ExprId e_id = new_expr(EXPR_BINARY, tok.line, tok.col);
+
+    Expr *e = expr_at(e_id);
     e->as.binary.left = left;
     e->as.binary.op = tok.type;
 
     next_token(p);
     e->as.binary.right = parse_expression(p, op_prec);
-    return e;
+    return e_id;
 }
 
-static Expr *parse_expression(Parser *p, int prec) {
-    Expr *left = parse_prefix(p);
+static ExprId parse_expression(Parser *p, int prec) {
+    ExprId left = parse_prefix(p);
 
     while (p->cur.type != TOK_SEMI && p->cur.type != TOK_RPAREN && p->cur.type != TOK_RBRACKET &&
            p->cur.type != TOK_RBRACE && p->cur.type != TOK_COMMA && prec < precedence(p->cur.type)) {
@@ -1014,13 +1326,13 @@ static Stmt *parse_let_statement(Parser *p) {
 
     next_token(p);
     expect_current(p, TOK_IDENT, "expected identifier after let");
-    char *name = xstrdup(p->cur.text);
+    char *name = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_ASSIGN, "expected '=' after identifier");
 
     next_token(p);
-    Expr *value = parse_expression(p, PREC_LOWEST);
+    ExprId value = parse_expression(p, PREC_LOWEST);
 
     expect_current(p, TOK_SEMI, "expected ';' after let statement");
     next_token(p);
@@ -1036,7 +1348,7 @@ static Stmt *parse_return_statement(Parser *p) {
     int col = p->cur.col;
 
     next_token(p);
-    Expr *value = NULL;
+    ExprId value = 0;
     if (p->cur.type == TOK_SEMI) {
         value = new_expr(EXPR_NULL, line, col);
     } else {
@@ -1048,6 +1360,7 @@ static Stmt *parse_return_statement(Parser *p) {
 
     Stmt *s = new_stmt(STMT_RETURN, line, col);
     s->as.return_stmt.value = value;
+    s->as.return_stmt.tail_call = expr_at(value)->kind == EXPR_CALL && p->fn_depth > 0 && p->try_depth == 0;
     return s;
 }
 
@@ -1056,7 +1369,7 @@ static Stmt *parse_throw_statement(Parser *p) {
     int col = p->cur.col;
 
     next_token(p);
-    Expr *value = parse_expression(p, PREC_LOWEST);
+    ExprId value = parse_expression(p, PREC_LOWEST);
 
     expect_current(p, TOK_SEMI, "expected ';' after throw");
     next_token(p);
@@ -1072,7 +1385,7 @@ static Stmt *parse_import_statement(Parser *p) {
 
     next_token(p);
     expect_current(p, TOK_STRING, "expected string path in import statement");
-    char *path = xstrdup(p->cur.text);
+    char *path = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_SEMI, "expected ';' after import statement");
@@ -1091,7 +1404,7 @@ static Stmt *parse_if_statement(Parser *p) {
     expect_current(p, TOK_LPAREN, "expected '(' after if");
 
     next_token(p);
-    Expr *cond = parse_expression(p, PREC_LOWEST);
+    ExprId cond = parse_expression(p, PREC_LOWEST);
 
     expect_current(p, TOK_RPAREN, "expected ')' after if condition");
     next_token(p);
@@ -1106,6 +1419,7 @@ static Stmt *parse_if_statement(Parser *p) {
             Stmt *else_if_stmt = parse_if_statement(p);
             else_block = new_block();
             block_add_stmt(else_block, else_if_stmt);
+            block_seal(else_block);
         } else {
             expect_current(p, TOK_LBRACE, "expected '{' after else");
             else_block = parse_block(p);
@@ -1126,12 +1440,12 @@ static Stmt *parse_switch_statement(Parser *p) {
     next_token(p);
     expect_current(p, TOK_LPAREN, "expected '(' after switch");
     next_token(p);
-    Expr *value = parse_expression(p, PREC_LOWEST);
+    ExprId value = parse_expression(p, PREC_LOWEST);
     expect_current(p, TOK_RPAREN, "expected ')' after switch expression");
     next_token(p);
     expect_current(p, TOK_LBRACE, "expected '{' after switch(...)");
 
-    Expr **case_values = NULL;
+    ExprId *case_values = NULL;
     Block **case_blocks = NULL;
     int case_count = 0;
     Block *default_block = NULL;
@@ -1140,14 +1454,14 @@ static Stmt *parse_switch_statement(Parser *p) {
     while (p->cur.type != TOK_RBRACE && p->cur.type != TOK_EOF) {
         if (p->cur.type == TOK_CASE) {
             next_token(p);
-            Expr *case_value = parse_expression(p, PREC_LOWEST);
+            ExprId case_value = parse_expression(p, PREC_LOWEST);
             expect_current(p, TOK_COLON, "expected ':' after case expression");
             next_token(p);
             expect_current(p, TOK_LBRACE, "expected '{' after case label");
             Block *case_block = parse_block(p);
 
             int idx = case_count;
-            case_values = (Expr **)xrealloc(case_values, (size_t)(idx + 1) * sizeof(Expr *));
+            case_values = (ExprId *)xrealloc(case_values, (size_t)(idx + 1) * sizeof(ExprId));
             case_blocks = (Block **)xrealloc(case_blocks, (size_t)(idx + 1) * sizeof(Block *));
             case_values[idx] = case_value;
             case_blocks[idx] = case_block;
@@ -1172,11 +1486,14 @@ static Stmt *parse_switch_statement(Parser *p) {
     next_token(p);
 
     Stmt *s = new_stmt(STMT_SWITCH, line, col);
-    s->as.switch_stmt.value = value;
-    s->as.switch_stmt.case_values = case_values;
-    s->as.switch_stmt.case_blocks = case_blocks;
-    s->as.switch_stmt.case_count = case_count;
-    s->as.switch_stmt.default_block = default_block;
+    s->as.switch_stmt = (struct SwitchStmt *)ast_alloc(sizeof(struct SwitchStmt));
+    s->as.switch_stmt->value = value;
+    s->as.switch_stmt->case_values = (ExprId *)ast_seal(case_values, (size_t)case_count * sizeof(ExprId));
+    s->as.switch_stmt->case_blocks = (Block **)ast_seal(case_blocks, (size_t)case_count * sizeof(Block *));
+    s->as.switch_stmt->case_count = case_count;
+    s->as.switch_stmt->default_block = default_block;
+    s->as.switch_stmt->table = NULL;
+    s->as.switch_stmt->table_checked = 0;
     return s;
 }
 
@@ -1188,7 +1505,7 @@ static Stmt *parse_while_statement(Parser *p) {
     expect_current(p, TOK_LPAREN, "expected '(' after while");
 
     next_token(p);
-    Expr *cond = parse_expression(p, PREC_LOWEST);
+    ExprId cond = parse_expression(p, PREC_LOWEST);
 
     expect_current(p, TOK_RPAREN, "expected ')' after while condition");
     next_token(p);
@@ -1211,20 +1528,20 @@ static Stmt *parse_for_statement(Parser *p) {
 
     next_token(p);
     expect_current(p, TOK_IDENT, "expected iterator variable in for statement");
-    char *iter_name = xstrdup(p->cur.text);
+    char *iter_name = token_strdup(p, &p->cur);
     char *iter_value_name = NULL;
 
     next_token(p);
     if (p->cur.type == TOK_COMMA) {
         next_token(p);
         expect_current(p, TOK_IDENT, "expected second iterator variable in for statement");
-        iter_value_name = xstrdup(p->cur.text);
+        iter_value_name = token_strdup(p, &p->cur);
         next_token(p);
     }
     expect_current(p, TOK_IN, "expected 'in' in for statement");
 
     next_token(p);
-    Expr *iter_expr = parse_expression(p, PREC_LOWEST);
+    ExprId iter_expr = parse_expression(p, PREC_LOWEST);
 
     expect_current(p, TOK_RPAREN, "expected ')' after for iterator");
     next_token(p);
@@ -1246,7 +1563,9 @@ static Stmt *parse_try_statement(Parser *p) {
 
     next_token(p);
     expect_current(p, TOK_LBRACE, "expected '{' after try");
+    p->try_depth++;
     Block *try_block = parse_block(p);
+    p->try_depth--;
 
     expect_current(p, TOK_CATCH, "expected catch after try block");
     next_token(p);
@@ -1254,7 +1573,7 @@ static Stmt *parse_try_statement(Parser *p) {
 
     next_token(p);
     expect_current(p, TOK_IDENT, "expected catch variable name");
-    char *catch_name = xstrdup(p->cur.text);
+    char *catch_name = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_RPAREN, "expected ')' after catch variable");
@@ -1293,7 +1612,7 @@ static Stmt *parse_class_statement(Parser *p) {
     int col = p->cur.col;
     next_token(p);
     expect_current(p, TOK_IDENT, "expected class name after class");
-    char *name = xstrdup(p->cur.text);
+    char *name = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_LBRACE, "expected '{' after class name");
@@ -1310,7 +1629,7 @@ static Stmt *parse_module_statement(Parser *p) {
     int col = p->cur.col;
     next_token(p);
     expect_current(p, TOK_IDENT, "expected module name after module");
-    char *name = xstrdup(p->cur.text);
+    char *name = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_LBRACE, "expected '{' after module name");
@@ -1327,12 +1646,12 @@ static Stmt *parse_type_statement(Parser *p) {
     int col = p->cur.col;
     next_token(p);
     expect_current(p, TOK_IDENT, "expected type name after typealias");
-    char *name = xstrdup(p->cur.text);
+    char *name = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_ASSIGN, "expected '=' after type name");
     next_token(p);
-    Expr *value = parse_expression(p, PREC_LOWEST);
+    ExprId value = parse_expression(p, PREC_LOWEST);
     expect_current(p, TOK_SEMI, "expected ';' after type definition");
     next_token(p);
 
@@ -1348,7 +1667,7 @@ static Stmt *parse_fn_statement(Parser *p) {
 
     next_token(p);
     expect_current(p, TOK_IDENT, "expected function name after fn");
-    char *name = xstrdup(p->cur.text);
+    char *name = token_strdup(p, &p->cur);
 
     next_token(p);
     expect_current(p, TOK_LPAREN, "expected '(' after function name");
@@ -1366,7 +1685,7 @@ static Stmt *parse_fn_statement(Parser *p) {
                 fprintf(stderr, "Out of memory\n");
                 exit(1);
             }
-            params[param_count++] = xstrdup(p->cur.text);
+            params[param_count++] = token_strdup(p, &p->cur);
 
             next_token(p);
             if (p->cur.type == TOK_COMMA) {
@@ -1381,11 +1700,17 @@ static Stmt *parse_fn_statement(Parser *p) {
     next_token(p);
 
     expect_current(p, TOK_LBRACE, "expected '{' before function body");
+    /* A try around this fn statement does not cover calls made from its body. */
+    int saved_try_depth = p->try_depth;
+    p->try_depth = 0;
+    p->fn_depth++;
     Block *body = parse_block(p);
+    p->fn_depth--;
+    p->try_depth = saved_try_depth;
 
     Stmt *s = new_stmt(STMT_FN, line, col);
     s->as.fn_stmt.name = name;
-    s->as.fn_stmt.params = params;
+    s->as.fn_stmt.params = (char **)ast_seal(params, (size_t)param_count * sizeof(char *));
     s->as.fn_stmt.param_count = param_count;
     s->as.fn_stmt.body = body;
     return s;
@@ -1395,30 +1720,31 @@ static Stmt *parse_expr_or_assignment_statement(Parser *p) {
     int line = p->cur.line;
     int col = p->cur.col;
 
-    Expr *lhs = parse_expression(p, PREC_LOWEST);
+    ExprId lhs = parse_expression(p, PREC_LOWEST);
     if (p->cur.type == TOK_ASSIGN) {
         next_token(p);
-        Expr *value = parse_expression(p, PREC_LOWEST);
+        ExprId value = parse_expression(p, PREC_LOWEST);
         expect_current(p, TOK_SEMI, "expected ';' after assignment");
         next_token(p);
 
-        if (lhs->kind == EXPR_IDENT) {
+        const Expr *target = expr_at(lhs);
+        if (target->kind == EXPR_IDENT) {
             Stmt *s = new_stmt(STMT_ASSIGN, line, col);
-            s->as.assign_stmt.name = lhs->as.ident;
+            s->as.assign_stmt.name = target->as.ident;
             s->as.assign_stmt.value = value;
             return s;
         }
-        if (lhs->kind == EXPR_DOT) {
+        if (target->kind == EXPR_DOT) {
             Stmt *s = new_stmt(STMT_SET_MEMBER, line, col);
-            s->as.set_member_stmt.object = lhs->as.dot.left;
-            s->as.set_member_stmt.member = lhs->as.dot.member;
+            s->as.set_member_stmt.object = target->as.dot.left;
+            s->as.set_member_stmt.member = target->as.dot.member;
             s->as.set_member_stmt.value = value;
             return s;
         }
-        if (lhs->kind == EXPR_INDEX) {
+        if (target->kind == EXPR_INDEX) {
             Stmt *s = new_stmt(STMT_SET_INDEX, line, col);
-            s->as.set_index_stmt.object = lhs->as.index.left;
-            s->as.set_index_stmt.index = lhs->as.index.index;
+            s->as.set_index_stmt.object = target->as.index.left;
+            s->as.set_index_stmt.index = target->as.index.index;
             s->as.set_index_stmt.value = value;
             return s;
         }
@@ -1482,6 +1808,7 @@ static Block *parse_block(Parser *p) {
 
     expect_current(p, TOK_RBRACE, "expected '}' to close block");
     next_token(p);
+    block_seal(b);
     return b;
 }
 
@@ -1492,6 +1819,9 @@ static Block *parse_program(Parser *p) {
         block_add_stmt(program, parse_statement(p));
     }
 
+    block_seal(program);
+    /* lx.line already counts the empty line after a trailing newline */
+    g_ast_lines += p->lx.line - (p->lx.len > 0 && p->lx.src[p->lx.len - 1] == '\n');
     return program;
 }
 
@@ -1531,14 +1861,19 @@ struct Object {
     int count;
     int cap;
     ObjectKind kind;
+    unsigned version; /* bumped by every object_set; see class_member */
 };
 
+struct Bytecode;
+
 typedef struct {
     char **params;
     int param_count;
     Block *body;
     Env *closure;
     char *def_file;
+    struct Bytecode *code; /* frame bytecode for --vm, resolved on first call; see vm_function_code */
+    int code_resolved;
 } Function;
 
 typedef Value (*BuiltinFn)(Value *args, int argc, int line, int col, const char *current_file);
@@ -1571,10 +1906,16 @@ typedef struct ExceptionFrame ExceptionFrame;
 struct ExceptionFrame {
     jmp_buf env;
     ExceptionFrame *prev;
+    int vm_stack_count;
+    int vm_stack_base;
+    int vm_frame_count;
+    int call_depth;
+    int arg_top;
 };
 
+/* Names are borrowed from the AST or bytecode that defines them, which live for the whole run. */
 typedef struct {
-    char *name;
+    const char *name;
     Value value;
 } Binding;
 
@@ -1597,6 +1938,8 @@ static int g_trace = 0;
 static int g_use_vm = 0;
 static int g_vm_strict = 0;
 static int g_parse_only = 0;
+static int g_lex_bench = 0;
+static int g_ast_stats = 0;
 static int g_debug_enabled = 0;
 static int g_debug_step_mode = 0;
 static int g_debug_continue_mode = 1;
@@ -1607,12 +1950,22 @@ static int *g_debug_break_lines = NULL;
 static int g_debug_break_count = 0;
 static ExceptionFrame *g_exception_top = NULL;
 static Value g_exception_value;
+static int g_exception_line = 0; /* where g_exception_value was thrown, for a rethrow */
+static int g_exception_col = 0;
 static ImportSet *g_runtime_imports_ctx = NULL;
 static const char *g_runtime_file_ctx = NULL;
 static long long g_alloc_units = 0;
 static long long g_max_alloc_units = 10000000;
 static long long g_step_count = 0;
 static long long g_max_steps = 0;
+static long long g_stmt_count = 0;
+static int g_alloc_stats = 0;
+static int g_dump_bytecode = 0;
+static int g_profile_ops = 0;
+static int g_optimize = 0;
+static int g_tiered = 0; /* --tiered: warm functions and loops move from the AST walker to the VM */
+static int g_jit = 0; /* --jit: compile hot frame code to x86-64 (NYX_JIT builds only) */
+static const char *g_cache_dir = NULL; /* --cache-dir: where .nyc files live */
 static int g_call_depth = 0;
 static int g_max_call_depth = 10000;
 
@@ -1620,7 +1973,8 @@ typedef enum {
     CTRL_NONE = 0,
     CTRL_RETURN,
     CTRL_BREAK,
-    CTRL_CONTINUE
+    CTRL_CONTINUE,
+    CTRL_TAIL_CALL
 } ControlKind;
 
 typedef struct {
@@ -1628,6 +1982,45 @@ typedef struct {
     ControlKind control;
 } EvalResult;
 
+/* Operands of a pending `return f(...)`; set by STMT_RETURN, consumed by apply_function. */
+typedef struct {
+    Value callee;
+    Value *args; /* in `window`, from slot 1, or slot 0 when a method call put self there */
+    int argc;
+    Value *window; /* see arg_window_take */
+    int line;
+    int col;
+} TailCall;
+
+static TailCall g_tail_call;
+
+/*
+ * Argument windows for calls made from C: bump-allocated from one buffer that never moves, so
+ * a callee, or a builtin calling back into the interpreter, can keep using its arguments
+ * while nested calls take windows above them. Each window has argc + 1 slots with slot 0
+ * left free for a bound method's `self`. Windows that do not fit come from the heap.
+ */
+#define ARG_ARENA_SLOTS 65536
+static Value *g_arg_arena = NULL;
+static int g_arg_top = 0;
+
+static Value *arg_window_take(int argc) {
+    if (g_arg_arena == NULL) g_arg_arena = (Value *)xmalloc((size_t)ARG_ARENA_SLOTS * sizeof(Value));
+    if (g_arg_top + argc + 1 > ARG_ARENA_SLOTS) return (Value *)xmalloc((size_t)(argc + 1) * sizeof(Value));
+    Value *w = g_arg_arena + g_arg_top;
+    g_arg_top += argc + 1;
+    return w;
+}
+
+/* Also drops every window taken after `w`. */
+static void arg_window_drop(Value *w) {
+    if (w >= g_arg_arena && w < g_arg_arena + ARG_ARENA_SLOTS) {
+        g_arg_top = (int)(w - g_arg_arena);
+    } else {
+        xfree(w);
+    }
+}
+
 static void runtime_error(int line, int col, const char *msg);
 
 static Value value_null(void) {
@@ -1683,6 +2076,7 @@ static Object *object_new_kind(ObjectKind kind) {
     obj->count = 0;
     obj->cap = 0;
     obj->kind = kind;
+    obj->version = 0;
     return obj;
 }
 
@@ -1698,6 +2092,7 @@ static int object_find_index(Object *obj, const char *key) {
 }
 
 static void object_set(Object *obj, const char *key, Value value) {
+    obj->version++;
     int idx = object_find_index(obj, key);
     if (idx >= 0) {
         obj->items[idx].value = value;
@@ -1725,6 +2120,34 @@ static int object_has(Object *obj, const char *key) {
     return object_find_index(obj, key) >= 0;
 }
 
+/*
+ * Method resolution cache: (class, member) -> the class's entry for that member, valid while
+ * the class's version is unchanged. Member names come from the AST, bytecode or string values,
+ * none of which are ever freed, so their addresses are stable keys; two sites spelling the same
+ * name just use separate entries.
+ */
+#define METHOD_CACHE_SIZE 1024
+
+typedef struct {
+    Object *cls;
+    const char *member;
+    unsigned version;
+    Value value;
+} MethodCacheEntry;
+
+static MethodCacheEntry g_method_cache[METHOD_CACHE_SIZE];
+
+static Value class_member(Object *cls, const char *member) {
+    uintptr_t h = ((uintptr_t)cls >> 4) * 31u + ((uintptr_t)member >> 3);
+    MethodCacheEntry *e = &g_method_cache[h & (METHOD_CACHE_SIZE - 1)];
+    if (e->cls == cls && e->member == member && e->version == cls->version) return e->value;
+    e->cls = cls;
+    e->member = member;
+    e->version = cls->version;
+    e->value = object_get(cls, member);
+    return e->value;
+}
+
 static Value value_object(Object *obj) {
     Value v;
     v.type = VAL_OBJECT;
@@ -1762,6 +2185,8 @@ static void throw_value(int line, int col, Value value) {
         runtime_error(line, col, "uncaught exception");
     }
     g_exception_value = value;
+    g_exception_line = line;
+    g_exception_col = col;
     longjmp(g_exception_top->env, 1);
 }
 
@@ -1777,16 +2202,31 @@ static void step_guard(int line, int col) {
     }
 }
 
+/*
+ * Released Envs, kept with their binding arrays so a call or block that releases its Env
+ * hands the next one a ready-made scope instead of three allocations.
+ */
+#define ENV_POOL_MAX 256
+static Env *g_env_pool[ENV_POOL_MAX];
+static int g_env_pool_count = 0;
+
 static Env *env_new(Env *parent) {
-    Env *env = (Env *)xmalloc(sizeof(Env));
-    env->items = NULL;
+    Env *env;
+    if (g_env_pool_count > 0) {
+        env = g_env_pool[--g_env_pool_count];
+    } else {
+        env = (Env *)xmalloc(sizeof(Env));
+        env->items = NULL;
+        env->cap = 0;
+    }
     env->count = 0;
-    env->cap = 0;
     env->parent = parent;
     return env;
 }
 
 static void env_define(Env *env, const char *name, Value value) {
+    int core = core_builtin_named(name);
+    if (core != CORE_NONE) g_core_rebound |= 1u << core;
     for (int i = 0; i < env->count; i++) {
         if (strcmp(env->items[i].name, name) == 0) {
             env->items[i].value = value;
@@ -1804,7 +2244,7 @@ static void env_define(Env *env, const char *name, Value value) {
         env->cap = next_cap;
     }
 
-    env->items[env->count].name = xstrdup(name);
+    env->items[env->count].name = name;
     env->items[env->count].value = value;
     env->count++;
 }
@@ -1822,6 +2262,8 @@ static int env_get(Env *env, const char *name, Value *out) {
 }
 
 static int env_assign(Env *env, const char *name, Value value) {
+    int core = core_builtin_named(name);
+    if (core != CORE_NONE) g_core_rebound |= 1u << core;
     for (Env *cur = env; cur != NULL; cur = cur->parent) {
         for (int i = 0; i < cur->count; i++) {
             if (strcmp(cur->items[i].name, name) == 0) {
@@ -1833,6 +2275,86 @@ static int env_assign(Env *env, const char *name, Value value) {
     return 0;
 }
 
+/* One past the last index of a for loop over `iter`; an int is the stop of a counted range(). */
+static long long iter_bound(Value iter) {
+    if (iter.type == VAL_INT) return iter.as.int_val;
+    return iter.type == VAL_ARRAY ? iter.as.array_val->count : iter.as.object_val->count;
+}
+
+static void env_clear(Env *env) {
+    env->count = 0;
+}
+
+/*
+ * Readies the iteration Env of a loop whose body cannot capture it for the next pass: drops
+ * everything but its first `keep` bindings, the loop variables the caller rebinds.
+ */
+static void env_truncate(Env *env, int keep) {
+    if (env->count > keep) env->count = keep;
+}
+
+/* Only for Envs nothing can reference any more; see block_may_capture. */
+static void env_release(Env *env) {
+    if (g_env_pool_count < ENV_POOL_MAX) {
+        g_env_pool[g_env_pool_count++] = env;
+        return;
+    }
+    xfree(env->items);
+    xfree(env);
+}
+
+static void env_release_until(Env *env, Env *stop) {
+    while (env != stop) {
+        Env *parent = env->parent;
+        env_release(env);
+        env = parent;
+    }
+}
+
+/*
+ * An Env can only outlive its block through a closure: fn statements, and class, module and
+ * import bodies whose functions close over it. Blocks without any of those, at any nesting
+ * depth, leave their Envs unreachable once they finish.
+ */
+static int block_may_capture(Block *block) {
+    if (block->may_capture >= 0) return block->may_capture;
+    int capture = 0;
+    for (int i = 0; i < block->count && !capture; i++) {
+        Stmt *s = block->items[i];
+        switch (s->kind) {
+            case STMT_FN:
+            case STMT_CLASS:
+            case STMT_MODULE:
+            case STMT_IMPORT:
+                capture = 1;
+                break;
+            case STMT_IF:
+                capture = block_may_capture(s->as.if_stmt.then_block) ||
+                          (s->as.if_stmt.else_block && block_may_capture(s->as.if_stmt.else_block));
+                break;
+            case STMT_SWITCH:
+                for (int c = 0; c < s->as.switch_stmt->case_count && !capture; c++) {
+                    capture = block_may_capture(s->as.switch_stmt->case_blocks[c]);
+                }
+                if (s->as.switch_stmt->default_block && block_may_capture(s->as.switch_stmt->default_block)) capture = 1;
+                break;
+            case STMT_WHILE:
+                capture = block_may_capture(s->as.while_stmt.body);
+                break;
+            case STMT_FOR:
+                capture = block_may_capture(s->as.for_stmt.body);
+                break;
+            case STMT_TRY:
+                capture = block_may_capture(s->as.try_stmt.try_block) || block_may_capture(s->as.try_stmt.catch_block);
+                break;
+            default:
+                break;
+        }
+    }
+    block->may_capture = capture;
+    return capture;
+}
+
 static void import_set_add(ImportSet *set, const char *path) {
     if (set->count == set->cap) {
         int next_cap = set->cap == 0 ? 8 : set->cap * 2;
@@ -2148,6 +2670,144 @@ static int values_equal(Value a, Value b) {
     return 0;
 }
 
+/*
+ * Jump table for a switch whose labels are all int or string literals, built on first run
+ * (after -O has folded the labels). Ints from a tight enough range index `slots`; other ints
+ * and strings are kept sorted and bisected. A value maps to the first case with an equal
+ * label, exactly what the sequential values_equal scan would pick.
+ */
+typedef struct {
+    long long int_key;
+    const char *str_key;
+    int case_index;
+} SwitchKey;
+
+typedef struct SwitchTable {
+    long long min;  /* slots[v - min] is the case for int v, -1 for none */
+    long long span; /* 0 = the ints live in `ints` instead */
+    int *slots;
+    SwitchKey *ints;
+    int int_count;
+    SwitchKey *strs;
+    int str_count;
+} SwitchTable;
+
+static int switch_key_int_cmp(const void *a, const void *b) {
+    const SwitchKey *x = (const SwitchKey *)a;
+    const SwitchKey *y = (const SwitchKey *)b;
+    if (x->int_key != y->int_key) return x->int_key < y->int_key ? -1 : 1;
+    return x->case_index - y->case_index;
+}
+
+static int switch_key_str_cmp(const void *a, const void *b) {
+    const SwitchKey *x = (const SwitchKey *)a;
+    const SwitchKey *y = (const SwitchKey *)b;
+    int c = strcmp(x->str_key, y->str_key);
+    if (c != 0) return c;
+    return x->case_index - y->case_index;
+}
+
+/* Sorted by key then case index, so keeping the first of each run keeps the earliest case. */
+static int switch_keys_dedupe(SwitchKey *keys, int count, int is_str) {
+    int out = 0;
+    for (int i = 0; i < count; i++) {
+        if (out > 0 && (is_str ? strcmp(keys[out - 1].str_key, keys[i].str_key) == 0
+                               : keys[out - 1].int_key == keys[i].int_key)) {
+            continue;
+        }
+        keys[out++] = keys[i];
+    }
+    return out;
+}
+
+static SwitchTable *switch_table_for(Stmt *s) {
+    if (s->as.switch_stmt->table_checked) return s->as.switch_stmt->table;
+    s->as.switch_stmt->table_checked = 1;
+    int count = s->as.switch_stmt->case_count;
+    if (count == 0) return NULL;
+    for (int i = 0; i < count; i++) {
+        Expr *e = expr_at(s->as.switch_stmt->case_values[i]);
+        int literal = e->kind == EXPR_INT || e->kind == EXPR_STRING ||
+                      (e->kind == EXPR_UNARY && e->as.unary.op == TOK_MINUS && expr_at(e->as.unary.right)->kind == EXPR_INT);
+        if (!literal) return NULL;
+    }
+
+    SwitchTable *t = (SwitchTable *)xmalloc(sizeof(SwitchTable));
+    t->min = 0;
+    t->span = 0;
+    t->slots = NULL;
+    t->ints = (SwitchKey *)xmalloc((size_t)count * sizeof(SwitchKey));
+    t->strs = (SwitchKey *)xmalloc((size_t)count * sizeof(SwitchKey));
+    t->int_count = 0;
+    t->str_count = 0;
+    for (int i = 0; i < count; i++) {
+        Expr *e = expr_at(s->as.switch_stmt->case_values[i]);
+        if (e->kind == EXPR_STRING) {
+            SwitchKey *k = &t->strs[t->str_count++];
+            k->str_key = e->as.str_val;
+            k->case_index = i;
+        } else {
+            SwitchKey *k = &t->ints[t->int_count++];
+            k->int_key = e->kind == EXPR_INT ? e->as.int_val : -expr_at(e->as.unary.right)->as.int_val;
+            k->case_index = i;
+        }
+    }
+    qsort(t->ints, (size_t)t->int_count, sizeof(SwitchKey), switch_key_int_cmp);
+    qsort(t->strs, (size_t)t->str_count, sizeof(SwitchKey), switch_key_str_cmp);
+    t->int_count = switch_keys_dedupe(t->ints, t->int_count, 0);
+    t->str_count = switch_keys_dedupe(t->strs, t->str_count, 1);
+
+    if (t->int_count > 0) {
+        long long lo = t->ints[0].int_key;
+        long long hi = t->ints[t->int_count - 1].int_key;
+        /* Unsigned difference: the span of two arbitrary int64s can overflow a signed one. */
+        unsigned long long span = (unsigned long long)hi - (unsigned long long)lo + 1ULL;
+        if (span != 0 && span <= 4ULL * (unsigned long long)t->int_count + 16ULL) {
+            t->min = lo;
+            t->span = (long long)span;
+            t->slots = (int *)xmalloc((size_t)span * sizeof(int));
+            for (unsigned long long j = 0; j < span; j++) t->slots[j] = -1;
+            for (int i = 0; i < t->int_count; i++) {
+                t->slots[(unsigned long long)t->ints[i].int_key - (unsigned long long)lo] = t->ints[i].case_index;
+            }
+        }
+    }
+    s->as.switch_stmt->table = t;
+    return t;
+}
+
+/* Index of the case `v` selects, or -1 for the default. */
+static int switch_table_find(const SwitchTable *t, Value v) {
+    if (v.type == VAL_INT) {
+        if (t->span > 0) {
+            unsigned long long off = (unsigned long long)v.as.int_val - (unsigned long long)t->min;
+            return off < (unsigned long long)t->span ? t->slots[off] : -1;
+        }
+        int lo = 0;
+        int hi = t->int_count - 1;
+        while (lo <= hi) {
+            int mid = lo + (hi - lo) / 2;
+            long long k = t->ints[mid].int_key;
+            if (k == v.as.int_val) return t->ints[mid].case_index;
+            if (k < v.as.int_val) lo = mid + 1;
+            else hi = mid - 1;
+        }
+        return -1;
+    }
+    if (v.type == VAL_STRING) {
+        int lo = 0;
+        int hi = t->str_count - 1;
+        while (lo <= hi) {
+            int mid = lo + (hi - lo) / 2;
+            int c = strcmp(t->strs[mid].str_key, v.as.str_val);
+            if (c == 0) return t->strs[mid].case_index;
+            if (c < 0) lo = mid + 1;
+            else hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
 static int parse_int_value(const char *s, long long *out) {
     if (s == NULL) return 0;
 
@@ -2173,6 +2833,11 @@ static Value object_get_member_value(Value object_value, const char *member, int
 static Value apply_function(Value fn, Value *args, int argc, int line, int col, ImportSet *imports,
                             const char *current_file);
 static EvalResult eval_statement(Stmt *stmt, Env *env, ImportSet *imports, const char *current_file, int top_level);
+static void statement_prologue(Stmt *stmt, Env *env, const char *current_file);
+static const char *stmt_kind_name(StmtKind kind);
+static void set_index_value(Value left, Value idx, Value v, int line, int col);
+static struct Bytecode *vm_function_code(Function *f);
+static Value vm_call_compiled(Function *f, Env *call_env, ImportSet *imports);
 static EvalResult eval_block(Block *block, Env *env, ImportSet *imports, const char *current_file, int top_level);
 static EvalResult vm_eval_block(Block *block, Env *env, ImportSet *imports, const char *current_file, int top_level);
 
@@ -2604,14 +3269,14 @@ static Value builtin_new(Value *args, int argc, int line, int col, const char *c
     Value ctor = object_get(class_value.as.object_val, "init");
     if (ctor.type != VAL_NULL) {
         int call_argc = argc;
-        Value *call_args = (Value *)xmalloc((size_t)call_argc * sizeof(Value));
+        Value *call_args = arg_window_take(call_argc - 1);
         call_args[0] = instance_value;
         for (int i = 1; i < call_argc; i++) call_args[i] = args[i];
         Value ctor_out = apply_function(ctor, call_args, call_argc, line, col,
                                         g_runtime_imports_ctx ? g_runtime_imports_ctx : NULL,
                                         g_runtime_file_ctx ? g_runtime_file_ctx : current_file);
         (void)ctor_out;
-        xfree(call_args);
+        arg_window_drop(call_args);
     }
 
     return instance_value;
@@ -2677,18 +3342,9 @@ static Value class_call_dispatch(Value *args, int argc, int line, int col, const
     Value method = object_get_member_value(args[0], args[1].as.str_val, line, col);
     if (method.type == VAL_NULL) runtime_error(line, col, "class_call method not found");
 
-    int call_argc = argc - 2;
-    Value *call_args = NULL;
-    if (call_argc > 0) {
-        call_args = (Value *)xmalloc((size_t)call_argc * sizeof(Value));
-        for (int i = 0; i < call_argc; i++) call_args[i] = args[i + 2];
-    }
-
-    Value out = apply_function(method, call_args, call_argc, line, col,
-                               g_runtime_imports_ctx ? g_runtime_imports_ctx : NULL,
-                               g_runtime_file_ctx ? g_runtime_file_ctx : current_file);
-    xfree(call_args);
-    return out;
+    /* Argument arrays handed to builtins never move, so the method's arguments are used in place. */
+    return apply_function(method, args + 2, argc - 2, line, col, g_runtime_imports_ctx ? g_runtime_imports_ctx : NULL,
+                          g_runtime_file_ctx ? g_runtime_file_ctx : current_file);
 }
 
 static Value builtin_class_call0(Value *args, int argc, int line, int col, const char *current_file) {
@@ -2706,7 +3362,11 @@ static Value builtin_class_call2(Value *args, int argc, int line, int col, const
     return class_call_dispatch(args, argc, line, col, current_file);
 }
 
+static const BuiltinFn k_core_builtin_fns[] = {NULL,        builtin_len,        builtin_push, builtin_pop,
+                                               builtin_has, builtin_object_get, builtin_range};
+
 static void install_builtins(Env *env) {
+    unsigned rebound = g_core_rebound;
     env_define(env, "print", value_builtin(builtin_print));
     env_define(env, "len", value_builtin(builtin_len));
     env_define(env, "abs", value_builtin(builtin_abs));
@@ -2753,19 +3413,34 @@ static void install_builtins(Env *env) {
     env_define(env, "class_call2", value_builtin(builtin_class_call2));
     env_define(env, "lang_version", value_builtin(builtin_lang_version));
     env_define(env, "require_version", value_builtin(builtin_require_version));
+    g_core_rebound = rebound;
+}
+
+#ifndef TIER_UP_CALLS
+#define TIER_UP_CALLS 4
+#endif
+#ifndef TIER_UP_ITERATIONS
+#define TIER_UP_ITERATIONS 256
+#endif
+
+/* --tiered: counts one call or iteration of `body`; true once it has run `threshold` times. */
+static int tier_is_hot(Block *body, int threshold) {
+    if (body->hot < 0) return 0;
+    if (body->hot < threshold) body->hot++;
+    return body->hot >= threshold;
 }
 
 static Value apply_function(Value fn, Value *args, int argc, int line, int col, ImportSet *imports,
                             const char *current_file) {
     if (fn.type == VAL_BOUND_METHOD) {
         BoundMethod *bm = fn.as.bound_method_val;
-        Value *full_args = (Value *)xmalloc((size_t)(argc + 1) * sizeof(Value));
+        Value *full_args = arg_window_take(argc);
         full_args[0] = bm->self;
         for (int i = 0; i < argc; i++) {
             full_args[i + 1] = args[i];
         }
         Value out = apply_function(bm->fn, full_args, argc + 1, line, col, imports, current_file);
-        xfree(full_args);
+        arg_window_drop(full_args);
         return out;
     }
 
@@ -2792,14 +3467,58 @@ static Value apply_function(Value fn, Value *args, int argc, int line, int col,
         runtime_error(line, col, "max call depth exceeded");
     }
 
+    /*
+     * Tail calls come back here as CTRL_TAIL_CALL and run in the same activation: the depth
+     * stays put and, when the finished body cannot have captured it, the Env is reused.
+     */
     Env *call_env = env_new(f->closure);
-    for (int i = 0; i < f->param_count; i++) {
-        env_define(call_env, f->params[i], args[i]);
-    }
+    Value *owned_args = NULL;
+    EvalResult r;
+    for (;;) {
+        for (int i = 0; i < f->param_count; i++) {
+            env_define(call_env, f->params[i], args[i]);
+        }
+        if (owned_args != NULL) arg_window_drop(owned_args);
+        owned_args = NULL;
+        if ((g_use_vm || (g_tiered && tier_is_hot(f->body, TIER_UP_CALLS))) && vm_function_code(f) != NULL) {
+            return vm_call_compiled(f, call_env, imports);
+        }
 
-    EvalResult r = g_use_vm ? vm_eval_block(f->body, call_env, imports, f->def_file, 0)
-                            : eval_block(f->body, call_env, imports, f->def_file, 0);
+        r = g_use_vm ? vm_eval_block(f->body, call_env, imports, f->def_file, 0)
+                     : eval_block(f->body, call_env, imports, f->def_file, 0);
+        if (r.control != CTRL_TAIL_CALL) break;
+
+        TailCall tc = g_tail_call;
+        int reuse = !block_may_capture(f->body);
+        Value *tc_block = tc.window;
+        if (tc.callee.type == VAL_BOUND_METHOD && tc.callee.as.bound_method_val->fn.type == VAL_FUNCTION &&
+            tc.args != tc.window) {
+            tc.args[-1] = tc.callee.as.bound_method_val->self;
+            tc.args--;
+            tc.argc++;
+            tc.callee = tc.callee.as.bound_method_val->fn;
+        }
+        if (tc.callee.type != VAL_FUNCTION) {
+            g_call_depth--;
+            if (reuse) env_release(call_env);
+            Value out = apply_function(tc.callee, tc.args, tc.argc, tc.line, tc.col, imports, f->def_file);
+            arg_window_drop(tc_block);
+            return out;
+        }
+        f = tc.callee.as.fn_val;
+        if (tc.argc != f->param_count) runtime_error(tc.line, tc.col, "wrong number of function arguments");
+        if (reuse) {
+            env_clear(call_env);
+            call_env->parent = f->closure;
+        } else {
+            call_env = env_new(f->closure);
+        }
+        args = tc.args;
+        owned_args = tc_block;
+        argc = tc.argc;
+    }
     g_call_depth--;
+    if (!block_may_capture(f->body)) env_release(call_env);
     if (r.control == CTRL_RETURN) return r.value;
     if (r.control == CTRL_BREAK || r.control == CTRL_CONTINUE) {
         runtime_error(line, col, "break/continue not allowed outside loops");
@@ -2807,35 +3526,52 @@ static Value apply_function(Value fn, Value *args, int argc, int line, int col,
     return value_null();
 }
 
-static Value object_get_member_value(Value object_value, const char *member, int line, int col) {
+/*
+ * Resolves `object.member` for a call: returns the callee and sets *bind when the object has
+ * to be passed as its first argument, which is where a plain read wraps both in a BoundMethod.
+ */
+static Value object_get_method(Value object_value, const char *member, int *bind, int line, int col) {
     if (object_value.type != VAL_OBJECT) {
         runtime_error(line, col, "member access expects object value");
     }
 
     Object *obj = object_value.as.object_val;
-    Value v = object_get(obj, member);
-    if (v.type != VAL_NULL) {
-        if ((obj->kind == OBJ_PLAIN || obj->kind == OBJ_INSTANCE) &&
-            (v.type == VAL_FUNCTION || v.type == VAL_BUILTIN || v.type == VAL_BOUND_METHOD)) {
-            return value_bound_method(object_value, v);
+    *bind = 0;
+    if (obj->kind != OBJ_INSTANCE) {
+        Value v = object_get(obj, member);
+        if (obj->kind == OBJ_PLAIN && (v.type == VAL_FUNCTION || v.type == VAL_BUILTIN || v.type == VAL_BOUND_METHOD)) {
+            *bind = 1;
         }
         return v;
     }
 
-    if (obj->kind == OBJ_INSTANCE && object_has(obj, "__class__")) {
-        Value cls = object_get(obj, "__class__");
-        if (cls.type == VAL_OBJECT) {
-            Value mv = object_get(cls.as.object_val, member);
-            if (mv.type == VAL_FUNCTION || mv.type == VAL_BUILTIN || mv.type == VAL_BOUND_METHOD) {
-                return value_bound_method(object_value, mv);
-            }
-            return mv;
+    /* One pass over the instance finds both its own entry and its __class__. */
+    Value cls = value_null();
+    for (int i = 0; i < obj->count; i++) {
+        const ObjectEntry *e = &obj->items[i];
+        if (strcmp(e->key, member) == 0) {
+            if (e->value.type == VAL_NULL) continue;
+            *bind = e->value.type == VAL_FUNCTION || e->value.type == VAL_BUILTIN || e->value.type == VAL_BOUND_METHOD;
+            return e->value;
         }
+        if (cls.type == VAL_NULL && strcmp(e->key, "__class__") == 0) cls = e->value;
+    }
+
+    if (cls.type == VAL_OBJECT) {
+        Value mv = class_member(cls.as.object_val, member);
+        *bind = mv.type == VAL_FUNCTION || mv.type == VAL_BUILTIN || mv.type == VAL_BOUND_METHOD;
+        return mv;
     }
 
     return value_null();
 }
 
+static Value object_get_member_value(Value object_value, const char *member, int line, int col) {
+    int bind;
+    Value v = object_get_method(object_value, member, &bind, line, col);
+    return bind ? value_bound_method(object_value, v) : v;
+}
+
 static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char *current_file) {
     switch (expr->kind) {
         case EXPR_INT:
@@ -2857,29 +3593,29 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
             int n = expr->as.array.count;
             Value *items = (Value *)xmalloc((size_t)n * sizeof(Value));
             for (int i = 0; i < n; i++) {
-                items[i] = eval_expr_ast(expr->as.array.items[i], env, imports, current_file);
+                items[i] = eval_expr_ast(expr_at(expr->as.array.items[i]), env, imports, current_file);
             }
             return value_array(items, n);
         }
         case EXPR_ARRAY_COMP: {
-            Value iter = eval_expr_ast(expr->as.array_comp.iter_expr, env, imports, current_file);
+            Value iter = eval_expr_ast(expr_at(expr->as.array_comp->iter_expr), env, imports, current_file);
             Value *items = NULL;
             int count = 0;
 
             if (iter.type == VAL_ARRAY) {
                 for (int i = 0; i < iter.as.array_val->count; i++) {
                     Env *loop_env = env_new(env);
-                    if (expr->as.array_comp.iter_value_name != NULL) {
-                        env_define(loop_env, expr->as.array_comp.iter_name, value_int(i));
-                        env_define(loop_env, expr->as.array_comp.iter_value_name, iter.as.array_val->items[i]);
+                    if (expr->as.array_comp->iter_value_name != NULL) {
+                        env_define(loop_env, expr->as.array_comp->iter_name, value_int(i));
+                        env_define(loop_env, expr->as.array_comp->iter_value_name, iter.as.array_val->items[i]);
                     } else {
-                        env_define(loop_env, expr->as.array_comp.iter_name, iter.as.array_val->items[i]);
+                        env_define(loop_env, expr->as.array_comp->iter_name, iter.as.array_val->items[i]);
                     }
-                    if (expr->as.array_comp.filter_expr != NULL) {
-                        Value keep = eval_expr_ast(expr->as.array_comp.filter_expr, loop_env, imports, current_file);
+                    if (expr->as.array_comp->filter_expr != 0) {
+                        Value keep = eval_expr_ast(expr_at(expr->as.array_comp->filter_expr), loop_env, imports, current_file);
                         if (!is_truthy(keep)) continue;
                     }
-                    Value outv = eval_expr_ast(expr->as.array_comp.value_expr, loop_env, imports, current_file);
+                    Value outv = eval_expr_ast(expr_at(expr->as.array_comp->value_expr), loop_env, imports, current_file);
                     items = (Value *)xrealloc(items, (size_t)(count + 1) * sizeof(Value));
                     items[count++] = outv;
                 }
@@ -2890,17 +3626,17 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
                 Object *obj = iter.as.object_val;
                 for (int i = 0; i < obj->count; i++) {
                     Env *loop_env = env_new(env);
-                    if (expr->as.array_comp.iter_value_name != NULL) {
-                        env_define(loop_env, expr->as.array_comp.iter_name, value_string(obj->items[i].key));
-                        env_define(loop_env, expr->as.array_comp.iter_value_name, obj->items[i].value);
+                    if (expr->as.array_comp->iter_value_name != NULL) {
+                        env_define(loop_env, expr->as.array_comp->iter_name, value_string(obj->items[i].key));
+                        env_define(loop_env, expr->as.array_comp->iter_value_name, obj->items[i].value);
                     } else {
-                        env_define(loop_env, expr->as.array_comp.iter_name, value_string(obj->items[i].key));
+                        env_define(loop_env, expr->as.array_comp->iter_name, value_string(obj->items[i].key));
                     }
-                    if (expr->as.array_comp.filter_expr != NULL) {
-                        Value keep = eval_expr_ast(expr->as.array_comp.filter_expr, loop_env, imports, current_file);
+                    if (expr->as.array_comp->filter_expr != 0) {
+                        Value keep = eval_expr_ast(expr_at(expr->as.array_comp->filter_expr), loop_env, imports, current_file);
                         if (!is_truthy(keep)) continue;
                     }
-                    Value outv = eval_expr_ast(expr->as.array_comp.value_expr, loop_env, imports, current_file);
+                    Value outv = eval_expr_ast(expr_at(expr->as.array_comp->value_expr), loop_env, imports, current_file);
                     items = (Value *)xrealloc(items, (size_t)(count + 1) * sizeof(Value));
                     items[count++] = outv;
                 }
@@ -2913,14 +3649,14 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
         case EXPR_OBJECT: {
             Object *obj = object_new();
             for (int i = 0; i < expr->as.object.count; i++) {
-                Value v = eval_expr_ast(expr->as.object.values[i], env, imports, current_file);
-                object_set(obj, expr->as.object.keys[i], v);
+                Value v = eval_expr_ast(expr_at(expr->as.object.fields[i].value), env, imports, current_file);
+                object_set(obj, expr->as.object.fields[i].key, v);
             }
             return value_object(obj);
         }
         case EXPR_INDEX: {
-            Value left = eval_expr_ast(expr->as.index.left, env, imports, current_file);
-            Value idx = eval_expr_ast(expr->as.index.index, env, imports, current_file);
+            Value left = eval_expr_ast(expr_at(expr->as.index.left), env, imports, current_file);
+            Value idx = eval_expr_ast(expr_at(expr->as.index.index), env, imports, current_file);
             if (left.type == VAL_ARRAY && idx.type == VAL_INT) {
                 if (idx.as.int_val < 0 || idx.as.int_val >= left.as.array_val->count) {
                     return value_null();
@@ -2934,11 +3670,11 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
             return value_null();
         }
         case EXPR_DOT: {
-            Value left = eval_expr_ast(expr->as.dot.left, env, imports, current_file);
+            Value left = eval_expr_ast(expr_at(expr->as.dot.left), env, imports, current_file);
             return object_get_member_value(left, expr->as.dot.member, expr->line, expr->col);
         }
         case EXPR_UNARY: {
-            Value right = eval_expr_ast(expr->as.unary.right, env, imports, current_file);
+            Value right = eval_expr_ast(expr_at(expr->as.unary.right), env, imports, current_file);
             if (expr->as.unary.op == TOK_MINUS) {
                 if (right.type != VAL_INT) runtime_error(expr->line, expr->col, "unary '-' expects integer");
                 return value_int(-right.as.int_val);
@@ -2950,26 +3686,27 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
             return value_null();
         }
         case EXPR_BINARY: {
-            Value left = eval_expr_ast(expr->as.binary.left, env, imports, current_file);
+            Value left = eval_expr_ast(expr_at(expr->as.binary.left), env, imports, current_file);
             TokenType op = expr->as.binary.op;
 
             if (op == TOK_ANDAND) {
-                Value right = eval_expr_ast(expr->as.binary.right, env, imports, current_file);
-                return value_bool(is_truthy(left) && is_truthy(right));
+                if (!is_truthy(left)) return value_bool(0);
+                Value right = eval_expr_ast(expr_at(expr->as.binary.right), env, imports, current_file);
+                return value_bool(is_truthy(right));
             }
 
             if (op == TOK_OROR) {
-                Value right = eval_expr_ast(expr->as.binary.right, env, imports, current_file);
-                return value_bool(is_truthy(left) || is_truthy(right));
+                if (is_truthy(left)) return value_bool(1);
+                Value right = eval_expr_ast(expr_at(expr->as.binary.right), env, imports, current_file);
+                return value_bool(is_truthy(right));
             }
 
             if (op == TOK_COALESCE) {
-                Value right = eval_expr_ast(expr->as.binary.right, env, imports, current_file);
                 if (left.type != VAL_NULL) return left;
-                return right;
+                return eval_expr_ast(expr_at(expr->as.binary.right), env, imports, current_file);
             }
 
-            Value right = eval_expr_ast(expr->as.binary.right, env, imports, current_file);
+            Value right = eval_expr_ast(expr_at(expr->as.binary.right), env, imports, current_file);
 
             if (op == TOK_PLUS) {
                 if (left.type == VAL_INT && right.type == VAL_INT) {
@@ -2984,12 +3721,13 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
                 runtime_error(expr->line, expr->col, "'+' expects int+int or string+string");
             }
 
-            if (op == TOK_MINUS || op == TOK_STAR || op == TOK_SLASH || op == TOK_PERCENT) {
+            if (op == TOK_MINUS || op == TOK_STAR || op == TOK_SLASH || op == TOK_PERCENT || op == TOK_SHL) {
                 if (left.type != VAL_INT || right.type != VAL_INT) {
                     runtime_error(expr->line, expr->col, "arithmetic expects integers");
                 }
                 if (op == TOK_MINUS) return value_int(left.as.int_val - right.as.int_val);
                 if (op == TOK_STAR) return value_int(left.as.int_val * right.as.int_val);
+                if (op == TOK_SHL) return value_int((long long)((unsigned long long)left.as.int_val << right.as.int_val));
                 if (right.as.int_val == 0) runtime_error(expr->line, expr->col, "division by zero");
                 if (op == TOK_SLASH) return value_int(left.as.int_val / right.as.int_val);
                 return value_int(left.as.int_val % right.as.int_val);
@@ -3012,17 +3750,37 @@ static Value eval_expr_ast(Expr *expr, Env *env, ImportSet *imports, const char
             return value_null();
         }
         case EXPR_CALL: {
-            Value callee = eval_expr_ast(expr->as.call.callee, env, imports, current_file);
+            Expr *callee_expr = expr_at(expr->as.call.callee);
+            Value callee;
+            Value self = value_null();
+            int bind = 0;
+            if (callee_expr->kind == EXPR_DOT) {
+                /* obj.m(...) calls m with obj in front of the arguments, without a BoundMethod. */
+                self = eval_expr_ast(expr_at(callee_expr->as.dot.left), env, imports, current_file);
+                callee = object_get_method(self, callee_expr->as.dot.member, &bind, callee_expr->line, callee_expr->col);
+            } else if (core_builtin_intact(expr->core)) {
+                callee = value_builtin(k_core_builtin_fns[expr->core]);
+            } else {
+                callee = eval_expr_ast(callee_expr, env, imports, current_file);
+            }
             int argc = expr->as.call.argc;
-            Value *args = NULL;
-            if (argc > 0) {
-                args = (Value *)xmalloc((size_t)argc * sizeof(Value));
-                for (int i = 0; i < argc; i++) {
-                    args[i] = eval_expr_ast(expr->as.call.args[i], env, imports, current_file);
-                }
+            Value *slots = arg_window_take(argc);
+            Value *args = slots + 1;
+            for (int i = 0; i < argc; i++) {
+                args[i] = eval_expr_ast(expr_at(expr->as.call.args[i]), env, imports, current_file);
+            }
+            if (bind) {
+                slots[0] = self;
+                args = slots;
+                argc++;
+            } else if (callee.type == VAL_BOUND_METHOD && callee.as.bound_method_val->fn.type == VAL_FUNCTION) {
+                slots[0] = callee.as.bound_method_val->self;
+                callee = callee.as.bound_method_val->fn;
+                args = slots;
+                argc++;
             }
             Value out = apply_function(callee, args, argc, expr->line, expr->col, imports, current_file);
-            xfree(args);
+            arg_window_drop(slots);
             return out;
         }
     }
@@ -3038,11 +3796,15 @@ typedef enum {
     BC_PUSH_NULL,
     BC_LOAD,
     BC_ARRAY_MAKE,
-    BC_ARRAY_COMP,
+    BC_COMP_INIT,
+    BC_COMP_NEXT,
+    BC_COMP_APPEND,
+    BC_COMP_END,
     BC_OBJECT_NEW,
     BC_OBJECT_SET_KEY,
     BC_INDEX_GET,
     BC_DOT_GET,
+    BC_METHOD_GET,
     BC_NEG,
     BC_NOT,
     BC_ADD,
@@ -3050,30 +3812,121 @@ typedef enum {
     BC_MUL,
     BC_DIV,
     BC_MOD,
+    BC_SHL,
     BC_EQ,
     BC_NEQ,
-    BC_AND,
-    BC_OR,
-    BC_COALESCE,
+    BC_TO_BOOL,
+    BC_JUMP_IF_FALSE_KEEP,
+    BC_JUMP_IF_TRUE_KEEP,
+    BC_JUMP_IF_NOT_NULL,
     BC_LT,
     BC_GT,
     BC_LE,
     BC_GE,
-    BC_CALL
+    BC_CALL,
+    BC_CALL_METHOD,
+    /* Calls of the core builtins, in CoreBuiltin order: operands only, no callee; see vm_core_builtin. */
+    BC_CORE_LEN,
+    BC_CORE_PUSH,
+    BC_CORE_POP,
+    BC_CORE_HAS,
+    BC_CORE_OBJECT_GET,
+    /* Statement forms, only emitted into function frame code; see compile_fn_stmt. */
+    BC_STMT,
+    BC_EXEC_STMT,
+    BC_EVAL_EXPR,
+    BC_POP,
+    BC_DUP,
+    BC_DEFINE,
+    BC_ASSIGN,
+    BC_SET_MEMBER,
+    BC_SET_INDEX,
+    BC_JUMP,
+    BC_JUMP_IF_FALSE,
+    BC_SWITCH_TABLE,
+    BC_ENV_PUSH,
+    BC_ENV_POP,
+    BC_ENV_RESET,
+    BC_RANGE_INIT,
+    BC_ITER_INIT,
+    BC_ITER_NEXT,
+    BC_ITER_BIND,
+    BC_RETURN,
+    BC_TAIL_CALL,
+    BC_TAIL_CALL_METHOD,
+    BC_THROW,
+    BC_INLINE_ENTER,
+    BC_INLINE_LEAVE,
+    /* Superinstructions produced by bytecode_peephole; see k_peephole_rules. */
+    BC_ADD_LOCAL_IMM,
+    BC_SUB_LOCAL_IMM,
+    BC_LT_LOCAL_IMM,
+    BC_LT_LOCAL_LOCAL,
+    BC_LOAD_DOT,
+    /* Int-specialised forms installed by operand-type feedback; see bytecode_feedback. */
+    BC_ADD_II,
+    BC_SUB_II,
+    BC_MUL_II,
+    BC_LT_II,
+    BC_GT_II,
+    BC_LE_II,
+    BC_GE_II,
+    BC_OP_COUNT
 } BytecodeOp;
 
+static const char *const k_bytecode_op_names[BC_OP_COUNT] = {
+    "PUSH_INT",      "PUSH_STRING",   "PUSH_BOOL",     "PUSH_NULL",     "LOAD",
+    "ARRAY_MAKE",    "COMP_INIT",     "COMP_NEXT",     "COMP_APPEND",   "COMP_END",
+    "OBJECT_NEW",    "OBJECT_SET_KEY", "INDEX_GET",
+    "DOT_GET",       "METHOD_GET",    "NEG",           "NOT",           "ADD",           "SUB",
+    "MUL",           "DIV",           "MOD",           "SHL",           "EQ",            "NEQ",
+    "TO_BOOL",       "JUMP_IF_FALSE_KEEP", "JUMP_IF_TRUE_KEEP", "JUMP_IF_NOT_NULL", "LT",
+    "GT",            "LE",            "GE",            "CALL",          "CALL_METHOD",   "CORE_LEN",
+    "CORE_PUSH",     "CORE_POP",      "CORE_HAS",      "CORE_OBJECT_GET", "STMT",
+    "EXEC_STMT",     "EVAL_EXPR",     "POP",           "DUP",           "DEFINE",
+    "ASSIGN",        "SET_MEMBER",    "SET_INDEX",     "JUMP",          "JUMP_IF_FALSE",
+    "SWITCH_TABLE",  "ENV_PUSH",      "ENV_POP",       "ENV_RESET",     "RANGE_INIT",    "ITER_INIT",     "ITER_NEXT",
+    "ITER_BIND",     "RETURN",        "TAIL_CALL",     "TAIL_CALL_METHOD", "THROW",      "INLINE_ENTER",
+    "INLINE_LEAVE",  "ADD_LOCAL_IMM", "SUB_LOCAL_IMM", "LT_LOCAL_IMM",  "LT_LOCAL_LOCAL",
+    "LOAD_DOT",      "ADD_II",        "SUB_II",        "MUL_II",        "LT_II",
+    "GT_II",         "LE_II",         "GE_II",
+};
+
 typedef struct {
     BytecodeOp op;
     long long iarg;
     const char *sarg;
+    const char *sarg2;
     int line;
     int col;
+    int feedback;
+    void *aux; /* INLINE_ENTER/INLINE_LEAVE: their InlineSite; SWITCH_TABLE: its SwitchTable */
 } BytecodeInstr;
 
+/* One per inlined call site: the inlined body and its reusable Env. */
+typedef struct {
+    const Block *body;
+    Env *spare; /* the Env of the last finished call, or NULL */
+} InlineSite;
+
+/* try/catch in frame code: a throw at a pc in [start, end) resumes at `target` with the value pushed. */
 typedef struct {
+    int start;
+    int end;
+    int target;
+    int env_depth;   /* Envs above the frame's base Env when the try began */
+    int stack_depth; /* operand slots live at the try: two per enclosing for loop */
+} BytecodeHandler;
+
+typedef struct Bytecode {
     BytecodeInstr *items;
     int count;
     int cap;
+    BytecodeHandler *handlers; /* innermost try first */
+    int handler_count;
+    int handler_cap;
+    int hot;             /* --jit: calls so far; -1 once compiled or rejected */
+    struct JitCode *jit; /* --jit: native code for this frame code, see jit_compile */
 } Bytecode;
 
 typedef struct {
@@ -3081,7 +3934,7 @@ typedef struct {
     Bytecode code;
 } ExprVmCacheEntry;
 
-static ExprVmCacheEntry *g_expr_vm_cache = NULL;
+static ExprVmCacheEntry **g_expr_vm_cache = NULL; /* one allocation per entry: running frames hold Bytecode pointers */
 static int g_expr_vm_cache_count = 0;
 static int g_expr_vm_cache_cap = 0;
 
@@ -3095,33 +3948,34 @@ static int expr_vm_supported(Expr *expr) {
             return 1;
         case EXPR_ARRAY:
             for (int i = 0; i < expr->as.array.count; i++) {
-                if (!expr_vm_supported(expr->as.array.items[i])) return 0;
+                if (!expr_vm_supported(expr_at(expr->as.array.items[i]))) return 0;
             }
             return 1;
         case EXPR_ARRAY_COMP:
-            if (!expr_vm_supported(expr->as.array_comp.value_expr)) return 0;
-            if (!expr_vm_supported(expr->as.array_comp.iter_expr)) return 0;
-            if (expr->as.array_comp.filter_expr && !expr_vm_supported(expr->as.array_comp.filter_expr)) return 0;
+            if (!expr_vm_supported(expr_at(expr->as.array_comp->value_expr))) return 0;
+            if (!expr_vm_supported(expr_at(expr->as.array_comp->iter_expr))) return 0;
+            if (expr->as.array_comp->filter_expr && !expr_vm_supported(expr_at(expr->as.array_comp->filter_expr))) return 0;
             return 1;
         case EXPR_OBJECT:
             for (int i = 0; i < expr->as.object.count; i++) {
-                if (!expr_vm_supported(expr->as.object.values[i])) return 0;
+                if (!expr_vm_supported(expr_at(expr->as.object.fields[i].value))) return 0;
             }
             return 1;
         case EXPR_INDEX:
-            return expr_vm_supported(expr->as.index.left) && expr_vm_supported(expr->as.index.index);
+            return expr_vm_supported(expr_at(expr->as.index.left)) && expr_vm_supported(expr_at(expr->as.index.index));
         case EXPR_DOT:
-            return expr_vm_supported(expr->as.dot.left);
+            return expr_vm_supported(expr_at(expr->as.dot.left));
         case EXPR_UNARY:
-            return expr_vm_supported(expr->as.unary.right);
+            return expr_vm_supported(expr_at(expr->as.unary.right));
         case EXPR_BINARY:
-            if (!expr_vm_supported(expr->as.binary.left) || !expr_vm_supported(expr->as.binary.right)) return 0;
+            if (!expr_vm_supported(expr_at(expr->as.binary.left)) || !expr_vm_supported(expr_at(expr->as.binary.right))) return 0;
             switch (expr->as.binary.op) {
                 case TOK_PLUS:
                 case TOK_MINUS:
                 case TOK_STAR:
                 case TOK_SLASH:
                 case TOK_PERCENT:
+                case TOK_SHL:
                 case TOK_EQ:
                 case TOK_NEQ:
                 case TOK_ANDAND:
@@ -3136,15 +3990,21 @@ static int expr_vm_supported(Expr *expr) {
                     return 0;
             }
         case EXPR_CALL:
-            if (!expr_vm_supported(expr->as.call.callee)) return 0;
+            if (!expr_vm_supported(expr_at(expr->as.call.callee))) return 0;
             for (int i = 0; i < expr->as.call.argc; i++) {
-                if (!expr_vm_supported(expr->as.call.args[i])) return 0;
+                if (!expr_vm_supported(expr_at(expr->as.call.args[i]))) return 0;
             }
             return 1;
     }
     return 0;
 }
 
+/* A core builtin opcode on its operands, the name still holding the builtin; len of an array is inline. */
+static Value vm_core_builtin(BytecodeOp op, Value *argv, int argc, int line, int col, const char *current_file) {
+    if (op == BC_CORE_LEN && argv[0].type == VAL_ARRAY) return value_int(argv[0].as.array_val->count);
+    return k_core_builtin_fns[CORE_LEN + (int)(op - BC_CORE_LEN)](argv, argc, line, col, current_file);
+}
+
 static void bytecode_emit(Bytecode *bc, BytecodeOp op, long long iarg, const char *sarg, int line, int col) {
     if (bc->count == bc->cap) {
         int next_cap = bc->cap == 0 ? 32 : bc->cap * 2;
@@ -3154,18 +4014,52 @@ static void bytecode_emit(Bytecode *bc, BytecodeOp op, long long iarg, const cha
     bc->items[bc->count].op = op;
     bc->items[bc->count].iarg = iarg;
     bc->items[bc->count].sarg = sarg;
+    bc->items[bc->count].sarg2 = NULL;
+    bc->items[bc->count].feedback = 0;
+    bc->items[bc->count].aux = NULL;
     bc->items[bc->count].line = line;
     bc->items[bc->count].col = col;
     bc->count++;
 }
 
-static void compile_expr_bytecode(Expr *expr, Bytecode *bc) {
-    switch (expr->kind) {
-        case EXPR_INT:
-            bytecode_emit(bc, BC_PUSH_INT, expr->as.int_val, NULL, expr->line, expr->col);
-            return;
-        case EXPR_STRING:
-            bytecode_emit(bc, BC_PUSH_STRING, 0, expr->as.str_val, expr->line, expr->col);
+/* Jumps carry their absolute target pc in iarg; forward jumps are patched once the target is known. */
+static int bytecode_emit_jump(Bytecode *bc, BytecodeOp op, int line, int col) {
+    bytecode_emit(bc, op, -1, NULL, line, col);
+    return bc->count - 1;
+}
+
+static void bytecode_patch_jump(Bytecode *bc, int at) {
+    bc->items[at].iarg = bc->count;
+}
+
+static void bytecode_add_handler(Bytecode *bc, int start, int end, int env_depth, int stack_depth) {
+    if (bc->handler_count == bc->handler_cap) {
+        int next_cap = bc->handler_cap == 0 ? 4 : bc->handler_cap * 2;
+        bc->handlers = (BytecodeHandler *)xrealloc(bc->handlers, (size_t)next_cap * sizeof(BytecodeHandler));
+        bc->handler_cap = next_cap;
+    }
+    BytecodeHandler *h = &bc->handlers[bc->handler_count++];
+    h->start = start;
+    h->end = end;
+    h->target = bc->count;
+    h->env_depth = env_depth;
+    h->stack_depth = stack_depth;
+}
+
+typedef struct FnCompiler FnCompiler;
+
+/* The function compile in progress, if any; compile_expr_bytecode consults it for inlining. */
+static FnCompiler *g_fn_compiler = NULL;
+
+static int compile_inline_call(Expr *call, Bytecode *bc, BytecodeOp slow_op);
+
+static void compile_expr_bytecode(Expr *expr, Bytecode *bc) {
+    switch (expr->kind) {
+        case EXPR_INT:
+            bytecode_emit(bc, BC_PUSH_INT, expr->as.int_val, NULL, expr->line, expr->col);
+            return;
+        case EXPR_STRING:
+            bytecode_emit(bc, BC_PUSH_STRING, 0, expr->as.str_val, expr->line, expr->col);
             return;
         case EXPR_BOOL:
             bytecode_emit(bc, BC_PUSH_BOOL, expr->as.bool_val ? 1 : 0, NULL, expr->line, expr->col);
@@ -3178,31 +4072,47 @@ static void compile_expr_bytecode(Expr *expr, Bytecode *bc) {
             return;
         case EXPR_ARRAY:
             for (int i = 0; i < expr->as.array.count; i++) {
-                compile_expr_bytecode(expr->as.array.items[i], bc);
+                compile_expr_bytecode(expr_at(expr->as.array.items[i]), bc);
             }
             bytecode_emit(bc, BC_ARRAY_MAKE, expr->as.array.count, NULL, expr->line, expr->col);
             return;
-        case EXPR_ARRAY_COMP:
-            bytecode_emit(bc, BC_ARRAY_COMP, (long long)(intptr_t)expr, NULL, expr->line, expr->col);
+        case EXPR_ARRAY_COMP: {
+            /* An inline loop over [iterable, index, out, cap] in one Env whose bindings are rebound per element. */
+            compile_expr_bytecode(expr_at(expr->as.array_comp->iter_expr), bc);
+            bytecode_emit(bc, BC_COMP_INIT, 0, expr->as.array_comp->iter_name, expr->line, expr->col);
+            bc->items[bc->count - 1].sarg2 = expr->as.array_comp->iter_value_name;
+            int next_at = bc->count;
+            int to_exit = bytecode_emit_jump(bc, BC_COMP_NEXT, expr->line, expr->col);
+            bc->items[to_exit].sarg2 = expr->as.array_comp->iter_value_name;
+            if (expr->as.array_comp->filter_expr != 0) {
+                compile_expr_bytecode(expr_at(expr->as.array_comp->filter_expr), bc);
+                bytecode_emit(bc, BC_JUMP_IF_FALSE, next_at, NULL, expr->line, expr->col);
+            }
+            compile_expr_bytecode(expr_at(expr->as.array_comp->value_expr), bc);
+            bytecode_emit(bc, BC_COMP_APPEND, 0, NULL, expr->line, expr->col);
+            bytecode_emit(bc, BC_JUMP, next_at, NULL, expr->line, expr->col);
+            bytecode_patch_jump(bc, to_exit);
+            bytecode_emit(bc, BC_COMP_END, 0, NULL, expr->line, expr->col);
             return;
+        }
         case EXPR_OBJECT:
             bytecode_emit(bc, BC_OBJECT_NEW, 0, NULL, expr->line, expr->col);
             for (int i = 0; i < expr->as.object.count; i++) {
-                compile_expr_bytecode(expr->as.object.values[i], bc);
-                bytecode_emit(bc, BC_OBJECT_SET_KEY, 0, expr->as.object.keys[i], expr->line, expr->col);
+                compile_expr_bytecode(expr_at(expr->as.object.fields[i].value), bc);
+                bytecode_emit(bc, BC_OBJECT_SET_KEY, 0, expr->as.object.fields[i].key, expr->line, expr->col);
             }
             return;
         case EXPR_INDEX:
-            compile_expr_bytecode(expr->as.index.left, bc);
-            compile_expr_bytecode(expr->as.index.index, bc);
+            compile_expr_bytecode(expr_at(expr->as.index.left), bc);
+            compile_expr_bytecode(expr_at(expr->as.index.index), bc);
             bytecode_emit(bc, BC_INDEX_GET, 0, NULL, expr->line, expr->col);
             return;
         case EXPR_DOT:
-            compile_expr_bytecode(expr->as.dot.left, bc);
+            compile_expr_bytecode(expr_at(expr->as.dot.left), bc);
             bytecode_emit(bc, BC_DOT_GET, 0, expr->as.dot.member, expr->line, expr->col);
             return;
         case EXPR_UNARY:
-            compile_expr_bytecode(expr->as.unary.right, bc);
+            compile_expr_bytecode(expr_at(expr->as.unary.right), bc);
             if (expr->as.unary.op == TOK_MINUS) {
                 bytecode_emit(bc, BC_NEG, 0, NULL, expr->line, expr->col);
                 return;
@@ -3214,8 +4124,21 @@ static void compile_expr_bytecode(Expr *expr, Bytecode *bc) {
             runtime_error(expr->line, expr->col, "unsupported unary operator in VM");
             return;
         case EXPR_BINARY:
-            compile_expr_bytecode(expr->as.binary.left, bc);
-            compile_expr_bytecode(expr->as.binary.right, bc);
+            compile_expr_bytecode(expr_at(expr->as.binary.left), bc);
+            if (expr->as.binary.op == TOK_ANDAND || expr->as.binary.op == TOK_OROR ||
+                expr->as.binary.op == TOK_COALESCE) {
+                BytecodeOp jump_op = BC_JUMP_IF_NOT_NULL;
+                if (expr->as.binary.op == TOK_ANDAND) jump_op = BC_JUMP_IF_FALSE_KEEP;
+                if (expr->as.binary.op == TOK_OROR) jump_op = BC_JUMP_IF_TRUE_KEEP;
+                int skip = bytecode_emit_jump(bc, jump_op, expr->line, expr->col);
+                compile_expr_bytecode(expr_at(expr->as.binary.right), bc);
+                bytecode_patch_jump(bc, skip);
+                if (expr->as.binary.op != TOK_COALESCE) {
+                    bytecode_emit(bc, BC_TO_BOOL, 0, NULL, expr->line, expr->col);
+                }
+                return;
+            }
+            compile_expr_bytecode(expr_at(expr->as.binary.right), bc);
             switch (expr->as.binary.op) {
                 case TOK_PLUS:
                     bytecode_emit(bc, BC_ADD, 0, NULL, expr->line, expr->col);
@@ -3232,21 +4155,15 @@ static void compile_expr_bytecode(Expr *expr, Bytecode *bc) {
                 case TOK_PERCENT:
                     bytecode_emit(bc, BC_MOD, 0, NULL, expr->line, expr->col);
                     return;
+                case TOK_SHL:
+                    bytecode_emit(bc, BC_SHL, 0, NULL, expr->line, expr->col);
+                    return;
                 case TOK_EQ:
                     bytecode_emit(bc, BC_EQ, 0, NULL, expr->line, expr->col);
                     return;
                 case TOK_NEQ:
                     bytecode_emit(bc, BC_NEQ, 0, NULL, expr->line, expr->col);
                     return;
-                case TOK_ANDAND:
-                    bytecode_emit(bc, BC_AND, 0, NULL, expr->line, expr->col);
-                    return;
-                case TOK_OROR:
-                    bytecode_emit(bc, BC_OR, 0, NULL, expr->line, expr->col);
-                    return;
-                case TOK_COALESCE:
-                    bytecode_emit(bc, BC_COALESCE, 0, NULL, expr->line, expr->col);
-                    return;
                 case TOK_LT:
                     bytecode_emit(bc, BC_LT, 0, NULL, expr->line, expr->col);
                     return;
@@ -3264,418 +4181,4185 @@ static void compile_expr_bytecode(Expr *expr, Bytecode *bc) {
                     return;
             }
         case EXPR_CALL:
-            compile_expr_bytecode(expr->as.call.callee, bc);
+            if (expr->core != CORE_NONE && expr->core != CORE_RANGE) {
+                for (int i = 0; i < expr->as.call.argc; i++) {
+                    compile_expr_bytecode(expr_at(expr->as.call.args[i]), bc);
+                }
+                bytecode_emit(bc, (BytecodeOp)(BC_CORE_LEN + expr->core - CORE_LEN), expr->as.call.argc,
+                              expr_at(expr->as.call.callee)->as.ident, expr->line, expr->col);
+                return;
+            }
+            if (compile_inline_call(expr, bc, BC_CALL)) return;
+            if (expr_at(expr->as.call.callee)->kind == EXPR_DOT) {
+                /* METHOD_GET leaves the callee and then self, or null when it is not bound; see CALL_METHOD. */
+                compile_expr_bytecode(expr_at(expr_at(expr->as.call.callee)->as.dot.left), bc);
+                bytecode_emit(bc, BC_METHOD_GET, 0, expr_at(expr->as.call.callee)->as.dot.member, expr->line, expr->col);
+            } else {
+                compile_expr_bytecode(expr_at(expr->as.call.callee), bc);
+            }
             for (int i = 0; i < expr->as.call.argc; i++) {
-                compile_expr_bytecode(expr->as.call.args[i], bc);
+                compile_expr_bytecode(expr_at(expr->as.call.args[i]), bc);
             }
-            bytecode_emit(bc, BC_CALL, expr->as.call.argc, NULL, expr->line, expr->col);
+            bytecode_emit(bc, expr_at(expr->as.call.callee)->kind == EXPR_DOT ? BC_CALL_METHOD : BC_CALL, expr->as.call.argc, NULL,
+                          expr->line, expr->col);
             return;
     }
 
     runtime_error(expr->line, expr->col, "unsupported expression in VM compiler");
 }
 
+/*
+ * Superinstruction table. The pairs were picked from `--profile-ops` runs over the
+ * test programs: LOAD->PUSH_INT, PUSH_INT->ADD/SUB/LT, LOAD->LOAD, LOAD->LT and
+ * LOAD->DOT_GET dominate loop counters, conditions and member access.
+ */
+typedef struct {
+    BytecodeOp pattern[3];
+    int len;
+    BytecodeOp fused;
+} PeepholeRule;
+
+static const PeepholeRule k_peephole_rules[] = {
+    {{BC_LOAD, BC_PUSH_INT, BC_ADD}, 3, BC_ADD_LOCAL_IMM},
+    {{BC_LOAD, BC_PUSH_INT, BC_SUB}, 3, BC_SUB_LOCAL_IMM},
+    {{BC_LOAD, BC_PUSH_INT, BC_LT}, 3, BC_LT_LOCAL_IMM},
+    {{BC_LOAD, BC_LOAD, BC_LT}, 3, BC_LT_LOCAL_LOCAL},
+    {{BC_LOAD, BC_DOT_GET, BC_OP_COUNT}, 2, BC_LOAD_DOT},
+};
+
+static int bytecode_fused_len(BytecodeOp op) {
+    for (size_t r = 0; r < sizeof(k_peephole_rules) / sizeof(k_peephole_rules[0]); r++) {
+        if (k_peephole_rules[r].fused == op) return k_peephole_rules[r].len;
+    }
+    return 1;
+}
+
+/*
+ * Fuses hot sequences in place: the head instruction becomes the superinstruction and the
+ * originals behind it stay as-is, so jump targets never move, a jump into the middle still
+ * runs the plain sequence, and error paths can report the position of the fused operator.
+ */
+static void bytecode_peephole(Bytecode *bc) {
+    int i = 0;
+    while (i < bc->count) {
+        int advanced = 0;
+        for (size_t r = 0; r < sizeof(k_peephole_rules) / sizeof(k_peephole_rules[0]); r++) {
+            const PeepholeRule *rule = &k_peephole_rules[r];
+            if (i + rule->len > bc->count) continue;
+            int match = 1;
+            for (int k = 0; k < rule->len; k++) {
+                if (bc->items[i + k].op != rule->pattern[k]) {
+                    match = 0;
+                    break;
+                }
+            }
+            if (!match) continue;
+            BytecodeInstr *head = &bc->items[i];
+            BytecodeInstr *second = &bc->items[i + 1];
+            head->op = rule->fused;
+            if (second->op == BC_PUSH_INT) head->iarg = second->iarg;
+            if (second->op == BC_LOAD || second->op == BC_DOT_GET) head->sarg2 = second->sarg;
+            i += rule->len;
+            advanced = 1;
+            break;
+        }
+        if (!advanced) i++;
+    }
+}
+
+static void bytecode_dump(const char *what, int line, int col, Bytecode *bc) {
+    fprintf(stderr, "[bytecode] %s at %d:%d (%d instrs)\n", what, line, col, bc->count);
+    int shadow = 0;
+    for (int i = 0; i < bc->count; i++) {
+        BytecodeInstr *in = &bc->items[i];
+        fprintf(stderr, "  %04d %s%-18s", i, shadow > 0 ? "| " : "", k_bytecode_op_names[in->op]);
+        switch (in->op) {
+            case BC_PUSH_INT:
+            case BC_PUSH_BOOL:
+            case BC_ARRAY_MAKE:
+            case BC_CALL:
+            case BC_CALL_METHOD:
+            case BC_TAIL_CALL:
+            case BC_TAIL_CALL_METHOD:
+            case BC_POP:
+            case BC_ENV_POP:
+                fprintf(stderr, " %lld", in->iarg);
+                break;
+            case BC_COMP_INIT:
+                fprintf(stderr, in->sarg2 != NULL ? " %s, %s" : " %s", in->sarg, in->sarg2);
+                break;
+            case BC_STMT:
+            case BC_EXEC_STMT:
+                fprintf(stderr, " %s", stmt_kind_name(((Stmt *)(intptr_t)in->iarg)->kind));
+                break;
+            case BC_PUSH_STRING:
+                fprintf(stderr, " \"%s\"", in->sarg);
+                break;
+            case BC_LOAD:
+            case BC_DOT_GET:
+            case BC_METHOD_GET:
+            case BC_CORE_LEN:
+            case BC_CORE_PUSH:
+            case BC_CORE_POP:
+            case BC_CORE_HAS:
+            case BC_CORE_OBJECT_GET:
+            case BC_RANGE_INIT:
+            case BC_OBJECT_SET_KEY:
+            case BC_DEFINE:
+            case BC_ASSIGN:
+            case BC_SET_MEMBER:
+                fprintf(stderr, " %s", in->sarg);
+                break;
+            case BC_SWITCH_TABLE:
+                fprintf(stderr, " %lld cases", in->iarg);
+                break;
+            case BC_JUMP:
+            case BC_JUMP_IF_FALSE:
+            case BC_ITER_NEXT:
+            case BC_ITER_BIND:
+            case BC_COMP_NEXT:
+            case BC_JUMP_IF_FALSE_KEEP:
+            case BC_JUMP_IF_TRUE_KEEP:
+            case BC_JUMP_IF_NOT_NULL:
+                fprintf(stderr, " -> %04lld", in->iarg);
+                break;
+            case BC_ADD_LOCAL_IMM:
+            case BC_SUB_LOCAL_IMM:
+            case BC_LT_LOCAL_IMM:
+                fprintf(stderr, " %s, %lld", in->sarg, in->iarg);
+                break;
+            case BC_LT_LOCAL_LOCAL:
+                fprintf(stderr, " %s, %s", in->sarg, in->sarg2);
+                break;
+            case BC_LOAD_DOT:
+                fprintf(stderr, " %s.%s", in->sarg, in->sarg2);
+                break;
+            case BC_INLINE_ENTER:
+                fprintf(stderr, " %s/%lld", in->sarg, in->iarg);
+                break;
+            default:
+                break;
+        }
+        fputc('\n', stderr);
+        if (shadow > 0) {
+            shadow--;
+        } else {
+            shadow = bytecode_fused_len(in->op) - 1;
+        }
+    }
+    for (int i = 0; i < bc->handler_count; i++) {
+        const BytecodeHandler *h = &bc->handlers[i];
+        fprintf(stderr, "  catch %04d..%04d -> %04d env %d stack %d\n", h->start, h->end - 1, h->target, h->env_depth,
+                h->stack_depth);
+    }
+}
+
 static Bytecode *vm_bytecode_for_expr(Expr *expr) {
     for (int i = 0; i < g_expr_vm_cache_count; i++) {
-        if (g_expr_vm_cache[i].expr == expr) {
-            return &g_expr_vm_cache[i].code;
+        if (g_expr_vm_cache[i]->expr == expr) {
+            return &g_expr_vm_cache[i]->code;
         }
     }
 
     if (g_expr_vm_cache_count == g_expr_vm_cache_cap) {
         int next_cap = g_expr_vm_cache_cap == 0 ? 64 : g_expr_vm_cache_cap * 2;
         g_expr_vm_cache =
-            (ExprVmCacheEntry *)xrealloc(g_expr_vm_cache, (size_t)next_cap * sizeof(ExprVmCacheEntry));
+            (ExprVmCacheEntry **)xrealloc(g_expr_vm_cache, (size_t)next_cap * sizeof(ExprVmCacheEntry *));
         g_expr_vm_cache_cap = next_cap;
     }
 
-    ExprVmCacheEntry *entry = &g_expr_vm_cache[g_expr_vm_cache_count++];
+    ExprVmCacheEntry *entry = (ExprVmCacheEntry *)xmalloc(sizeof(ExprVmCacheEntry));
+    g_expr_vm_cache[g_expr_vm_cache_count++] = entry;
     entry->expr = expr;
     entry->code.items = NULL;
     entry->code.count = 0;
     entry->code.cap = 0;
+    entry->code.handlers = NULL;
+    entry->code.handler_count = 0;
+    entry->code.handler_cap = 0;
+    entry->code.hot = 0;
+    entry->code.jit = NULL;
+    g_fn_compiler = NULL; /* a compile that raised an error may have left it set */
     compile_expr_bytecode(expr, &entry->code);
+    bytecode_peephole(&entry->code);
+    if (g_dump_bytecode) bytecode_dump("expr", expr->line, expr->col, &entry->code);
     return &entry->code;
 }
 
+/*
+ * Function bodies compile to one frame bytecode stream (statements and expressions together)
+ * so calls between them are frame pushes in vm_run rather than C recursion. A try costs no
+ * code on entry; it only adds a handler table entry (see vm_unwind). Bodies using a
+ * break/continue outside any loop keep the per-statement path via vm_eval_block.
+ */
 typedef struct {
-    Value *items;
-    int count;
-    int cap;
-} ValueStack;
-
-static void vstack_push(ValueStack *st, Value value) {
-    if (st->count == st->cap) {
-        int next_cap = st->cap == 0 ? 32 : st->cap * 2;
-        st->items = (Value *)xrealloc(st->items, (size_t)next_cap * sizeof(Value));
-        st->cap = next_cap;
-    }
-    st->items[st->count++] = value;
-}
-
-static Value vstack_pop(ValueStack *st, int line, int col) {
-    if (st->count <= 0) runtime_error(line, col, "VM stack underflow");
-    return st->items[--st->count];
-}
+    int env_depth; /* env depth just outside the loop body */
+    int continue_target;
+    int *break_jumps;
+    int break_count;
+    int break_cap;
+} FnLoopCtx;
+
+struct FnCompiler {
+    Bytecode *bc;
+    int env_depth;
+    int stack_depth; /* operand slots live between statements: [iterable, index] per for loop */
+    FnLoopCtx loop;
+    Env *scope;           /* closure of the function being compiled; resolves inlining candidates */
+    Block *self_body;
+    int inlining;         /* compiling an inlined body: `return` jumps to its INLINE_LEAVE */
+    int inline_env_depth; /* env depth at the inlined body's top level */
+    int *inline_exits;
+    int inline_exit_count;
+    int inline_exit_cap;
+};
 
-static Value eval_array_comp_vm_expr(Expr *expr, Env *env, ImportSet *imports, const char *current_file) {
-    Value iter = eval_expr_vm(expr->as.array_comp.iter_expr, env, imports, current_file);
-    Value *out_items = NULL;
-    int out_count = 0;
-    int out_cap = 0;
+/* Keyed by the compiled Block: a function body, or a while body entered by vm_loop_code. */
+typedef struct {
+    Block *body;
+    Bytecode code;
+    int supported;
+} FnCodeCacheEntry;
 
-    if (iter.type == VAL_ARRAY) {
-        for (int i = 0; i < iter.as.array_val->count; i++) {
-            Env *loop_env = env_new(env);
-            if (expr->as.array_comp.iter_value_name != NULL) {
-                env_define(loop_env, expr->as.array_comp.iter_name, value_int(i));
-                env_define(loop_env, expr->as.array_comp.iter_value_name, iter.as.array_val->items[i]);
-            } else {
-                env_define(loop_env, expr->as.array_comp.iter_name, iter.as.array_val->items[i]);
-            }
-            if (expr->as.array_comp.filter_expr) {
-                Value keep = eval_expr_vm(expr->as.array_comp.filter_expr, loop_env, imports, current_file);
-                if (!is_truthy(keep)) continue;
-            }
-            Value outv = eval_expr_vm(expr->as.array_comp.value_expr, loop_env, imports, current_file);
-            if (out_count == out_cap) {
-                int next = out_cap == 0 ? 8 : out_cap * 2;
-                out_items = (Value *)xrealloc(out_items, (size_t)next * sizeof(Value));
-                out_cap = next;
-            }
-            out_items[out_count++] = outv;
-        }
-        return value_array(out_items, out_count);
-    }
+static FnCodeCacheEntry **g_fn_code_cache = NULL;
+static int g_fn_code_cache_count = 0;
+static int g_fn_code_cache_cap = 0;
 
-    if (iter.type == VAL_OBJECT) {
-        for (int i = 0; i < iter.as.object_val->count; i++) {
-            Env *loop_env = env_new(env);
-            if (expr->as.array_comp.iter_value_name != NULL) {
-                env_define(loop_env, expr->as.array_comp.iter_name, value_string(iter.as.object_val->items[i].key));
-                env_define(loop_env, expr->as.array_comp.iter_value_name, iter.as.object_val->items[i].value);
-            } else {
-                env_define(loop_env, expr->as.array_comp.iter_name, value_string(iter.as.object_val->items[i].key));
-            }
-            if (expr->as.array_comp.filter_expr) {
-                Value keep = eval_expr_vm(expr->as.array_comp.filter_expr, loop_env, imports, current_file);
-                if (!is_truthy(keep)) continue;
-            }
-            Value outv = eval_expr_vm(expr->as.array_comp.value_expr, loop_env, imports, current_file);
-            if (out_count == out_cap) {
-                int next = out_cap == 0 ? 8 : out_cap * 2;
-                out_items = (Value *)xrealloc(out_items, (size_t)next * sizeof(Value));
-                out_cap = next;
-            }
-            out_items[out_count++] = outv;
+static int fn_block_supported(Block *block, int in_loop) {
+    for (int i = 0; i < block->count; i++) {
+        Stmt *s = block->items[i];
+        switch (s->kind) {
+            case STMT_TRY:
+                if (!fn_block_supported(s->as.try_stmt.try_block, in_loop)) return 0;
+                if (!fn_block_supported(s->as.try_stmt.catch_block, in_loop)) return 0;
+                break;
+            case STMT_BREAK:
+            case STMT_CONTINUE:
+                if (!in_loop) return 0;
+                break;
+            case STMT_IF:
+                if (!fn_block_supported(s->as.if_stmt.then_block, in_loop)) return 0;
+                if (s->as.if_stmt.else_block && !fn_block_supported(s->as.if_stmt.else_block, in_loop)) return 0;
+                break;
+            case STMT_SWITCH:
+                for (int c = 0; c < s->as.switch_stmt->case_count; c++) {
+                    if (!fn_block_supported(s->as.switch_stmt->case_blocks[c], in_loop)) return 0;
+                }
+                if (s->as.switch_stmt->default_block && !fn_block_supported(s->as.switch_stmt->default_block, in_loop)) {
+                    return 0;
+                }
+                break;
+            case STMT_WHILE:
+                if (!fn_block_supported(s->as.while_stmt.body, 1)) return 0;
+                break;
+            case STMT_FOR:
+                if (!fn_block_supported(s->as.for_stmt.body, 1)) return 0;
+                break;
+            default:
+                break;
         }
-        return value_array(out_items, out_count);
     }
-
-    runtime_error(expr->line, expr->col, "array comprehension expects array or object iterable");
-    return value_null();
+    return 1;
 }
 
-static Value vm_exec(Bytecode *bc, Env *env, ImportSet *imports, const char *current_file) {
-    ValueStack st;
-    st.items = NULL;
-    st.count = 0;
-    st.cap = 0;
-
-    for (int pc = 0; pc < bc->count; pc++) {
-        BytecodeInstr in = bc->items[pc];
-        switch (in.op) {
-            case BC_PUSH_INT:
-                vstack_push(&st, value_int(in.iarg));
+static int block_has_return(Block *block) {
+    for (int i = 0; i < block->count; i++) {
+        Stmt *s = block->items[i];
+        switch (s->kind) {
+            case STMT_RETURN:
+                return 1;
+            case STMT_IF:
+                if (block_has_return(s->as.if_stmt.then_block)) return 1;
+                if (s->as.if_stmt.else_block && block_has_return(s->as.if_stmt.else_block)) return 1;
                 break;
-            case BC_PUSH_STRING:
-                vstack_push(&st, value_string(in.sarg));
+            case STMT_SWITCH:
+                for (int c = 0; c < s->as.switch_stmt->case_count; c++) {
+                    if (block_has_return(s->as.switch_stmt->case_blocks[c])) return 1;
+                }
+                if (s->as.switch_stmt->default_block && block_has_return(s->as.switch_stmt->default_block)) return 1;
                 break;
-            case BC_PUSH_BOOL:
-                vstack_push(&st, value_bool(in.iarg ? 1 : 0));
+            case STMT_WHILE:
+                if (block_has_return(s->as.while_stmt.body)) return 1;
                 break;
-            case BC_PUSH_NULL:
-                vstack_push(&st, value_null());
+            case STMT_FOR:
+                if (block_has_return(s->as.for_stmt.body)) return 1;
                 break;
-            case BC_LOAD: {
-                Value out;
-                if (!env_get(env, in.sarg, &out)) runtime_error(in.line, in.col, "undefined identifier");
-                vstack_push(&st, out);
+            default:
                 break;
+        }
+    }
+    return 0;
+}
+
+static void compile_fn_expr(FnCompiler *c, Expr *expr) {
+    if (expr_vm_supported(expr)) {
+        compile_expr_bytecode(expr, c->bc);
+    } else {
+        bytecode_emit(c->bc, BC_EVAL_EXPR, (long long)(intptr_t)expr, NULL, expr->line, expr->col);
+    }
+}
+
+static void compile_fn_env_pop(FnCompiler *c, int n, int line, int col) {
+    if (n > 0) bytecode_emit(c->bc, BC_ENV_POP, n, NULL, line, col);
+}
+
+static void compile_fn_stmt(FnCompiler *c, Stmt *s);
+
+static void compile_fn_block(FnCompiler *c, Block *block) {
+    for (int i = 0; i < block->count; i++) {
+        compile_fn_stmt(c, block->items[i]);
+    }
+}
+
+/* Branch, case and loop bodies each get a fresh Env, exactly like eval_statement. */
+static void compile_fn_scoped_block(FnCompiler *c, Block *block, int line, int col) {
+    bytecode_emit(c->bc, BC_ENV_PUSH, 0, NULL, line, col);
+    c->env_depth++;
+    compile_fn_block(c, block);
+    c->env_depth--;
+    compile_fn_env_pop(c, 1, line, col);
+}
+
+static void compile_fn_loop_enter(FnCompiler *c, FnLoopCtx *saved, int continue_target) {
+    *saved = c->loop;
+    c->loop.env_depth = c->env_depth;
+    c->loop.continue_target = continue_target;
+    c->loop.break_jumps = NULL;
+    c->loop.break_count = 0;
+    c->loop.break_cap = 0;
+}
+
+/* Closes the loop body (jump back to its head) and patches every break to land after it. */
+static void compile_fn_loop_leave(FnCompiler *c, FnLoopCtx *saved, int line, int col) {
+    bytecode_emit(c->bc, BC_JUMP, c->loop.continue_target, NULL, line, col);
+    for (int i = 0; i < c->loop.break_count; i++) {
+        bytecode_patch_jump(c->bc, c->loop.break_jumps[i]);
+    }
+    xfree(c->loop.break_jumps);
+    c->loop = *saved;
+}
+
+/*
+ * Without the statement prologue: vm_loop_code enters a loop that has already started.
+ * A body that cannot capture its Env gets one for the whole loop, emptied by ENV_RESET
+ * before each condition so the condition never sees the last iteration's lets.
+ */
+static void compile_fn_while(FnCompiler *c, Stmt *s) {
+    FnLoopCtx saved;
+    Block *body = s->as.while_stmt.body;
+    if (block_may_capture(body)) {
+        int cond_at = c->bc->count;
+        compile_fn_expr(c, expr_at(s->as.while_stmt.cond));
+        int to_exit = bytecode_emit_jump(c->bc, BC_JUMP_IF_FALSE, s->line, s->col);
+        compile_fn_loop_enter(c, &saved, cond_at);
+        compile_fn_scoped_block(c, body, s->line, s->col);
+        compile_fn_loop_leave(c, &saved, s->line, s->col);
+        bytecode_patch_jump(c->bc, to_exit);
+        return;
+    }
+    bytecode_emit(c->bc, BC_ENV_PUSH, 0, NULL, s->line, s->col);
+    c->env_depth++;
+    int cond_at = c->bc->count;
+    bytecode_emit(c->bc, BC_ENV_RESET, 0, NULL, s->line, s->col);
+    compile_fn_expr(c, expr_at(s->as.while_stmt.cond));
+    int to_exit = bytecode_emit_jump(c->bc, BC_JUMP_IF_FALSE, s->line, s->col);
+    compile_fn_loop_enter(c, &saved, cond_at);
+    compile_fn_block(c, body);
+    compile_fn_loop_leave(c, &saved, s->line, s->col);
+    bytecode_patch_jump(c->bc, to_exit);
+    c->env_depth--;
+    compile_fn_env_pop(c, 1, s->line, s->col);
+}
+
+static void compile_fn_stmt(FnCompiler *c, Stmt *s) {
+    Bytecode *bc = c->bc;
+    switch (s->kind) {
+        case STMT_FN:
+        case STMT_CLASS:
+        case STMT_MODULE:
+        case STMT_TYPE:
+        case STMT_IMPORT:
+            /* Never yield break/continue/return; eval_statement runs its own prologue. */
+            bytecode_emit(bc, BC_EXEC_STMT, (long long)(intptr_t)s, NULL, s->line, s->col);
+            return;
+        default:
+            break;
+    }
+
+    bytecode_emit(bc, BC_STMT, (long long)(intptr_t)s, NULL, s->line, s->col);
+    switch (s->kind) {
+        case STMT_LET:
+            compile_fn_expr(c, expr_at(s->as.let_stmt.value));
+            bytecode_emit(bc, BC_DEFINE, 0, s->as.let_stmt.name, s->line, s->col);
+            return;
+        case STMT_ASSIGN:
+            compile_fn_expr(c, expr_at(s->as.assign_stmt.value));
+            bytecode_emit(bc, BC_ASSIGN, 0, s->as.assign_stmt.name, s->line, s->col);
+            return;
+        case STMT_SET_MEMBER:
+            compile_fn_expr(c, expr_at(s->as.set_member_stmt.object));
+            compile_fn_expr(c, expr_at(s->as.set_member_stmt.value));
+            bytecode_emit(bc, BC_SET_MEMBER, 0, s->as.set_member_stmt.member, s->line, s->col);
+            return;
+        case STMT_SET_INDEX:
+            compile_fn_expr(c, expr_at(s->as.set_index_stmt.object));
+            compile_fn_expr(c, expr_at(s->as.set_index_stmt.index));
+            compile_fn_expr(c, expr_at(s->as.set_index_stmt.value));
+            bytecode_emit(bc, BC_SET_INDEX, 0, NULL, s->line, s->col);
+            return;
+        case STMT_EXPR:
+            compile_fn_expr(c, expr_at(s->as.expr_stmt.expr));
+            bytecode_emit(bc, BC_POP, 1, NULL, s->line, s->col);
+            return;
+        case STMT_IF: {
+            compile_fn_expr(c, expr_at(s->as.if_stmt.cond));
+            int to_else = bytecode_emit_jump(bc, BC_JUMP_IF_FALSE, s->line, s->col);
+            compile_fn_scoped_block(c, s->as.if_stmt.then_block, s->line, s->col);
+            if (s->as.if_stmt.else_block == NULL) {
+                bytecode_patch_jump(bc, to_else);
+                return;
             }
-            case BC_ARRAY_MAKE: {
-                int n = (int)in.iarg;
-                if (n < 0 || st.count < n) runtime_error(in.line, in.col, "invalid array build");
-                Value *items = (Value *)xmalloc((size_t)n * sizeof(Value));
-                for (int i = n - 1; i >= 0; i--) {
-                    items[i] = vstack_pop(&st, in.line, in.col);
+            int to_end = bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
+            bytecode_patch_jump(bc, to_else);
+            compile_fn_scoped_block(c, s->as.if_stmt.else_block, s->line, s->col);
+            bytecode_patch_jump(bc, to_end);
+            return;
+        }
+        case STMT_SWITCH: {
+            /* The switch value stays on the stack while cases are compared, never inside a case body. */
+            int count = s->as.switch_stmt->case_count;
+            int *to_end = count > 0 ? (int *)xmalloc((size_t)count * sizeof(int)) : NULL;
+            compile_fn_expr(c, expr_at(s->as.switch_stmt->value));
+            SwitchTable *table = switch_table_for(s);
+            if (table != NULL) {
+                /* SWITCH_TABLE pops the value and jumps to the target of row entry `case`, or the last. */
+                bytecode_emit(bc, BC_SWITCH_TABLE, count, NULL, s->line, s->col);
+                bc->items[bc->count - 1].aux = table;
+                int row = bc->count;
+                for (int i = 0; i <= count; i++) bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
+                for (int i = 0; i < count; i++) {
+                    bytecode_patch_jump(bc, row + i);
+                    compile_fn_scoped_block(c, s->as.switch_stmt->case_blocks[i], s->line, s->col);
+                    to_end[i] = bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
                 }
-                vstack_push(&st, value_array(items, n));
-                break;
+                bytecode_patch_jump(bc, row + count);
+                if (s->as.switch_stmt->default_block != NULL) {
+                    compile_fn_scoped_block(c, s->as.switch_stmt->default_block, s->line, s->col);
+                }
+                for (int i = 0; i < count; i++) bytecode_patch_jump(bc, to_end[i]);
+                xfree(to_end);
+                return;
             }
-            case BC_ARRAY_COMP: {
-                Expr *comp_expr = (Expr *)(intptr_t)in.iarg;
-                vstack_push(&st, eval_array_comp_vm_expr(comp_expr, env, imports, current_file));
-                break;
+            for (int i = 0; i < count; i++) {
+                bytecode_emit(bc, BC_DUP, 0, NULL, s->line, s->col);
+                compile_fn_expr(c, expr_at(s->as.switch_stmt->case_values[i]));
+                bytecode_emit(bc, BC_EQ, 0, NULL, s->line, s->col);
+                int next_case = bytecode_emit_jump(bc, BC_JUMP_IF_FALSE, s->line, s->col);
+                bytecode_emit(bc, BC_POP, 1, NULL, s->line, s->col);
+                compile_fn_scoped_block(c, s->as.switch_stmt->case_blocks[i], s->line, s->col);
+                to_end[i] = bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
+                bytecode_patch_jump(bc, next_case);
             }
-            case BC_OBJECT_NEW:
-                vstack_push(&st, value_object(object_new()));
-                break;
-            case BC_OBJECT_SET_KEY: {
-                Value value = vstack_pop(&st, in.line, in.col);
-                Value obj = vstack_pop(&st, in.line, in.col);
-                if (obj.type != VAL_OBJECT) runtime_error(in.line, in.col, "object build expected object value");
-                object_set(obj.as.object_val, in.sarg, value);
-                vstack_push(&st, obj);
-                break;
+            bytecode_emit(bc, BC_POP, 1, NULL, s->line, s->col);
+            if (s->as.switch_stmt->default_block != NULL) {
+                compile_fn_scoped_block(c, s->as.switch_stmt->default_block, s->line, s->col);
             }
-            case BC_INDEX_GET: {
-                Value idx = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
-                if (left.type == VAL_ARRAY && idx.type == VAL_INT) {
-                    if (idx.as.int_val < 0 || idx.as.int_val >= left.as.array_val->count) {
-                        vstack_push(&st, value_null());
-                    } else {
-                        vstack_push(&st, left.as.array_val->items[idx.as.int_val]);
-                    }
-                    break;
-                }
-                if (left.type == VAL_OBJECT && idx.type == VAL_STRING) {
-                    vstack_push(&st, object_get(left.as.object_val, idx.as.str_val));
-                    break;
+            for (int i = 0; i < count; i++) {
+                bytecode_patch_jump(bc, to_end[i]);
+            }
+            xfree(to_end);
+            return;
+        }
+        case STMT_WHILE:
+            compile_fn_while(c, s);
+            return;
+        case STMT_FOR: {
+            /*
+             * Stack holds [iterable, index] for the whole loop, or for RANGE_INIT [stop, next value]
+             * as plain ints. ITER_NEXT pushes a fresh body Env;
+             * a body that cannot capture it instead runs in one Env that ITER_BIND empties and rebinds.
+             */
+            FnLoopCtx saved;
+            int reuse = !block_may_capture(s->as.for_stmt.body) &&
+                        (s->as.for_stmt.iter_value_name == NULL ||
+                         strcmp(s->as.for_stmt.iter_name, s->as.for_stmt.iter_value_name) != 0);
+            Expr *iter = expr_at(s->as.for_stmt.iter_expr);
+            if (iter->kind == EXPR_CALL && iter->core == CORE_RANGE && s->as.for_stmt.iter_value_name == NULL) {
+                for (int i = 0; i < iter->as.call.argc; i++) {
+                    compile_fn_expr(c, expr_at(iter->as.call.args[i]));
                 }
-                runtime_error(in.line, in.col, "indexing expects array[int] or object[string]");
-                break;
+                bytecode_emit(bc, BC_RANGE_INIT, iter->as.call.argc, expr_at(iter->as.call.callee)->as.ident, iter->line, iter->col);
+            } else {
+                compile_fn_expr(c, iter);
+                bytecode_emit(bc, BC_ITER_INIT, 0, NULL, s->line, s->col);
             }
-            case BC_DOT_GET: {
-                Value left = vstack_pop(&st, in.line, in.col);
-                vstack_push(&st, object_get_member_value(left, in.sarg, in.line, in.col));
-                break;
+            if (reuse) {
+                bytecode_emit(bc, BC_ENV_PUSH, 0, NULL, s->line, s->col);
+                c->env_depth++;
             }
-            case BC_NEG: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                if (right.type != VAL_INT) runtime_error(in.line, in.col, "unary '-' expects integer");
-                vstack_push(&st, value_int(-right.as.int_val));
-                break;
+            int next_at = bc->count;
+            int to_exit = bytecode_emit_jump(bc, reuse ? BC_ITER_BIND : BC_ITER_NEXT, s->line, s->col);
+            bc->items[to_exit].sarg = s->as.for_stmt.iter_name;
+            bc->items[to_exit].sarg2 = s->as.for_stmt.iter_value_name;
+            compile_fn_loop_enter(c, &saved, next_at);
+            if (!reuse) c->env_depth++;
+            c->stack_depth += 2;
+            compile_fn_block(c, s->as.for_stmt.body);
+            c->stack_depth -= 2;
+            if (!reuse) {
+                c->env_depth--;
+                compile_fn_env_pop(c, 1, s->line, s->col);
             }
-            case BC_NOT: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                vstack_push(&st, value_bool(!is_truthy(right)));
-                break;
+            compile_fn_loop_leave(c, &saved, s->line, s->col);
+            bytecode_patch_jump(bc, to_exit);
+            if (reuse) {
+                c->env_depth--;
+                compile_fn_env_pop(c, 1, s->line, s->col);
             }
-            case BC_ADD: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
-                if (left.type == VAL_INT && right.type == VAL_INT) {
-                    vstack_push(&st, value_int(left.as.int_val + right.as.int_val));
-                    break;
-                }
-                if (left.type == VAL_STRING && right.type == VAL_STRING) {
-                    char *joined = str_concat(left.as.str_val, right.as.str_val);
-                    Value out = value_string(joined);
-                    xfree(joined);
-                    vstack_push(&st, out);
-                    break;
-                }
-                runtime_error(in.line, in.col, "'+' expects int+int or string+string");
-                break;
+            bytecode_emit(bc, BC_POP, 2, NULL, s->line, s->col);
+            return;
+        }
+        case STMT_BREAK: {
+            FnLoopCtx *loop = &c->loop;
+            compile_fn_env_pop(c, c->env_depth - loop->env_depth, s->line, s->col);
+            if (loop->break_count == loop->break_cap) {
+                int next_cap = loop->break_cap == 0 ? 4 : loop->break_cap * 2;
+                loop->break_jumps = (int *)xrealloc(loop->break_jumps, (size_t)next_cap * sizeof(int));
+                loop->break_cap = next_cap;
             }
-            case BC_SUB:
-            case BC_MUL:
-            case BC_DIV:
-            case BC_MOD: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
-                if (left.type != VAL_INT || right.type != VAL_INT) {
-                    runtime_error(in.line, in.col, "arithmetic expects integers");
+            loop->break_jumps[loop->break_count++] = bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
+            return;
+        }
+        case STMT_CONTINUE:
+            compile_fn_env_pop(c, c->env_depth - c->loop.env_depth, s->line, s->col);
+            bytecode_emit(bc, BC_JUMP, c->loop.continue_target, NULL, s->line, s->col);
+            return;
+        case STMT_RETURN: {
+            Expr *value = expr_at(s->as.return_stmt.value);
+            if (c->inlining) {
+                compile_fn_expr(c, value);
+                compile_fn_env_pop(c, c->env_depth - c->inline_env_depth, s->line, s->col);
+                if (c->inline_exit_count == c->inline_exit_cap) {
+                    int next_cap = c->inline_exit_cap == 0 ? 4 : c->inline_exit_cap * 2;
+                    c->inline_exits = (int *)xrealloc(c->inline_exits, (size_t)next_cap * sizeof(int));
+                    c->inline_exit_cap = next_cap;
                 }
-                if (in.op == BC_SUB) {
-                    vstack_push(&st, value_int(left.as.int_val - right.as.int_val));
-                } else if (in.op == BC_MUL) {
-                    vstack_push(&st, value_int(left.as.int_val * right.as.int_val));
-                } else if (in.op == BC_DIV) {
-                    if (right.as.int_val == 0) runtime_error(in.line, in.col, "division by zero");
-                    vstack_push(&st, value_int(left.as.int_val / right.as.int_val));
+                c->inline_exits[c->inline_exit_count++] = bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
+                return;
+            }
+            if (s->as.return_stmt.tail_call && compile_inline_call(value, bc, BC_TAIL_CALL)) {
+                bytecode_emit(bc, BC_RETURN, 0, NULL, s->line, s->col);
+                return;
+            }
+            if (s->as.return_stmt.tail_call && (value->core == CORE_NONE || value->core == CORE_RANGE)) {
+                Expr *callee = expr_at(value->as.call.callee);
+                if (callee->kind == EXPR_DOT) {
+                    compile_fn_expr(c, expr_at(callee->as.dot.left));
+                    bytecode_emit(bc, BC_METHOD_GET, 0, callee->as.dot.member, callee->line, callee->col);
                 } else {
-                    if (right.as.int_val == 0) runtime_error(in.line, in.col, "division by zero");
-                    vstack_push(&st, value_int(left.as.int_val % right.as.int_val));
+                    compile_fn_expr(c, callee);
                 }
-                break;
+                for (int i = 0; i < value->as.call.argc; i++) {
+                    compile_fn_expr(c, expr_at(value->as.call.args[i]));
+                }
+                bytecode_emit(bc, callee->kind == EXPR_DOT ? BC_TAIL_CALL_METHOD : BC_TAIL_CALL,
+                              value->as.call.argc, NULL, value->line, value->col);
+                return;
             }
-            case BC_EQ:
-            case BC_NEQ: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
-                int eq = values_equal(left, right);
-                vstack_push(&st, value_bool(in.op == BC_EQ ? eq : !eq));
+            compile_fn_expr(c, value);
+            bytecode_emit(bc, BC_RETURN, 0, NULL, s->line, s->col);
+            return;
+        }
+        case STMT_THROW:
+            compile_fn_expr(c, expr_at(s->as.throw_stmt.value));
+            bytecode_emit(bc, BC_THROW, 0, NULL, s->line, s->col);
+            return;
+        case STMT_TRY: {
+            /* Nothing runs on entry. vm_unwind enters the catch with the try's Env and the value pushed. */
+            int start = bc->count;
+            compile_fn_scoped_block(c, s->as.try_stmt.try_block, s->line, s->col);
+            int end = bc->count;
+            int to_end = bytecode_emit_jump(bc, BC_JUMP, s->line, s->col);
+            bytecode_add_handler(bc, start, end, c->env_depth, c->stack_depth);
+            bytecode_emit(bc, BC_ENV_PUSH, 0, NULL, s->line, s->col);
+            bytecode_emit(bc, BC_DEFINE, 0, s->as.try_stmt.catch_name, s->line, s->col);
+            c->env_depth++;
+            compile_fn_block(c, s->as.try_stmt.catch_block);
+            c->env_depth--;
+            compile_fn_env_pop(c, 1, s->line, s->col);
+            bytecode_patch_jump(bc, to_end);
+            return;
+        }
+        default:
+            runtime_error(s->line, s->col, "unsupported statement in VM function compiler");
+            return;
+    }
+}
+
+#define INLINE_MAX_STMTS 8
+
+/* Statements in a body, or INLINE_MAX_STMTS + 1 once it holds a loop or try (too big to copy). */
+static int inline_body_size(Block *block) {
+    int n = 0;
+    for (int i = 0; i < block->count && n <= INLINE_MAX_STMTS; i++) {
+        Stmt *s = block->items[i];
+        n++;
+        switch (s->kind) {
+            case STMT_WHILE:
+            case STMT_FOR:
+            case STMT_TRY:
+                return INLINE_MAX_STMTS + 1;
+            case STMT_IF:
+                n += inline_body_size(s->as.if_stmt.then_block);
+                if (s->as.if_stmt.else_block) n += inline_body_size(s->as.if_stmt.else_block);
                 break;
-            }
-            case BC_AND:
-            case BC_OR: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
-                int lv = is_truthy(left);
-                int rv = is_truthy(right);
-                vstack_push(&st, value_bool(in.op == BC_AND ? (lv && rv) : (lv || rv)));
+            case STMT_SWITCH:
+                for (int c = 0; c < s->as.switch_stmt->case_count; c++) {
+                    n += inline_body_size(s->as.switch_stmt->case_blocks[c]);
+                }
+                if (s->as.switch_stmt->default_block) n += inline_body_size(s->as.switch_stmt->default_block);
                 break;
-            }
-            case BC_COALESCE: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
-                vstack_push(&st, left.type != VAL_NULL ? left : right);
+            default:
                 break;
-            }
-            case BC_LT:
-            case BC_GT:
-            case BC_LE:
-            case BC_GE: {
-                Value right = vstack_pop(&st, in.line, in.col);
-                Value left = vstack_pop(&st, in.line, in.col);
+        }
+    }
+    return n;
+}
+
+/* Whether some `return f(...)` in the body would lose its tail call once inlined. */
+static int inline_body_tail_calls(Block *block) {
+    for (int i = 0; i < block->count; i++) {
+        Stmt *s = block->items[i];
+        switch (s->kind) {
+            case STMT_RETURN:
+                if (s->as.return_stmt.tail_call) return 1;
+                break;
+            case STMT_IF:
+                if (inline_body_tail_calls(s->as.if_stmt.then_block)) return 1;
+                if (s->as.if_stmt.else_block && inline_body_tail_calls(s->as.if_stmt.else_block)) return 1;
+                break;
+            case STMT_SWITCH:
+                for (int c = 0; c < s->as.switch_stmt->case_count; c++) {
+                    if (inline_body_tail_calls(s->as.switch_stmt->case_blocks[c])) return 1;
+                }
+                if (s->as.switch_stmt->default_block && inline_body_tail_calls(s->as.switch_stmt->default_block)) return 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+/* What `f` or `module.f` names right now, seen from the function being compiled. */
+static Function *inline_target(Env *scope, Expr *callee) {
+    Value v;
+    if (callee->kind == EXPR_IDENT) {
+        if (!env_get(scope, callee->as.ident, &v)) return NULL;
+    } else if (callee->kind == EXPR_DOT && expr_at(callee->as.dot.left)->kind == EXPR_IDENT) {
+        Value module;
+        if (!env_get(scope, expr_at(callee->as.dot.left)->as.ident, &module)) return NULL;
+        if (module.type != VAL_OBJECT || module.as.object_val->kind != OBJ_MODULE) return NULL;
+        v = object_get(module.as.object_val, callee->as.dot.member);
+    } else {
+        return NULL;
+    }
+    return v.type == VAL_FUNCTION ? v.as.fn_val : NULL;
+}
+
+/*
+ * Inlines a call to a small function whose body cannot capture its Env, resolved through the
+ * caller's closure at compile time. The callee is still evaluated at run time and INLINE_ENTER
+ * checks it is a function with that very body; if the name was rebound it falls through to a
+ * JUMP to the ordinary call. Only one level deep: calls inside an inlined body stay calls.
+ *
+ *     <callee> <args> INLINE_ENTER; JUMP slow; <body, returns jump to leave>; PUSH_NULL
+ *     leave: INLINE_LEAVE; JUMP end; slow: CALL|TAIL_CALL argc; end:
+ */
+static int compile_inline_call(Expr *call, Bytecode *bc, BytecodeOp slow_op) {
+    FnCompiler *c = g_fn_compiler;
+    if (c == NULL || c->bc != bc || c->inlining || c->scope == NULL) return 0;
+    Function *target = inline_target(c->scope, expr_at(call->as.call.callee));
+    if (target == NULL || target->body == c->self_body || target->param_count != call->as.call.argc) return 0;
+    Block *body = target->body;
+    if (inline_body_size(body) > INLINE_MAX_STMTS || block_may_capture(body) || !fn_block_supported(body, 0)) return 0;
+    /* At a tail site, the callee's own tail calls must stay tail calls or deep mutual recursion overflows. */
+    if (slow_op == BC_TAIL_CALL && inline_body_tail_calls(body)) return 0;
+    for (int i = 0; i < target->param_count; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(target->params[i], target->params[j]) == 0) return 0; /* INLINE_ENTER reuses slots by position */
+        }
+    }
+
+    compile_fn_expr(c, expr_at(call->as.call.callee));
+    for (int i = 0; i < call->as.call.argc; i++) {
+        compile_fn_expr(c, expr_at(call->as.call.args[i]));
+    }
+    const char *name = expr_at(call->as.call.callee)->kind == EXPR_IDENT ? expr_at(call->as.call.callee)->as.ident
+                                                                  : expr_at(call->as.call.callee)->as.dot.member;
+    InlineSite *site = (InlineSite *)xmalloc(sizeof(InlineSite));
+    site->body = body;
+    site->spare = NULL;
+    bytecode_emit(bc, BC_INLINE_ENTER, call->as.call.argc, name, call->line, call->col);
+    bc->items[bc->count - 1].aux = site;
+    int to_slow = bytecode_emit_jump(bc, BC_JUMP, call->line, call->col);
+
+    c->inlining = 1;
+    c->inline_env_depth = c->env_depth;
+    c->inline_exit_count = 0;
+    compile_fn_block(c, body);
+    bytecode_emit(bc, BC_PUSH_NULL, 0, NULL, call->line, call->col);
+    for (int i = 0; i < c->inline_exit_count; i++) {
+        bytecode_patch_jump(bc, c->inline_exits[i]);
+    }
+    c->inlining = 0;
+    bytecode_emit(bc, BC_INLINE_LEAVE, 0, NULL, call->line, call->col);
+    bc->items[bc->count - 1].aux = site;
+    int to_end = bytecode_emit_jump(bc, BC_JUMP, call->line, call->col);
+    bytecode_patch_jump(bc, to_slow);
+    bytecode_emit(bc, slow_op, call->as.call.argc, NULL, call->line, call->col);
+    bytecode_patch_jump(bc, to_end);
+    return 1;
+}
+
+static FnCodeCacheEntry *fn_code_cache_find(Block *body) {
+    for (int i = 0; i < g_fn_code_cache_count; i++) {
+        if (g_fn_code_cache[i]->body == body) return g_fn_code_cache[i];
+    }
+    return NULL;
+}
+
+static FnCodeCacheEntry *fn_code_cache_add(Block *body, int supported) {
+    if (g_fn_code_cache_count == g_fn_code_cache_cap) {
+        int next_cap = g_fn_code_cache_cap == 0 ? 32 : g_fn_code_cache_cap * 2;
+        g_fn_code_cache = (FnCodeCacheEntry **)xrealloc(g_fn_code_cache, (size_t)next_cap * sizeof(FnCodeCacheEntry *));
+        g_fn_code_cache_cap = next_cap;
+    }
+
+    FnCodeCacheEntry *entry = (FnCodeCacheEntry *)xmalloc(sizeof(FnCodeCacheEntry));
+    g_fn_code_cache[g_fn_code_cache_count++] = entry;
+    entry->body = body;
+    entry->code.items = NULL;
+    entry->code.count = 0;
+    entry->code.cap = 0;
+    entry->code.handlers = NULL;
+    entry->code.handler_count = 0;
+    entry->code.handler_cap = 0;
+    entry->code.hot = 0;
+    entry->code.jit = NULL;
+    entry->supported = supported;
+    return entry;
+}
+
+static void fn_compiler_init(FnCompiler *c, Bytecode *bc) {
+    c->bc = bc;
+    c->env_depth = 0;
+    c->stack_depth = 0;
+    c->loop.env_depth = 0;
+    c->loop.continue_target = -1;
+    c->loop.break_jumps = NULL;
+    c->loop.break_count = 0;
+    c->loop.break_cap = 0;
+    c->scope = NULL;
+    c->self_body = NULL;
+    c->inlining = 0;
+    c->inline_env_depth = 0;
+    c->inline_exits = NULL;
+    c->inline_exit_count = 0;
+    c->inline_exit_cap = 0;
+}
+
+static struct Bytecode *vm_function_code(Function *f) {
+    if (f->code_resolved) return f->code;
+    f->code_resolved = 1;
+
+    FnCodeCacheEntry *entry = fn_code_cache_find(f->body);
+    if (entry != NULL) {
+        f->code = entry->supported ? &entry->code : NULL;
+        return f->code;
+    }
+    entry = fn_code_cache_add(f->body, fn_block_supported(f->body, 0));
+    if (!entry->supported) {
+        f->code = NULL;
+        return NULL;
+    }
+
+    FnCompiler c;
+    fn_compiler_init(&c, &entry->code);
+    c.scope = f->closure;
+    c.self_body = f->body;
+    g_fn_compiler = &c;
+    compile_fn_block(&c, f->body);
+    g_fn_compiler = NULL;
+    xfree(c.inline_exits);
+    bytecode_emit(&entry->code, BC_PUSH_NULL, 0, NULL, 0, 0);
+    bytecode_emit(&entry->code, BC_RETURN, 0, NULL, 0, 0);
+    bytecode_peephole(&entry->code);
+    if (g_dump_bytecode) {
+        int line = f->body->count > 0 ? f->body->items[0]->line : 0;
+        int col = f->body->count > 0 ? f->body->items[0]->col : 0;
+        bytecode_dump("fn", line, col, &entry->code);
+    }
+    f->code = &entry->code;
+    return f->code;
+}
+
+/*
+ * --tiered on-stack replacement: frame code for a single while loop, entered at an iteration
+ * boundary in the AST walker's Env. A `return` inside would have nowhere to go, so loops
+ * containing one stay in the walker.
+ */
+static Bytecode *vm_loop_code(Stmt *loop) {
+    Block *body = loop->as.while_stmt.body;
+    FnCodeCacheEntry *entry = fn_code_cache_find(body);
+    if (entry != NULL) return entry->supported ? &entry->code : NULL;
+    entry = fn_code_cache_add(body, fn_block_supported(body, 1) && !block_has_return(body));
+    if (!entry->supported) return NULL;
+
+    FnCompiler c;
+    fn_compiler_init(&c, &entry->code);
+    g_fn_compiler = &c;
+    compile_fn_while(&c, loop);
+    g_fn_compiler = NULL;
+    bytecode_peephole(&entry->code);
+    if (g_dump_bytecode) bytecode_dump("loop", loop->line, loop->col, &entry->code);
+    return &entry->code;
+}
+
+typedef struct {
+    Value *items;
+    int count;
+    int cap;
+    int base;
+} ValueStack;
+
+/* One operand stack per interpreter: every vm_exec runs on a window above `base`. */
+/* A frame is an expression evaluation or a call into function frame code (is_call). */
+typedef struct {
+    Bytecode *code;
+    int pc;
+    int saved_base;
+    Env *env;
+    Env *base_env;    /* the Env the frame was entered with */
+    int release_envs; /* body cannot capture: its Envs are freed on ENV_POP and return */
+    const char *file;
+    int is_call;
+    int entry;      /* bottom frame of a vm_run, pushed by vm_exec or vm_call_compiled */
+    int call_depth; /* g_call_depth while this frame runs */
+    Env *inline_env;         /* caller Env and file saved by INLINE_ENTER until INLINE_LEAVE */
+    const char *inline_file;
+} VmFrame;
+
+typedef struct {
+    ValueStack stack;
+    VmFrame *frames;
+    int frame_count;
+    int frame_cap;
+} VmState;
+
+#define VM_STACK_INITIAL 256
+#define VM_FRAMES_INITIAL 64
+
+static VmState g_vm = {{NULL, 0, 0, 0}, NULL, 0, 0};
+
+static void vm_state_init(void) {
+    if (g_vm.stack.cap == 0) {
+        g_vm.stack.items = (Value *)xmalloc((size_t)VM_STACK_INITIAL * sizeof(Value));
+        g_vm.stack.cap = VM_STACK_INITIAL;
+    }
+    if (g_vm.frame_cap == 0) {
+        g_vm.frames = (VmFrame *)xmalloc((size_t)VM_FRAMES_INITIAL * sizeof(VmFrame));
+        g_vm.frame_cap = VM_FRAMES_INITIAL;
+    }
+}
+
+static void vm_frame_push(Bytecode *code, Env *env, const char *file, int is_call) {
+    if (g_vm.frame_count == g_vm.frame_cap) {
+        int next_cap = g_vm.frame_cap == 0 ? VM_FRAMES_INITIAL : g_vm.frame_cap * 2;
+        g_vm.frames = (VmFrame *)xrealloc(g_vm.frames, (size_t)next_cap * sizeof(VmFrame));
+        g_vm.frame_cap = next_cap;
+    }
+    VmFrame *fr = &g_vm.frames[g_vm.frame_count++];
+    fr->code = code;
+    fr->pc = 0;
+    fr->saved_base = g_vm.stack.base;
+    fr->env = env;
+    fr->base_env = env;
+    fr->release_envs = 0;
+    fr->file = file;
+    fr->is_call = is_call;
+    fr->entry = 0;
+    fr->call_depth = g_call_depth;
+    fr->inline_env = NULL;
+    fr->inline_file = NULL;
+    g_vm.stack.base = g_vm.stack.count;
+}
+
+static Value vm_frame_pop(void) {
+    ValueStack *st = &g_vm.stack;
+    Value out = st->count > st->base ? st->items[st->count - 1] : value_null();
+    VmFrame *fr = &g_vm.frames[--g_vm.frame_count];
+    st->count = st->base;
+    st->base = fr->saved_base;
+    if (fr->is_call) g_call_depth--;
+    return out;
+}
+
+/* Before calling out to code that may throw: vm_unwind reads the top frame's pc and Env. */
+static void vm_frame_sync(int pc, Env *env) {
+    VmFrame *fr = &g_vm.frames[g_vm.frame_count - 1];
+    fr->pc = pc;
+    fr->env = env;
+}
+
+static void vstack_push(ValueStack *st, Value value) {
+    if (st->count == st->cap) {
+        int next_cap = st->cap == 0 ? VM_STACK_INITIAL : st->cap * 2;
+        st->items = (Value *)xrealloc(st->items, (size_t)next_cap * sizeof(Value));
+        st->cap = next_cap;
+    }
+    st->items[st->count++] = value;
+}
+
+static Value vstack_pop(ValueStack *st, int line, int col) {
+    if (st->count <= st->base) runtime_error(line, col, "VM stack underflow");
+    return st->items[--st->count];
+}
+
+/*
+ * A throw in frame code: finds the innermost handler covering the throwing instruction in
+ * frames [entry - 1, top] of one vm_run (each frame's pc is just past it). Frames above the
+ * catching one, including any left by nested runs, are dropped; the catching frame gets back
+ * the Env depth, operand stack and call depth of its `try`, with the thrown value pushed.
+ */
+static int vm_unwind(int entry, int top, Value thrown) {
+    ValueStack *st = &g_vm.stack;
+    for (int f = top; f >= entry - 1; f--) {
+        VmFrame *fr = &g_vm.frames[f];
+        const BytecodeHandler *h = NULL;
+        for (int i = 0; i < fr->code->handler_count && h == NULL; i++) {
+            const BytecodeHandler *cand = &fr->code->handlers[i];
+            if (fr->pc - 1 >= cand->start && fr->pc - 1 < cand->end) h = cand;
+        }
+        if (h == NULL) continue;
+
+        int base = f + 1 < g_vm.frame_count ? g_vm.frames[f + 1].saved_base : st->base;
+        Env *env = fr->env;
+        if (fr->inline_env != NULL) {
+            /* Thrown inside an inlined body, whose Env hangs off the callee's closure. */
+            env = fr->inline_env;
+            fr->file = fr->inline_file;
+            fr->inline_env = NULL;
+        }
+        int depth = 0;
+        for (Env *e = env; e != fr->base_env; e = e->parent) depth++;
+        for (; depth > h->env_depth; depth--) {
+            Env *parent = env->parent;
+            if (fr->release_envs) env_release(env);
+            env = parent;
+        }
+        fr->env = env;
+        fr->pc = h->target;
+        g_vm.frame_count = f + 1;
+        st->base = base;
+        st->count = base + h->stack_depth;
+        vstack_push(st, thrown);
+        g_call_depth = fr->call_depth;
+        return 1;
+    }
+    return 0;
+}
+
+#define BC_FEEDBACK_INT 1
+#define BC_FEEDBACK_OTHER 2
+
+static BytecodeOp bytecode_quickened(BytecodeOp op) {
+    switch (op) {
+        case BC_ADD: return BC_ADD_II;
+        case BC_SUB: return BC_SUB_II;
+        case BC_MUL: return BC_MUL_II;
+        case BC_LT: return BC_LT_II;
+        case BC_GT: return BC_GT_II;
+        case BC_LE: return BC_LE_II;
+        case BC_GE: return BC_GE_II;
+        default: return op;
+    }
+}
+
+static BytecodeOp bytecode_generic(BytecodeOp op) {
+    switch (op) {
+        case BC_ADD_II: return BC_ADD;
+        case BC_SUB_II: return BC_SUB;
+        case BC_MUL_II: return BC_MUL;
+        case BC_LT_II: return BC_LT;
+        case BC_GT_II: return BC_GT;
+        case BC_LE_II: return BC_LE;
+        case BC_GE_II: return BC_GE;
+        default: return op;
+    }
+}
+
+/*
+ * Operand-type feedback for arithmetic and comparisons. An instruction that has only ever
+ * seen int operands is rewritten in place to its _II form; once it has seen anything else
+ * it stays generic, so a polymorphic site deopts at most once.
+ */
+static void bytecode_feedback(BytecodeInstr *ip, Value left, Value right) {
+    if (left.type != VAL_INT || right.type != VAL_INT) {
+        ip->feedback |= BC_FEEDBACK_OTHER;
+        return;
+    }
+    ip->feedback |= BC_FEEDBACK_INT;
+    if (ip->feedback == BC_FEEDBACK_INT) ip->op = bytecode_quickened(ip->op);
+}
+
+static void bytecode_deopt(BytecodeInstr *ip) {
+    ip->op = bytecode_generic(ip->op);
+    ip->feedback |= BC_FEEDBACK_OTHER;
+}
+
+/* Guard for the _II forms: pops both operands only when they are ints. */
+static int vstack_pop_int_pair(ValueStack *st, long long *left, long long *right) {
+    if (st->count - st->base < 2) return 0;
+    Value *top = &st->items[st->count - 1];
+    if (top[-1].type != VAL_INT || top[0].type != VAL_INT) return 0;
+    *left = top[-1].as.int_val;
+    *right = top[0].as.int_val;
+    st->count -= 2;
+    return 1;
+}
+
+static long long g_op_pair_counts[BC_OP_COUNT][BC_OP_COUNT];
+
+static void op_profile_report(void) {
+    fprintf(stderr, "[profile-ops] hottest opcode pairs\n");
+    for (int rank = 0; rank < 16; rank++) {
+        int best_a = -1;
+        int best_b = -1;
+        long long best = 0;
+        for (int a = 0; a < BC_OP_COUNT; a++) {
+            for (int b = 0; b < BC_OP_COUNT; b++) {
+                if (g_op_pair_counts[a][b] > best) {
+                    best = g_op_pair_counts[a][b];
+                    best_a = a;
+                    best_b = b;
+                }
+            }
+        }
+        if (best_a < 0) break;
+        fprintf(stderr, "  %12lld  %s -> %s\n", best, k_bytecode_op_names[best_a], k_bytecode_op_names[best_b]);
+        g_op_pair_counts[best_a][best_b] = 0;
+    }
+}
+
+static Value vm_load(Env *env, const char *name, int line, int col) {
+    Value out;
+    if (!env_get(env, name, &out)) runtime_error(line, col, "undefined identifier");
+    return out;
+}
+
+#if NYX_JIT
+/*
+ * --jit: a template JIT for hot function frame code. Each instruction becomes a fixed
+ * machine-code template: integer arithmetic, comparisons, constants and jumps run inline
+ * behind type guards, most other opcodes call a small C helper, and anything else (calls,
+ * throws, allocation-heavy builds) is a side exit. A side exit returns the pc of the
+ * instruction it could not run; vm_run executes that one instruction and re-enters the
+ * native code at the next pc, so calls still push heap frames and deoptimisation is just
+ * "let the interpreter have this instruction". The operand stack and Envs are the VM's own.
+ */
+#ifndef JIT_HOT_CALLS
+#define JIT_HOT_CALLS 10
+#endif
+
+typedef struct {
+    Env *env;
+    const char *file;
+    int release_envs;
+} JitCtx;
+
+typedef int (*JitEntry)(JitCtx *ctx, int pc);
+typedef int (*JitHelper)(JitCtx *ctx, const BytecodeInstr *in);
+
+struct JitCode {
+    unsigned char *mem;
+    size_t size;
+    JitEntry entry;
+};
+
+typedef enum {
+    JIT_TO_LABEL = 0, /* start of instruction `target` (target == count means "returned") */
+    JIT_TO_EXIT       /* side exit reporting pc `target` */
+} JitFixupKind;
+
+typedef struct {
+    size_t at; /* offset of a rel32 field */
+    int target;
+    JitFixupKind kind;
+} JitFixup;
+
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    size_t cap;
+    JitFixup *fixups;
+    int fixup_count;
+    int fixup_cap;
+} JitAsm;
+
+static FILE *g_jit_perf_map = NULL;
+
+static void jit_emit(JitAsm *a, const char *bytes, size_t n) {
+    if (a->len + n > a->cap) {
+        size_t next = a->cap == 0 ? 4096 : a->cap * 2;
+        while (next < a->len + n) next *= 2;
+        a->buf = (unsigned char *)xrealloc(a->buf, next);
+        a->cap = next;
+    }
+    memcpy(a->buf + a->len, bytes, n);
+    a->len += n;
+}
+
+#define JIT_EMIT(a, lit) jit_emit((a), (lit), sizeof(lit) - 1)
+
+static void jit_u8(JitAsm *a, int v) {
+    char b = (char)(unsigned char)v;
+    jit_emit(a, &b, 1);
+}
+
+static void jit_u32(JitAsm *a, uint32_t v) {
+    char b[4];
+    for (int i = 0; i < 4; i++) b[i] = (char)((v >> (8 * i)) & 0xFF);
+    jit_emit(a, b, 4);
+}
+
+static void jit_u64(JitAsm *a, uint64_t v) {
+    jit_u32(a, (uint32_t)v);
+    jit_u32(a, (uint32_t)(v >> 32));
+}
+
+/* Emits `op rel32` with the displacement patched once every label is known. */
+static void jit_branch(JitAsm *a, const char *op, size_t n, JitFixupKind kind, int target) {
+    jit_emit(a, op, n);
+    if (a->fixup_count == a->fixup_cap) {
+        int next = a->fixup_cap == 0 ? 64 : a->fixup_cap * 2;
+        a->fixups = (JitFixup *)xrealloc(a->fixups, (size_t)next * sizeof(JitFixup));
+        a->fixup_cap = next;
+    }
+    a->fixups[a->fixup_count].at = a->len;
+    a->fixups[a->fixup_count].target = target;
+    a->fixups[a->fixup_count].kind = kind;
+    a->fixup_count++;
+    jit_u32(a, 0);
+}
+
+#define JIT_JMP "\xE9"
+#define JIT_JE "\x0F\x84"
+#define JIT_JNE "\x0F\x85"
+#define JIT_JL "\x0F\x8C"
+#define JIT_JGE "\x0F\x8D"
+
+/*
+ * rbx = JitCtx*, r12 = pc -> address table, r13 = &g_vm.stack. Leaves ecx = stack count and
+ * rax = &items[count], after checking that `need` operands exist and, if `room`, that one
+ * push fits without growing the stack. A failed check exits at `pc`.
+ */
+static void jit_stack_top(JitAsm *a, int pc, int need, int room) {
+    JIT_EMIT(a, "\x41\x8B\x4D"); /* mov ecx, [r13+count] */
+    jit_u8(a, (int)offsetof(ValueStack, count));
+    if (need > 0) {
+        JIT_EMIT(a, "\x89\xCA\x41\x2B\x55"); /* mov edx, ecx; sub edx, [r13+base] */
+        jit_u8(a, (int)offsetof(ValueStack, base));
+        JIT_EMIT(a, "\x81\xFA"); /* cmp edx, need */
+        jit_u32(a, (uint32_t)need);
+        jit_branch(a, JIT_JL, 2, JIT_TO_EXIT, pc);
+    }
+    if (room) {
+        JIT_EMIT(a, "\x41\x3B\x4D"); /* cmp ecx, [r13+cap] */
+        jit_u8(a, (int)offsetof(ValueStack, cap));
+        jit_branch(a, JIT_JGE, 2, JIT_TO_EXIT, pc);
+    }
+    JIT_EMIT(a, "\x49\x8B\x45"); /* mov rax, [r13+items] */
+    jit_u8(a, (int)offsetof(ValueStack, items));
+    JIT_EMIT(a, "\x48\x63\xD1\x48\xC1\xE2\x04\x48\x01\xD0"); /* rax += (long)ecx << 4 */
+}
+
+static void jit_store_count(JitAsm *a) {
+    JIT_EMIT(a, "\x41\x89\x4D"); /* mov [r13+count], ecx */
+    jit_u8(a, (int)offsetof(ValueStack, count));
+}
+
+static void jit_push_const(JitAsm *a, int pc, ValueType type, long long payload) {
+    jit_stack_top(a, pc, 0, 1);
+    JIT_EMIT(a, "\xC7\x00"); /* mov dword [rax], type */
+    jit_u32(a, (uint32_t)type);
+    JIT_EMIT(a, "\x48\xBA"); /* mov rdx, payload; mov [rax+8], rdx */
+    jit_u64(a, (uint64_t)payload);
+    JIT_EMIT(a, "\x48\x89\x50\x08\xFF\xC1"); /* ...; inc ecx */
+    jit_store_count(a);
+}
+
+/* Both operands must be ints; the result overwrites the left slot. */
+static void jit_int_binary(JitAsm *a, int pc, BytecodeOp op) {
+    jit_stack_top(a, pc, 2, 0);
+    JIT_EMIT(a, "\x83\x78\xE0"); /* cmp dword [rax-32], VAL_INT */
+    jit_u8(a, VAL_INT);
+    jit_branch(a, JIT_JNE, 2, JIT_TO_EXIT, pc);
+    JIT_EMIT(a, "\x83\x78\xF0"); /* cmp dword [rax-16], VAL_INT */
+    jit_u8(a, VAL_INT);
+    jit_branch(a, JIT_JNE, 2, JIT_TO_EXIT, pc);
+    JIT_EMIT(a, "\x48\x8B\x50\xE8"); /* mov rdx, [rax-24] */
+    switch (op) {
+        case BC_ADD:
+        case BC_ADD_II:
+            JIT_EMIT(a, "\x48\x03\x50\xF8");
+            break;
+        case BC_SUB:
+        case BC_SUB_II:
+            JIT_EMIT(a, "\x48\x2B\x50\xF8");
+            break;
+        case BC_MUL:
+        case BC_MUL_II:
+            JIT_EMIT(a, "\x48\x0F\xAF\x50\xF8");
+            break;
+        default: {
+            JIT_EMIT(a, "\x48\x3B\x50\xF8\x0F"); /* cmp rdx, [rax-8]; setcc dl */
+            if (op == BC_LT || op == BC_LT_II) jit_u8(a, 0x9C);
+            if (op == BC_GT || op == BC_GT_II) jit_u8(a, 0x9F);
+            if (op == BC_LE || op == BC_LE_II) jit_u8(a, 0x9E);
+            if (op == BC_GE || op == BC_GE_II) jit_u8(a, 0x9D);
+            JIT_EMIT(a, "\xC2\x0F\xB6\xD2\xC7\x40\xE0"); /* movzx edx, dl; mov dword [rax-32], VAL_BOOL */
+            jit_u32(a, VAL_BOOL);
+            break;
+        }
+    }
+    JIT_EMIT(a, "\x48\x89\x50\xE8\xFF\xC9"); /* mov [rax-24], rdx; dec ecx */
+    jit_store_count(a);
+}
+
+static void jit_call_helper(JitAsm *a, JitHelper fn, const BytecodeInstr *in) {
+    JIT_EMIT(a, "\x48\x89\xDF\x48\xBE"); /* mov rdi, rbx; mov rsi, in */
+    jit_u64(a, (uint64_t)(uintptr_t)in);
+    JIT_EMIT(a, "\x48\xB8"); /* mov rax, fn; call rax */
+    jit_u64(a, (uint64_t)(uintptr_t)fn);
+    JIT_EMIT(a, "\xFF\xD0\x85\xC0"); /* ...; test eax, eax */
+}
+
+/* Helpers mirror the vm_run cases. Returning 0 means "not handled": nothing was changed
+ * and the instruction side-exits to the interpreter, which also owns the error paths. */
+static int jit_h_push_string(JitCtx *ctx, const BytecodeInstr *in) {
+    (void)ctx;
+    vstack_push(&g_vm.stack, value_string(in->sarg));
+    return 1;
+}
+
+static int jit_h_load(JitCtx *ctx, const BytecodeInstr *in) {
+    Value v;
+    if (!env_get(ctx->env, in->sarg, &v)) return 0;
+    vstack_push(&g_vm.stack, v);
+    return 1;
+}
+
+static int jit_h_define(JitCtx *ctx, const BytecodeInstr *in) {
+    env_define(ctx->env, in->sarg, vstack_pop(&g_vm.stack, in->line, in->col));
+    return 1;
+}
+
+static int jit_h_assign(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    if (st->count <= st->base || !env_assign(ctx->env, in->sarg, st->items[st->count - 1])) return 0;
+    st->count--;
+    return 1;
+}
+
+static int jit_h_eq(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    Value right = vstack_pop(st, in->line, in->col);
+    Value left = vstack_pop(st, in->line, in->col);
+    int eq = values_equal(left, right);
+    vstack_push(st, value_bool(in->op == BC_EQ ? eq : !eq));
+    return 1;
+}
+
+static int jit_h_not(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    Value v = vstack_pop(st, in->line, in->col);
+    vstack_push(st, value_bool(in->op == BC_NOT ? !is_truthy(v) : is_truthy(v)));
+    return 1;
+}
+
+static int jit_h_index_get(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    (void)in;
+    if (st->count - st->base < 2) return 0;
+    Value left = st->items[st->count - 2];
+    Value idx = st->items[st->count - 1];
+    if (left.type == VAL_ARRAY && idx.type == VAL_INT) {
+        st->count -= 2;
+        if (idx.as.int_val < 0 || idx.as.int_val >= left.as.array_val->count) {
+            vstack_push(st, value_null());
+        } else {
+            vstack_push(st, left.as.array_val->items[idx.as.int_val]);
+        }
+        return 1;
+    }
+    if (left.type == VAL_OBJECT && idx.type == VAL_STRING) {
+        st->count -= 2;
+        vstack_push(st, object_get(left.as.object_val, idx.as.str_val));
+        return 1;
+    }
+    return 0;
+}
+
+static int jit_h_dot_get(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    Value left = vstack_pop(st, in->line, in->col);
+    vstack_push(st, object_get_member_value(left, in->sarg, in->line, in->col));
+    return 1;
+}
+
+static int jit_h_method_get(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    Value left = vstack_pop(st, in->line, in->col);
+    int bind;
+    vstack_push(st, object_get_method(left, in->sarg, &bind, in->line, in->col));
+    vstack_push(st, bind ? left : value_null());
+    return 1;
+}
+
+/* Returns nonzero when the jump is taken. */
+static int jit_h_jump_keep(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    if (st->count <= st->base) runtime_error(in->line, in->col, "VM stack underflow");
+    Value top = st->items[st->count - 1];
+    int jump = 0;
+    if (in->op == BC_JUMP_IF_FALSE_KEEP) jump = !is_truthy(top);
+    if (in->op == BC_JUMP_IF_TRUE_KEEP) jump = is_truthy(top);
+    if (in->op == BC_JUMP_IF_NOT_NULL) jump = top.type != VAL_NULL;
+    if (!jump) st->count--;
+    return jump;
+}
+
+static int jit_h_stmt(JitCtx *ctx, const BytecodeInstr *in) {
+    statement_prologue((Stmt *)(intptr_t)in->iarg, ctx->env, ctx->file);
+    return 1;
+}
+
+static int jit_h_env_push(JitCtx *ctx, const BytecodeInstr *in) {
+    (void)in;
+    ctx->env = env_new(ctx->env);
+    return 1;
+}
+
+static int jit_h_env_pop(JitCtx *ctx, const BytecodeInstr *in) {
+    for (long long i = 0; i < in->iarg; i++) {
+        Env *parent = ctx->env->parent;
+        if (ctx->release_envs) env_release(ctx->env);
+        ctx->env = parent;
+    }
+    return 1;
+}
+
+/* Returns the pc to continue at, read from the JUMP row that follows the instruction. */
+static int jit_h_switch_table(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    if (st->count <= st->base) runtime_error(in->line, in->col, "VM stack underflow");
+    int k = switch_table_find((const SwitchTable *)in->aux, st->items[--st->count]);
+    return (int)in[1 + (k < 0 ? in->iarg : k)].iarg;
+}
+
+static int jit_h_env_reset(JitCtx *ctx, const BytecodeInstr *in) {
+    (void)in;
+    env_truncate(ctx->env, 0);
+    return 1;
+}
+
+static int jit_h_iter_init(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    (void)in;
+    if (st->count <= st->base) return 0;
+    Value iter = st->items[st->count - 1];
+    if (iter.type != VAL_ARRAY && iter.type != VAL_OBJECT) return 0;
+    vstack_push(st, value_int(0));
+    return 1;
+}
+
+/* A rebound name or non-int bounds leave it to the interpreter. */
+static int jit_h_range_init(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    (void)ctx;
+    int argc = (int)in->iarg;
+    if (st->count - st->base < argc || !core_builtin_intact(CORE_RANGE)) return 0;
+    Value *argv = &st->items[st->count - argc];
+    if (argv[0].type != VAL_INT || argv[argc - 1].type != VAL_INT) return 0;
+    long long start = argc == 2 ? argv[0].as.int_val : 0;
+    long long stop = argv[argc - 1].as.int_val;
+    st->count -= argc;
+    vstack_push(st, value_int(stop));
+    vstack_push(st, value_int(start));
+    return 1;
+}
+
+static int jit_h_core(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    int argc = (int)in->iarg;
+    if (st->count - st->base < argc || !core_builtin_intact(CORE_LEN + (int)(in->op - BC_CORE_LEN))) return 0;
+    Value out = vm_core_builtin(in->op, &st->items[st->count - argc], argc, in->line, in->col, ctx->file);
+    st->count -= argc;
+    vstack_push(st, out);
+    return 1;
+}
+
+/* Returns nonzero when the loop is done. */
+static int jit_h_iter_next(JitCtx *ctx, const BytecodeInstr *in) {
+    ValueStack *st = &g_vm.stack;
+    if (st->count - st->base < 2) runtime_error(in->line, in->col, "VM stack underflow");
+    Value iter = st->items[st->count - 2];
+    long long i = st->items[st->count - 1].as.int_val;
+    long long count = iter_bound(iter);
+    if (i >= count) return 1;
+    st->items[st->count - 1] = value_int(i + 1);
+    if (in->op == BC_ITER_BIND) {
+        env_truncate(ctx->env, in->sarg2 != NULL ? 2 : 1);
+    } else {
+        ctx->env = env_new(ctx->env);
+    }
+    Value key = iter.type != VAL_OBJECT ? value_int(i) : value_string(iter.as.object_val->items[i].key);
+    if (in->sarg2 != NULL) {
+        env_define(ctx->env, in->sarg, key);
+        env_define(ctx->env, in->sarg2,
+                   iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : iter.as.object_val->items[i].value);
+    } else {
+        env_define(ctx->env, in->sarg, iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : key);
+    }
+    return 0;
+}
+
+/* Fused forms; the skipped shadows are jumped over by the template. */
+static int jit_h_local_imm(JitCtx *ctx, const BytecodeInstr *in) {
+    Value left;
+    if (!env_get(ctx->env, in->sarg, &left) || left.type != VAL_INT) return 0;
+    if (in->op == BC_ADD_LOCAL_IMM) {
+        vstack_push(&g_vm.stack, value_int(left.as.int_val + in->iarg));
+    } else if (in->op == BC_SUB_LOCAL_IMM) {
+        vstack_push(&g_vm.stack, value_int(left.as.int_val - in->iarg));
+    } else {
+        vstack_push(&g_vm.stack, value_bool(left.as.int_val < in->iarg));
+    }
+    return 1;
+}
+
+static int jit_h_lt_local_local(JitCtx *ctx, const BytecodeInstr *in) {
+    Value left;
+    Value right;
+    if (!env_get(ctx->env, in->sarg, &left) || left.type != VAL_INT) return 0;
+    if (!env_get(ctx->env, in->sarg2, &right) || right.type != VAL_INT) return 0;
+    vstack_push(&g_vm.stack, value_bool(left.as.int_val < right.as.int_val));
+    return 1;
+}
+
+static int jit_h_load_dot(JitCtx *ctx, const BytecodeInstr *in) {
+    Value left;
+    if (!env_get(ctx->env, in->sarg, &left)) return 0;
+    vstack_push(&g_vm.stack, object_get_member_value(left, in->sarg2, in[1].line, in[1].col));
+    return 1;
+}
+
+static void jit_emit_instr(JitAsm *a, Bytecode *bc, int pc) {
+    const BytecodeInstr *in = &bc->items[pc];
+    int target = (int)in->iarg;
+    switch (in->op) {
+        case BC_PUSH_INT:
+            jit_push_const(a, pc, VAL_INT, in->iarg);
+            return;
+        case BC_PUSH_BOOL:
+            jit_push_const(a, pc, VAL_BOOL, in->iarg ? 1 : 0);
+            return;
+        case BC_PUSH_NULL:
+            jit_push_const(a, pc, VAL_NULL, 0);
+            return;
+        case BC_ADD:
+        case BC_SUB:
+        case BC_MUL:
+        case BC_LT:
+        case BC_GT:
+        case BC_LE:
+        case BC_GE:
+        case BC_ADD_II:
+        case BC_SUB_II:
+        case BC_MUL_II:
+        case BC_LT_II:
+        case BC_GT_II:
+        case BC_LE_II:
+        case BC_GE_II:
+            jit_int_binary(a, pc, in->op);
+            return;
+        case BC_POP:
+            jit_stack_top(a, pc, target, 0);
+            JIT_EMIT(a, "\x81\xE9"); /* sub ecx, n */
+            jit_u32(a, (uint32_t)target);
+            jit_store_count(a);
+            return;
+        case BC_DUP:
+            jit_stack_top(a, pc, 1, 1);
+            JIT_EMIT(a, "\x48\x8B\x50\xF0\x48\x89\x10\x48\x8B\x50\xF8\x48\x89\x50\x08\xFF\xC1");
+            jit_store_count(a);
+            return;
+        case BC_JUMP:
+            jit_branch(a, JIT_JMP, 1, JIT_TO_LABEL, target);
+            return;
+        case BC_JUMP_IF_FALSE:
+            /* Bool conditions only; anything else goes through is_truthy in the interpreter. */
+            jit_stack_top(a, pc, 1, 0);
+            JIT_EMIT(a, "\x83\x78\xF0"); /* cmp dword [rax-16], VAL_BOOL */
+            jit_u8(a, VAL_BOOL);
+            jit_branch(a, JIT_JNE, 2, JIT_TO_EXIT, pc);
+            JIT_EMIT(a, "\xFF\xC9"); /* dec ecx */
+            jit_store_count(a);
+            JIT_EMIT(a, "\x83\x78\xF8\x00"); /* cmp dword [rax-8], 0 */
+            jit_branch(a, JIT_JE, 2, JIT_TO_LABEL, target);
+            return;
+        case BC_RETURN:
+            jit_branch(a, JIT_JMP, 1, JIT_TO_LABEL, bc->count);
+            return;
+        case BC_PUSH_STRING:
+            jit_call_helper(a, jit_h_push_string, in);
+            return;
+        case BC_LOAD:
+            jit_call_helper(a, jit_h_load, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            return;
+        case BC_DEFINE:
+            jit_call_helper(a, jit_h_define, in);
+            return;
+        case BC_ASSIGN:
+            jit_call_helper(a, jit_h_assign, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            return;
+        case BC_EQ:
+        case BC_NEQ:
+            jit_call_helper(a, jit_h_eq, in);
+            return;
+        case BC_NOT:
+        case BC_TO_BOOL:
+            jit_call_helper(a, jit_h_not, in);
+            return;
+        case BC_INDEX_GET:
+            jit_call_helper(a, jit_h_index_get, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            return;
+        case BC_DOT_GET:
+            jit_call_helper(a, jit_h_dot_get, in);
+            return;
+        case BC_METHOD_GET:
+            jit_call_helper(a, jit_h_method_get, in);
+            return;
+        case BC_JUMP_IF_FALSE_KEEP:
+        case BC_JUMP_IF_TRUE_KEEP:
+        case BC_JUMP_IF_NOT_NULL:
+            jit_call_helper(a, jit_h_jump_keep, in);
+            jit_branch(a, JIT_JNE, 2, JIT_TO_LABEL, target);
+            return;
+        case BC_STMT:
+            jit_call_helper(a, jit_h_stmt, in);
+            return;
+        case BC_ENV_PUSH:
+            jit_call_helper(a, jit_h_env_push, in);
+            return;
+        case BC_ENV_POP:
+            jit_call_helper(a, jit_h_env_pop, in);
+            return;
+        case BC_ENV_RESET:
+            jit_call_helper(a, jit_h_env_reset, in);
+            return;
+        case BC_ITER_INIT:
+            jit_call_helper(a, jit_h_iter_init, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            return;
+        case BC_RANGE_INIT:
+            jit_call_helper(a, jit_h_range_init, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            return;
+        case BC_CORE_LEN:
+        case BC_CORE_PUSH:
+        case BC_CORE_POP:
+        case BC_CORE_HAS:
+        case BC_CORE_OBJECT_GET:
+            jit_call_helper(a, jit_h_core, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            return;
+        case BC_SWITCH_TABLE:
+            jit_call_helper(a, jit_h_switch_table, in);
+            JIT_EMIT(a, "\x48\x63\xC0\x41\xFF\x24\xC4"); /* movsxd rax, eax; jmp [r12 + rax * 8] */
+            return;
+        case BC_ITER_NEXT:
+        case BC_ITER_BIND:
+            jit_call_helper(a, jit_h_iter_next, in);
+            jit_branch(a, JIT_JNE, 2, JIT_TO_LABEL, target);
+            return;
+        case BC_ADD_LOCAL_IMM:
+        case BC_SUB_LOCAL_IMM:
+        case BC_LT_LOCAL_IMM:
+        case BC_LT_LOCAL_LOCAL:
+            jit_call_helper(a, in->op == BC_LT_LOCAL_LOCAL ? jit_h_lt_local_local : jit_h_local_imm, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            jit_branch(a, JIT_JMP, 1, JIT_TO_LABEL, pc + 3);
+            return;
+        case BC_LOAD_DOT:
+            jit_call_helper(a, jit_h_load_dot, in);
+            jit_branch(a, JIT_JE, 2, JIT_TO_EXIT, pc);
+            jit_branch(a, JIT_JMP, 1, JIT_TO_LABEL, pc + 2);
+            return;
+        default:
+            /* Calls, throws and the rarer builders stay in the interpreter. */
+            jit_branch(a, JIT_JMP, 1, JIT_TO_EXIT, pc);
+            return;
+    }
+}
+
+/* perf(1) picks up /tmp/perf-<pid>.map to symbolise JIT frames. */
+static void jit_perf_map_add(const unsigned char *code, size_t size, Function *f) {
+    if (g_jit_perf_map == NULL) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+        g_jit_perf_map = fopen(path, "w");
+        if (g_jit_perf_map == NULL) return;
+    }
+    int line = f->body->count > 0 ? f->body->items[0]->line : 0;
+    fprintf(g_jit_perf_map, "%lx %lx nyx:%s:%d\n", (unsigned long)(uintptr_t)code, (unsigned long)size,
+            f->def_file != NULL ? f->def_file : "?", line);
+    fflush(g_jit_perf_map);
+}
+
+/*
+ * Layout: [pc -> address table, count + 1 entries][prologue][one template per
+ * instruction][one exit stub per pc][epilogue]. Written to RW pages, then flipped to RX.
+ */
+static struct JitCode *jit_compile(Bytecode *bc, Function *f) {
+    if (sizeof(Value) != 16 || offsetof(Value, as) != 8) return NULL;
+    JitAsm a = {NULL, 0, 0, NULL, 0, 0};
+    size_t *labels = (size_t *)xmalloc((size_t)(bc->count + 1) * sizeof(size_t));
+    size_t *exits = (size_t *)xmalloc((size_t)(bc->count + 1) * sizeof(size_t));
+    size_t table_size = (size_t)(bc->count + 1) * sizeof(uint64_t);
+
+    JIT_EMIT(&a, "\x53\x41\x54\x41\x55\x48\x89\xFB\x49\xBC"); /* push rbx, r12, r13; rbx = ctx; r12 = table */
+    size_t table_imm = a.len;
+    jit_u64(&a, 0);
+    JIT_EMIT(&a, "\x49\xBD"); /* r13 = &g_vm.stack */
+    jit_u64(&a, (uint64_t)(uintptr_t)&g_vm.stack);
+    JIT_EMIT(&a, "\x48\x63\xF6\x41\xFF\x24\xF4"); /* jmp [r12 + pc * 8] */
+    for (int pc = 0; pc < bc->count; pc++) {
+        labels[pc] = a.len;
+        jit_emit_instr(&a, bc, pc);
+    }
+    labels[bc->count] = a.len;
+    jit_branch(&a, JIT_JMP, 1, JIT_TO_EXIT, bc->count);
+    size_t epilogue_jumps = a.len;
+    for (int pc = 0; pc <= bc->count; pc++) {
+        exits[pc] = a.len;
+        jit_u8(&a, 0xB8); /* mov eax, pc; jmp epilogue */
+        jit_u32(&a, (uint32_t)pc);
+        jit_u8(&a, 0xE9);
+        jit_u32(&a, 0);
+    }
+    size_t epilogue = a.len;
+    JIT_EMIT(&a, "\x41\x5D\x41\x5C\x5B\xC3");
+
+    for (int i = 0; i < a.fixup_count; i++) {
+        const JitFixup *fx = &a.fixups[i];
+        size_t to = fx->kind == JIT_TO_LABEL ? labels[fx->target] : exits[fx->target];
+        int32_t rel = (int32_t)((long long)to - (long long)(fx->at + 4));
+        memcpy(a.buf + fx->at, &rel, 4);
+    }
+    for (size_t at = epilogue_jumps; at < epilogue; at += 10) {
+        int32_t rel = (int32_t)((long long)epilogue - (long long)(at + 10));
+        memcpy(a.buf + at + 6, &rel, 4);
+    }
+
+    struct JitCode *jc = NULL;
+    size_t size = table_size + a.len;
+    unsigned char *mem = (unsigned char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem != MAP_FAILED) {
+        unsigned char *code = mem + table_size;
+        uint64_t table = (uint64_t)(uintptr_t)mem;
+        memcpy(a.buf + table_imm, &table, 8);
+        memcpy(code, a.buf, a.len);
+        for (int pc = 0; pc <= bc->count; pc++) {
+            uint64_t addr = (uint64_t)(uintptr_t)(code + labels[pc]);
+            memcpy(mem + (size_t)pc * sizeof(uint64_t), &addr, 8);
+        }
+        if (mprotect(mem, size, PROT_READ | PROT_EXEC) == 0) {
+            jc = (struct JitCode *)xmalloc(sizeof(struct JitCode));
+            jc->mem = mem;
+            jc->size = size;
+            jc->entry = (JitEntry)(uintptr_t)code;
+            jit_perf_map_add(code, a.len, f);
+        } else {
+            munmap(mem, size);
+        }
+    }
+    xfree(labels);
+    xfree(exits);
+    xfree(a.buf);
+    xfree(a.fixups);
+    return jc;
+}
+
+/* Counts calls into frame code and compiles it once; a failed compile is not retried.
+ * --profile-ops keeps everything interpreted so the pair counts stay complete. */
+static void jit_note_call(Bytecode *bc, Function *f) {
+    if (bc->hot < 0 || g_profile_ops || ++bc->hot < JIT_HOT_CALLS) return;
+    bc->hot = -1;
+    bc->jit = jit_compile(bc, f);
+}
+
+static int jit_enter(Bytecode *bc, int pc, Env **env, const char *file, int release_envs) {
+    JitCtx ctx;
+    ctx.env = *env;
+    ctx.file = file;
+    ctx.release_envs = release_envs;
+    pc = bc->jit->entry(&ctx, pc);
+    *env = ctx.env;
+    return pc;
+}
+#endif
+
+/*
+ * Runs the top frame until it returns. Calls into compiled functions push a frame and keep
+ * going in this loop; only builtins and functions without frame code recurse through
+ * apply_function. Expression frames return by running off the end of their code, and
+ * RETURN jumps there with the result on top of the stack. TAIL_CALL replaces the running
+ * call frame instead of pushing one, so tail recursion runs in constant frames and depth.
+ *
+ * Without a `guard`, returns 0 as soon as it reaches frame code that has a try, with the top
+ * frame synced, so vm_run can set one up; otherwise stores the result in *out and returns 1.
+ */
+static int vm_run_frames(ImportSet *imports, int entry, ExceptionFrame *guard, Value *out) {
+    ValueStack *st = &g_vm.stack;
+    VmFrame *fr = &g_vm.frames[g_vm.frame_count - 1];
+    Bytecode *bc = fr->code;
+    int pc = fr->pc;
+    Env *env = fr->env;
+    const char *current_file = fr->file;
+    int release_envs = fr->release_envs;
+
+    int prev_op = -1;
+#if NYX_JIT
+    int jit_skip = 0; /* the native code just side-exited at pc: interpret that instruction */
+#endif
+    if (guard == NULL && bc->handler_count > 0) return 0;
+    for (;;) {
+        if (pc >= bc->count) {
+            fr = &g_vm.frames[g_vm.frame_count - 1];
+            if (release_envs) env_release_until(env, fr->base_env->parent);
+            Value result = vm_frame_pop();
+            if (g_vm.frame_count < entry) {
+                *out = result;
+                return 1;
+            }
+            fr = &g_vm.frames[g_vm.frame_count - 1];
+            bc = fr->code;
+            pc = fr->pc;
+            env = fr->env;
+            current_file = fr->file;
+            release_envs = fr->release_envs;
+            vstack_push(st, result);
+            continue;
+        }
+#if NYX_JIT
+        if (bc->jit != NULL && !jit_skip) {
+            pc = jit_enter(bc, pc, &env, current_file, release_envs);
+            jit_skip = 1;
+            continue;
+        }
+        jit_skip = 0;
+#endif
+        BytecodeInstr in = bc->items[pc++];
+        if (g_profile_ops) {
+            if (prev_op >= 0) g_op_pair_counts[prev_op][in.op]++;
+            prev_op = (int)in.op;
+        }
+        switch (in.op) {
+            case BC_PUSH_INT:
+                vstack_push(st, value_int(in.iarg));
+                break;
+            case BC_PUSH_STRING:
+                vstack_push(st, value_string(in.sarg));
+                break;
+            case BC_PUSH_BOOL:
+                vstack_push(st, value_bool(in.iarg ? 1 : 0));
+                break;
+            case BC_PUSH_NULL:
+                vstack_push(st, value_null());
+                break;
+            case BC_LOAD:
+                vstack_push(st, vm_load(env, in.sarg, in.line, in.col));
+                break;
+            case BC_ARRAY_MAKE: {
+                int n = (int)in.iarg;
+                if (n < 0 || st->count - st->base < n) runtime_error(in.line, in.col, "invalid array build");
+                Value *items = (Value *)xmalloc((size_t)n * sizeof(Value));
+                for (int i = n - 1; i >= 0; i--) {
+                    items[i] = vstack_pop(st, in.line, in.col);
+                }
+                vstack_push(st, value_array(items, n));
+                break;
+            }
+            case BC_COMP_INIT: {
+                /* [iterable] -> [iterable, index, out, cap]; the output is presized to the iterable. */
+                if (st->count <= st->base) runtime_error(in.line, in.col, "VM stack underflow");
+                Value iter = st->items[st->count - 1];
+                if (iter.type != VAL_ARRAY && iter.type != VAL_OBJECT) {
+                    runtime_error(in.line, in.col, "array comprehension expects array or object iterable");
+                }
+                int n = iter.type == VAL_ARRAY ? iter.as.array_val->count : iter.as.object_val->count;
+                vstack_push(st, value_int(0));
+                vstack_push(st, value_array(n > 0 ? (Value *)xmalloc((size_t)n * sizeof(Value)) : NULL, 0));
+                vstack_push(st, value_int(n));
+                env = env_new(env);
+                env_define(env, in.sarg, value_null());
+                if (in.sarg2 != NULL) env_define(env, in.sarg2, value_null());
+                break;
+            }
+            case BC_COMP_NEXT: {
+                /* Expressions cannot capture the comprehension Env, so each element just rebinds it. */
+                Value iter = st->items[st->count - 4];
+                long long i = st->items[st->count - 3].as.int_val;
+                int count = iter.type == VAL_ARRAY ? iter.as.array_val->count : iter.as.object_val->count;
+                if (i >= count) {
+                    pc = (int)in.iarg;
+                    break;
+                }
+                st->items[st->count - 3] = value_int(i + 1);
+                Value key = iter.type == VAL_ARRAY ? value_int(i) : value_string(iter.as.object_val->items[i].key);
+                if (in.sarg2 != NULL) {
+                    env->items[0].value = key;
+                    env->items[env->count - 1].value =
+                        iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : iter.as.object_val->items[i].value;
+                } else {
+                    env->items[0].value = iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : key;
+                }
+                break;
+            }
+            case BC_COMP_APPEND: {
+                Value v = vstack_pop(st, in.line, in.col);
+                Array *out = st->items[st->count - 2].as.array_val;
+                long long cap = st->items[st->count - 1].as.int_val;
+                if (out->count == cap) {
+                    /* The iterable grew while the comprehension ran. */
+                    cap = cap < 8 ? 8 : cap * 2;
+                    out->items = (Value *)xrealloc(out->items, (size_t)cap * sizeof(Value));
+                    st->items[st->count - 1] = value_int(cap);
+                }
+                out->items[out->count++] = v;
+                break;
+            }
+            case BC_COMP_END: {
+                Array *out = st->items[st->count - 2].as.array_val;
+                if (out->count < st->items[st->count - 1].as.int_val) {
+                    /* A filter dropped elements: give back the unused tail. */
+                    if (out->count == 0) {
+                        xfree(out->items);
+                        out->items = NULL;
+                    } else {
+                        out->items = (Value *)xrealloc(out->items, (size_t)out->count * sizeof(Value));
+                    }
+                }
+                Env *comp_env = env;
+                env = env->parent;
+                env_release(comp_env);
+                st->items[st->count - 4] = st->items[st->count - 2];
+                st->count -= 3;
+                break;
+            }
+            case BC_OBJECT_NEW:
+                vstack_push(st, value_object(object_new()));
+                break;
+            case BC_OBJECT_SET_KEY: {
+                Value value = vstack_pop(st, in.line, in.col);
+                Value obj = vstack_pop(st, in.line, in.col);
+                if (obj.type != VAL_OBJECT) runtime_error(in.line, in.col, "object build expected object value");
+                object_set(obj.as.object_val, in.sarg, value);
+                vstack_push(st, obj);
+                break;
+            }
+            case BC_INDEX_GET: {
+                Value idx = vstack_pop(st, in.line, in.col);
+                Value left = vstack_pop(st, in.line, in.col);
+                if (left.type == VAL_ARRAY && idx.type == VAL_INT) {
+                    if (idx.as.int_val < 0 || idx.as.int_val >= left.as.array_val->count) {
+                        vstack_push(st, value_null());
+                    } else {
+                        vstack_push(st, left.as.array_val->items[idx.as.int_val]);
+                    }
+                    break;
+                }
+                if (left.type == VAL_OBJECT && idx.type == VAL_STRING) {
+                    vstack_push(st, object_get(left.as.object_val, idx.as.str_val));
+                    break;
+                }
+                runtime_error(in.line, in.col, "indexing expects array[int] or object[string]");
+                break;
+            }
+            case BC_DOT_GET: {
+                Value left = vstack_pop(st, in.line, in.col);
+                vstack_push(st, object_get_member_value(left, in.sarg, in.line, in.col));
+                break;
+            }
+            case BC_METHOD_GET: {
+                Value left = vstack_pop(st, in.line, in.col);
+                int bind;
+                vstack_push(st, object_get_method(left, in.sarg, &bind, in.line, in.col));
+                vstack_push(st, bind ? left : value_null());
+                break;
+            }
+            case BC_NEG: {
+                Value right = vstack_pop(st, in.line, in.col);
+                if (right.type != VAL_INT) runtime_error(in.line, in.col, "unary '-' expects integer");
+                vstack_push(st, value_int(-right.as.int_val));
+                break;
+            }
+            case BC_NOT: {
+                Value right = vstack_pop(st, in.line, in.col);
+                vstack_push(st, value_bool(!is_truthy(right)));
+                break;
+            }
+            case BC_ADD: {
+                Value right = vstack_pop(st, in.line, in.col);
+                Value left = vstack_pop(st, in.line, in.col);
+                bytecode_feedback(&bc->items[pc - 1], left, right);
+                if (left.type == VAL_INT && right.type == VAL_INT) {
+                    vstack_push(st, value_int(left.as.int_val + right.as.int_val));
+                    break;
+                }
+                if (left.type == VAL_STRING && right.type == VAL_STRING) {
+                    char *joined = str_concat(left.as.str_val, right.as.str_val);
+                    Value out = value_string(joined);
+                    xfree(joined);
+                    vstack_push(st, out);
+                    break;
+                }
+                runtime_error(in.line, in.col, "'+' expects int+int or string+string");
+                break;
+            }
+            case BC_SUB:
+            case BC_MUL:
+            case BC_DIV:
+            case BC_MOD:
+            case BC_SHL: {
+                Value right = vstack_pop(st, in.line, in.col);
+                Value left = vstack_pop(st, in.line, in.col);
+                if (in.op == BC_SUB || in.op == BC_MUL) bytecode_feedback(&bc->items[pc - 1], left, right);
+                if (left.type != VAL_INT || right.type != VAL_INT) {
+                    runtime_error(in.line, in.col, "arithmetic expects integers");
+                }
+                if (in.op == BC_SUB) {
+                    vstack_push(st, value_int(left.as.int_val - right.as.int_val));
+                } else if (in.op == BC_MUL) {
+                    vstack_push(st, value_int(left.as.int_val * right.as.int_val));
+                } else if (in.op == BC_SHL) {
+                    vstack_push(st, value_int((long long)((unsigned long long)left.as.int_val << right.as.int_val)));
+                } else if (in.op == BC_DIV) {
+                    if (right.as.int_val == 0) runtime_error(in.line, in.col, "division by zero");
+                    vstack_push(st, value_int(left.as.int_val / right.as.int_val));
+                } else {
+                    if (right.as.int_val == 0) runtime_error(in.line, in.col, "division by zero");
+                    vstack_push(st, value_int(left.as.int_val % right.as.int_val));
+                }
+                break;
+            }
+            case BC_EQ:
+            case BC_NEQ: {
+                Value right = vstack_pop(st, in.line, in.col);
+                Value left = vstack_pop(st, in.line, in.col);
+                int eq = values_equal(left, right);
+                vstack_push(st, value_bool(in.op == BC_EQ ? eq : !eq));
+                break;
+            }
+            case BC_TO_BOOL: {
+                Value v = vstack_pop(st, in.line, in.col);
+                vstack_push(st, value_bool(is_truthy(v)));
+                break;
+            }
+            case BC_JUMP_IF_FALSE_KEEP:
+            case BC_JUMP_IF_TRUE_KEEP:
+            case BC_JUMP_IF_NOT_NULL: {
+                /* Taking the jump leaves the deciding operand as the result; otherwise it is dropped. */
+                if (st->count <= st->base) runtime_error(in.line, in.col, "VM stack underflow");
+                Value top = st->items[st->count - 1];
+                int jump = 0;
+                if (in.op == BC_JUMP_IF_FALSE_KEEP) jump = !is_truthy(top);
+                if (in.op == BC_JUMP_IF_TRUE_KEEP) jump = is_truthy(top);
+                if (in.op == BC_JUMP_IF_NOT_NULL) jump = top.type != VAL_NULL;
+                if (jump) {
+                    pc = (int)in.iarg;
+                } else {
+                    st->count--;
+                }
+                break;
+            }
+            case BC_LT:
+            case BC_GT:
+            case BC_LE:
+            case BC_GE: {
+                Value right = vstack_pop(st, in.line, in.col);
+                Value left = vstack_pop(st, in.line, in.col);
+                bytecode_feedback(&bc->items[pc - 1], left, right);
                 if (left.type != VAL_INT || right.type != VAL_INT) {
                     runtime_error(in.line, in.col, "comparison expects integers");
                 }
-                int ok = 0;
-                if (in.op == BC_LT) ok = left.as.int_val < right.as.int_val;
-                if (in.op == BC_GT) ok = left.as.int_val > right.as.int_val;
-                if (in.op == BC_LE) ok = left.as.int_val <= right.as.int_val;
-                if (in.op == BC_GE) ok = left.as.int_val >= right.as.int_val;
-                vstack_push(&st, value_bool(ok));
+                int ok = 0;
+                if (in.op == BC_LT) ok = left.as.int_val < right.as.int_val;
+                if (in.op == BC_GT) ok = left.as.int_val > right.as.int_val;
+                if (in.op == BC_LE) ok = left.as.int_val <= right.as.int_val;
+                if (in.op == BC_GE) ok = left.as.int_val >= right.as.int_val;
+                vstack_push(st, value_bool(ok));
+                break;
+            }
+            case BC_CORE_LEN:
+            case BC_CORE_PUSH:
+            case BC_CORE_POP:
+            case BC_CORE_HAS:
+            case BC_CORE_OBJECT_GET: {
+                int argc = (int)in.iarg;
+                if (st->count - st->base < argc) runtime_error(in.line, in.col, "VM stack underflow");
+                Value *argv = &st->items[st->count - argc];
+                Value out;
+                if (core_builtin_intact(CORE_LEN + (int)(in.op - BC_CORE_LEN))) {
+                    out = vm_core_builtin(in.op, argv, argc, in.line, in.col, current_file);
+                    st->count -= argc;
+                } else {
+                    /* Rebound: an ordinary call of whatever the name holds now. */
+                    Value callee = vm_load(env, in.sarg, in.line, in.col);
+                    Value *window = arg_window_take(argc);
+                    memcpy(window + 1, argv, (size_t)argc * sizeof(Value));
+                    st->count -= argc;
+                    vm_frame_sync(pc, env);
+                    out = apply_function(callee, window + 1, argc, in.line, in.col, imports, current_file);
+                    arg_window_drop(window);
+                }
+                vstack_push(st, out);
+                break;
+            }
+            case BC_CALL:
+            case BC_CALL_METHOD:
+            case BC_TAIL_CALL:
+            case BC_TAIL_CALL_METHOD: {
+                int argc = (int)in.iarg;
+                int tail = in.op == BC_TAIL_CALL || in.op == BC_TAIL_CALL_METHOD;
+                if (in.op == BC_CALL_METHOD || in.op == BC_TAIL_CALL_METHOD) {
+                    /* self (an object) becomes the first argument; a null placeholder is closed up. */
+                    if (argc < 0 || st->count - st->base < argc + 2) runtime_error(in.line, in.col, "invalid call frame");
+                    Value *self = &st->items[st->count - argc - 1];
+                    if (self->type == VAL_NULL) {
+                        memmove(self, self + 1, (size_t)argc * sizeof(Value));
+                        st->count--;
+                    } else {
+                        argc++;
+                    }
+                }
+                if (argc < 0 || st->count - st->base < argc + 1) runtime_error(in.line, in.col, "invalid call frame");
+                Value *argv = &st->items[st->count - argc];
+                Value callee = argv[-1];
+                Function *target = NULL;
+                if (callee.type == VAL_FUNCTION) {
+                    target = callee.as.fn_val;
+                } else if (callee.type == VAL_BOUND_METHOD && callee.as.bound_method_val->fn.type == VAL_FUNCTION) {
+                    target = callee.as.bound_method_val->fn.as.fn_val;
+                }
+                if (target != NULL && vm_function_code(target) != NULL) {
+                    if (callee.type == VAL_BOUND_METHOD) {
+                        /* self takes the callee's slot and becomes the first argument. */
+                        argv[-1] = callee.as.bound_method_val->self;
+                        argv--;
+                        argc++;
+                    }
+                    if (argc != target->param_count) runtime_error(in.line, in.col, "wrong number of function arguments");
+                    fr = &g_vm.frames[g_vm.frame_count - 1];
+                    Env *call_env;
+                    if (tail) {
+                        /* Same depth, same frame; a capture-free frame recycles its base Env too. */
+                        if (release_envs) {
+                            env_release_until(env, fr->base_env);
+                            call_env = fr->base_env;
+                            env_clear(call_env);
+                            call_env->parent = target->closure;
+                        } else {
+                            call_env = env_new(target->closure);
+                        }
+                        for (int i = 0; i < argc; i++) {
+                            env_define(call_env, target->params[i], argv[i]);
+                        }
+                        st->count = st->base;
+                        fr->code = target->code;
+                        fr->env = call_env;
+                        fr->base_env = call_env;
+                        fr->file = target->def_file;
+                    } else {
+                        g_call_depth++;
+                        if (g_call_depth > g_max_call_depth) runtime_error(in.line, in.col, "max call depth exceeded");
+                        call_env = env_new(target->closure);
+                        for (int i = 0; i < argc; i++) {
+                            env_define(call_env, target->params[i], argv[i]);
+                        }
+                        st->count = (int)(argv - st->items) - (callee.type == VAL_BOUND_METHOD ? 0 : 1);
+                        fr->pc = pc;
+                        fr->env = env;
+                        vm_frame_push(target->code, call_env, target->def_file, 1);
+                        fr = &g_vm.frames[g_vm.frame_count - 1];
+                    }
+                    fr->release_envs = !block_may_capture(target->body);
+                    bc = target->code;
+                    pc = 0;
+#if NYX_JIT
+                    if (g_jit) jit_note_call(bc, target);
+#endif
+                    env = call_env;
+                    current_file = target->def_file;
+                    release_envs = fr->release_envs;
+                    if (guard == NULL && bc->handler_count > 0) {
+                        vm_frame_sync(pc, env);
+                        return 0;
+                    }
+                    break;
+                }
+                /* Copied off the stack, which a builtin calling back into the VM may reallocate. */
+                Value *window = arg_window_take(argc);
+                memcpy(window + 1, argv, (size_t)argc * sizeof(Value));
+                st->count -= argc + 1;
+                vm_frame_sync(pc, env);
+                Value out = apply_function(callee, window + 1, argc, in.line, in.col, imports, current_file);
+                arg_window_drop(window);
+                vstack_push(st, out);
+                if (tail) pc = bc->count;
+                break;
+            }
+            /* Fused forms: `pc` points at the first shadowed original, which supplies error positions. */
+            case BC_ADD_LOCAL_IMM:
+            case BC_SUB_LOCAL_IMM: {
+                Value left = vm_load(env, in.sarg, in.line, in.col);
+                const BytecodeInstr *op = &bc->items[pc + 1];
+                if (left.type != VAL_INT) {
+                    runtime_error(op->line, op->col,
+                                  in.op == BC_ADD_LOCAL_IMM ? "'+' expects int+int or string+string"
+                                                            : "arithmetic expects integers");
+                }
+                vstack_push(st, value_int(in.op == BC_ADD_LOCAL_IMM ? left.as.int_val + in.iarg : left.as.int_val - in.iarg));
+                pc += 2;
+                break;
+            }
+            case BC_LT_LOCAL_IMM: {
+                Value left = vm_load(env, in.sarg, in.line, in.col);
+                if (left.type != VAL_INT) runtime_error(bc->items[pc + 1].line, bc->items[pc + 1].col, "comparison expects integers");
+                vstack_push(st, value_bool(left.as.int_val < in.iarg));
+                pc += 2;
+                break;
+            }
+            case BC_LT_LOCAL_LOCAL: {
+                Value left = vm_load(env, in.sarg, in.line, in.col);
+                Value right = vm_load(env, in.sarg2, bc->items[pc].line, bc->items[pc].col);
+                if (left.type != VAL_INT || right.type != VAL_INT) {
+                    runtime_error(bc->items[pc + 1].line, bc->items[pc + 1].col, "comparison expects integers");
+                }
+                vstack_push(st, value_bool(left.as.int_val < right.as.int_val));
+                pc += 2;
+                break;
+            }
+            case BC_LOAD_DOT: {
+                Value left = vm_load(env, in.sarg, in.line, in.col);
+                vstack_push(st, object_get_member_value(left, in.sarg2, bc->items[pc].line, bc->items[pc].col));
+                pc += 1;
+                break;
+            }
+            /* On a guard miss, step back and re-dispatch the same instruction in its generic form. */
+            case BC_ADD_II:
+            case BC_SUB_II:
+            case BC_MUL_II: {
+                long long left, right;
+                if (!vstack_pop_int_pair(st, &left, &right)) {
+                    bytecode_deopt(&bc->items[--pc]);
+                    break;
+                }
+                if (in.op == BC_ADD_II) {
+                    vstack_push(st, value_int(left + right));
+                } else if (in.op == BC_SUB_II) {
+                    vstack_push(st, value_int(left - right));
+                } else {
+                    vstack_push(st, value_int(left * right));
+                }
+                break;
+            }
+            case BC_LT_II:
+            case BC_GT_II:
+            case BC_LE_II:
+            case BC_GE_II: {
+                long long left, right;
+                if (!vstack_pop_int_pair(st, &left, &right)) {
+                    bytecode_deopt(&bc->items[--pc]);
+                    break;
+                }
+                int ok = 0;
+                if (in.op == BC_LT_II) ok = left < right;
+                if (in.op == BC_GT_II) ok = left > right;
+                if (in.op == BC_LE_II) ok = left <= right;
+                if (in.op == BC_GE_II) ok = left >= right;
+                vstack_push(st, value_bool(ok));
+                break;
+            }
+            case BC_STMT:
+                statement_prologue((Stmt *)(intptr_t)in.iarg, env, current_file);
+                break;
+            case BC_EXEC_STMT:
+                vm_frame_sync(pc, env);
+                (void)eval_statement((Stmt *)(intptr_t)in.iarg, env, imports, current_file, 0);
+                break;
+            case BC_EVAL_EXPR:
+                vm_frame_sync(pc, env);
+                vstack_push(st, eval_expr_vm((Expr *)(intptr_t)in.iarg, env, imports, current_file));
+                break;
+            case BC_POP:
+                if (st->count - st->base < in.iarg) runtime_error(in.line, in.col, "VM stack underflow");
+                st->count -= (int)in.iarg;
+                break;
+            case BC_DUP: {
+                Value top = vstack_pop(st, in.line, in.col);
+                vstack_push(st, top);
+                vstack_push(st, top);
+                break;
+            }
+            case BC_DEFINE:
+                env_define(env, in.sarg, vstack_pop(st, in.line, in.col));
+                break;
+            case BC_ASSIGN:
+                if (!env_assign(env, in.sarg, vstack_pop(st, in.line, in.col))) {
+                    runtime_error(in.line, in.col, "assignment to undefined variable");
+                }
+                break;
+            case BC_SET_MEMBER: {
+                Value v = vstack_pop(st, in.line, in.col);
+                Value obj = vstack_pop(st, in.line, in.col);
+                if (obj.type != VAL_OBJECT) runtime_error(in.line, in.col, "member assignment expects object");
+                object_set(obj.as.object_val, in.sarg, v);
+                break;
+            }
+            case BC_SET_INDEX: {
+                Value v = vstack_pop(st, in.line, in.col);
+                Value idx = vstack_pop(st, in.line, in.col);
+                Value left = vstack_pop(st, in.line, in.col);
+                set_index_value(left, idx, v, in.line, in.col);
+                break;
+            }
+            case BC_JUMP:
+                pc = (int)in.iarg;
+                break;
+            case BC_JUMP_IF_FALSE:
+                if (!is_truthy(vstack_pop(st, in.line, in.col))) pc = (int)in.iarg;
+                break;
+            case BC_SWITCH_TABLE: {
+                int k = switch_table_find((const SwitchTable *)in.aux, vstack_pop(st, in.line, in.col));
+                pc = (int)bc->items[pc + (k < 0 ? in.iarg : k)].iarg;
+                break;
+            }
+            case BC_ENV_PUSH:
+                env = env_new(env);
+                break;
+            case BC_ENV_POP:
+                for (long long i = 0; i < in.iarg; i++) {
+                    Env *parent = env->parent;
+                    if (release_envs) env_release(env);
+                    env = parent;
+                }
+                break;
+            case BC_ENV_RESET:
+                env_truncate(env, 0);
+                break;
+            case BC_RANGE_INIT: {
+                /* `for x in range(...)` counts without the array while the name holds the builtin. */
+                int argc = (int)in.iarg;
+                if (st->count - st->base < argc) runtime_error(in.line, in.col, "VM stack underflow");
+                Value *argv = &st->items[st->count - argc];
+                int intact = core_builtin_intact(CORE_RANGE);
+                if (intact && argv[0].type == VAL_INT && argv[argc - 1].type == VAL_INT) {
+                    long long start = argc == 2 ? argv[0].as.int_val : 0;
+                    long long stop = argv[argc - 1].as.int_val;
+                    st->count -= argc;
+                    vstack_push(st, value_int(stop));
+                    vstack_push(st, value_int(start));
+                    break;
+                }
+                Value callee = intact ? value_builtin(builtin_range) : vm_load(env, in.sarg, in.line, in.col);
+                Value *window = arg_window_take(argc);
+                memcpy(window + 1, argv, (size_t)argc * sizeof(Value));
+                st->count -= argc;
+                vm_frame_sync(pc, env);
+                Value iter = apply_function(callee, window + 1, argc, in.line, in.col, imports, current_file);
+                arg_window_drop(window);
+                if (iter.type != VAL_ARRAY && iter.type != VAL_OBJECT) {
+                    runtime_error(in.line, in.col, "for loop expects array or object iterable");
+                }
+                vstack_push(st, iter);
+                vstack_push(st, value_int(0));
+                break;
+            }
+            case BC_ITER_INIT: {
+                if (st->count <= st->base) runtime_error(in.line, in.col, "VM stack underflow");
+                Value iter = st->items[st->count - 1];
+                if (iter.type != VAL_ARRAY && iter.type != VAL_OBJECT) {
+                    runtime_error(in.line, in.col, "for loop expects array or object iterable");
+                }
+                vstack_push(st, value_int(0));
+                break;
+            }
+            case BC_ITER_NEXT:
+            case BC_ITER_BIND: {
+                /* Stack: [iterable, index] or, from RANGE_INIT, [stop, value]. Either exits the loop or enters
+                 * the body in a fresh Env, or for ITER_BIND in the loop's own Env emptied down to the loop variables. */
+                if (st->count - st->base < 2) runtime_error(in.line, in.col, "VM stack underflow");
+                Value iter = st->items[st->count - 2];
+                long long i = st->items[st->count - 1].as.int_val;
+                long long count = iter_bound(iter);
+                if (i >= count) {
+                    pc = (int)in.iarg;
+                    break;
+                }
+                st->items[st->count - 1] = value_int(i + 1);
+                if (in.op == BC_ITER_BIND) {
+                    env_truncate(env, in.sarg2 != NULL ? 2 : 1);
+                } else {
+                    env = env_new(env);
+                }
+                Value key = iter.type != VAL_OBJECT ? value_int(i) : value_string(iter.as.object_val->items[i].key);
+                if (in.sarg2 != NULL) {
+                    env_define(env, in.sarg, key);
+                    env_define(env, in.sarg2,
+                               iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : iter.as.object_val->items[i].value);
+                } else {
+                    env_define(env, in.sarg, iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : key);
+                }
+                break;
+            }
+            case BC_RETURN:
+                pc = bc->count;
+                break;
+            case BC_THROW: {
+                Value thrown = vstack_pop(st, in.line, in.col);
+                if (guard != NULL) {
+                    vm_frame_sync(pc, env);
+                    if (vm_unwind(entry, g_vm.frame_count - 1, thrown)) {
+                        fr = &g_vm.frames[g_vm.frame_count - 1];
+                        bc = fr->code;
+                        pc = fr->pc;
+                        env = fr->env;
+                        current_file = fr->file;
+                        release_envs = fr->release_envs;
+                        break;
+                    }
+                    g_exception_top = guard->prev;
+                }
+                throw_value(in.line, in.col, thrown);
+                break;
+            }
+            case BC_INLINE_ENTER: {
+                /* Guard: the callee must still have the inlined body, else the next JUMP takes the call. */
+                int argc = (int)in.iarg;
+                Value callee = st->items[st->count - argc - 1];
+                InlineSite *site = (InlineSite *)in.aux;
+                if (callee.type != VAL_FUNCTION || callee.as.fn_val->body != site->body) break;
+                Function *target = callee.as.fn_val;
+                Value *argv = &st->items[st->count - argc];
+                fr = &g_vm.frames[g_vm.frame_count - 1];
+                fr->inline_env = env;
+                fr->inline_file = current_file;
+                env = site->spare;
+                site->spare = NULL;
+                if (env != NULL) {
+                    /* The parameters are still its first bindings, in order; drop the body's lets. */
+                    env->count = argc;
+                    for (int i = 0; i < argc; i++) {
+                        env->items[i].value = argv[i];
+                    }
+                    env->parent = target->closure;
+                } else {
+                    env = env_new(target->closure);
+                    for (int i = 0; i < argc; i++) {
+                        env_define(env, target->params[i], argv[i]);
+                    }
+                }
+                st->count -= argc + 1;
+                current_file = fr->file = target->def_file;
+                pc++;
+                break;
+            }
+            case BC_INLINE_LEAVE: {
+                /* Inlined bodies cannot capture their Env, so the site keeps it for the next call.
+                 * A site re-entered through recursion in the caller gets a fresh Env instead. */
+                InlineSite *site = (InlineSite *)in.aux;
+                if (site->spare == NULL) {
+                    site->spare = env;
+                } else {
+                    env_release(env);
+                }
+                fr = &g_vm.frames[g_vm.frame_count - 1];
+                env = fr->inline_env;
+                current_file = fr->file = fr->inline_file;
+                fr->inline_env = NULL;
+                break;
+            }
+            case BC_OP_COUNT:
+                runtime_error(in.line, in.col, "invalid VM opcode");
+                break;
+        }
+    }
+}
+
+/*
+ * Entering a try costs nothing: the first time a run reaches frame code with handlers, it
+ * links one ExceptionFrame for the rest of the run. Throws in its own frames unwind without
+ * it (BC_THROW); it catches those from C code the run calls into, whose state is stale here,
+ * so the loop restarts from the frames vm_unwind left.
+ */
+static Value vm_run(ImportSet *imports) {
+    int entry = g_vm.frame_count;
+    Value out;
+    if (vm_run_frames(imports, entry, NULL, &out)) return out;
+
+    ExceptionFrame guard;
+    guard.prev = g_exception_top;
+    guard.vm_stack_count = g_vm.stack.count;
+    guard.vm_stack_base = g_vm.stack.base;
+    guard.vm_frame_count = g_vm.frame_count;
+    guard.call_depth = g_call_depth;
+    guard.arg_top = g_arg_top;
+    g_exception_top = &guard;
+    if (setjmp(guard.env) != 0) {
+        g_arg_top = guard.arg_top;
+        /* This run's frames are the ones below the first frame a nested run pushed. */
+        int top = entry - 1;
+        while (top + 1 < g_vm.frame_count && !g_vm.frames[top + 1].entry) top++;
+        if (!vm_unwind(entry, top, g_exception_value)) {
+            g_exception_top = guard.prev;
+            throw_value(g_exception_line, g_exception_col, g_exception_value);
+        }
+    }
+    vm_run_frames(imports, entry, &guard, &out);
+    g_exception_top = guard.prev;
+    return out;
+}
+
+static Value vm_exec(Bytecode *bc, Env *env, ImportSet *imports, const char *current_file) {
+    vm_frame_push(bc, env, current_file, 0);
+    g_vm.frames[g_vm.frame_count - 1].entry = 1;
+    return vm_run(imports);
+}
+
+/* Entered from apply_function with g_call_depth already raised; the frame pop lowers it. */
+static Value vm_call_compiled(Function *f, Env *call_env, ImportSet *imports) {
+    vm_frame_push(f->code, call_env, f->def_file, 1);
+    g_vm.frames[g_vm.frame_count - 1].entry = 1;
+    g_vm.frames[g_vm.frame_count - 1].release_envs = !block_may_capture(f->body);
+#if NYX_JIT
+    if (g_jit) jit_note_call(f->code, f);
+#endif
+    return vm_run(imports);
+}
+
+static Value eval_expr_vm(Expr *expr, Env *env, ImportSet *imports, const char *current_file) {
+    if (!expr_vm_supported(expr)) {
+        if (g_vm_strict) {
+            runtime_error(expr->line, expr->col, "expression is not supported in strict VM mode");
+        }
+        return eval_expr_ast(expr, env, imports, current_file);
+    }
+
+    Bytecode *bc = vm_bytecode_for_expr(expr);
+    return vm_exec(bc, env, imports, current_file);
+}
+
+static Value eval_expr(Expr *expr, Env *env, ImportSet *imports, const char *current_file) {
+    if (g_use_vm) return eval_expr_vm(expr, env, imports, current_file);
+    return eval_expr_ast(expr, env, imports, current_file);
+}
+
+static EvalResult eval_result(Value value, ControlKind control) {
+    EvalResult r;
+    r.value = value;
+    r.control = control;
+    return r;
+}
+
+typedef enum {
+    SBC_EXEC_STMT = 0
+} StmtBytecodeOp;
+
+typedef struct {
+    StmtBytecodeOp op;
+    Stmt *stmt;
+} StmtBytecodeInstr;
+
+typedef struct {
+    StmtBytecodeInstr *items;
+    int count;
+    int cap;
+} StmtBytecode;
+
+typedef struct {
+    Block *block;
+    StmtBytecode code;
+} StmtVmCacheEntry;
+
+static StmtVmCacheEntry **g_stmt_vm_cache = NULL;
+static int g_stmt_vm_cache_count = 0;
+static int g_stmt_vm_cache_cap = 0;
+
+static void stmt_bytecode_emit(StmtBytecode *bc, StmtBytecodeOp op, Stmt *stmt) {
+    if (bc->count == bc->cap) {
+        int next_cap = bc->cap == 0 ? 32 : bc->cap * 2;
+        bc->items = (StmtBytecodeInstr *)xrealloc(bc->items, (size_t)next_cap * sizeof(StmtBytecodeInstr));
+        bc->cap = next_cap;
+    }
+    bc->items[bc->count].op = op;
+    bc->items[bc->count].stmt = stmt;
+    bc->count++;
+}
+
+static void compile_stmt_bytecode(Block *block, StmtBytecode *bc) {
+    for (int i = 0; i < block->count; i++) {
+        stmt_bytecode_emit(bc, SBC_EXEC_STMT, block->items[i]);
+    }
+}
+
+static StmtBytecode *vm_bytecode_for_block(Block *block) {
+    for (int i = 0; i < g_stmt_vm_cache_count; i++) {
+        if (g_stmt_vm_cache[i]->block == block) {
+            return &g_stmt_vm_cache[i]->code;
+        }
+    }
+
+    if (g_stmt_vm_cache_count == g_stmt_vm_cache_cap) {
+        int next_cap = g_stmt_vm_cache_cap == 0 ? 64 : g_stmt_vm_cache_cap * 2;
+        g_stmt_vm_cache =
+            (StmtVmCacheEntry **)xrealloc(g_stmt_vm_cache, (size_t)next_cap * sizeof(StmtVmCacheEntry *));
+        g_stmt_vm_cache_cap = next_cap;
+    }
+
+    StmtVmCacheEntry *entry = (StmtVmCacheEntry *)xmalloc(sizeof(StmtVmCacheEntry));
+    g_stmt_vm_cache[g_stmt_vm_cache_count++] = entry;
+    entry->block = block;
+    entry->code.items = NULL;
+    entry->code.count = 0;
+    entry->code.cap = 0;
+    compile_stmt_bytecode(block, &entry->code);
+    return &entry->code;
+}
+
+static EvalResult vm_exec_block(StmtBytecode *bc, Env *env, ImportSet *imports, const char *current_file,
+                                int top_level) {
+    Value last = value_null();
+    for (int pc = 0; pc < bc->count; pc++) {
+        StmtBytecodeInstr in = bc->items[pc];
+        if (in.op != SBC_EXEC_STMT || in.stmt == NULL) {
+            runtime_error(0, 0, "invalid VM statement bytecode");
+        }
+        EvalResult r = eval_statement(in.stmt, env, imports, current_file, top_level);
+        if (r.control != CTRL_NONE) return r;
+        last = r.value;
+    }
+    return eval_result(last, CTRL_NONE);
+}
+
+static EvalResult vm_eval_block(Block *block, Env *env, ImportSet *imports, const char *current_file, int top_level) {
+    StmtBytecode *bc = vm_bytecode_for_block(block);
+    return vm_exec_block(bc, env, imports, current_file, top_level);
+}
+
+/*
+ * -O pipeline. Runs once per parsed program, before either engine sees the tree, and rewrites
+ * nodes in place: constant folding, `x * 2^k` strength reduction, dead-branch and
+ * unreachable-statement removal. Anything that would raise at runtime (type errors, division
+ * by zero) is left unfolded so the error still fires with its original position.
+ */
+static int opt_is_literal(Expr *e) {
+    return e->kind == EXPR_INT || e->kind == EXPR_STRING || e->kind == EXPR_BOOL || e->kind == EXPR_NULL;
+}
+
+static int opt_literal_truthy(Expr *e) {
+    switch (e->kind) {
+        case EXPR_INT: return e->as.int_val != 0;
+        case EXPR_STRING: return e->as.str_val[0] != '\0';
+        case EXPR_BOOL: return e->as.bool_val;
+        default: return 0;
+    }
+}
+
+static void opt_set_int(Expr *e, long long v) {
+    e->kind = EXPR_INT;
+    e->as.int_val = v;
+}
+
+static void opt_set_bool(Expr *e, int v) {
+    e->kind = EXPR_BOOL;
+    e->as.bool_val = v ? 1 : 0;
+}
+
+static int opt_power_of_two(long long v) {
+    if (v < 2 || (v & (v - 1)) != 0) return -1;
+    int k = 0;
+    while (v > 1) {
+        v >>= 1;
+        k++;
+    }
+    return k;
+}
+
+static void opt_expr(Expr *e);
+
+static void opt_fold_binary(Expr *e) {
+    Expr *l = expr_at(e->as.binary.left);
+    Expr *r = expr_at(e->as.binary.right);
+    TokenType op = e->as.binary.op;
+
+    if (op == TOK_ANDAND || op == TOK_OROR) {
+        if (!opt_is_literal(l)) return;
+        int lt = opt_literal_truthy(l);
+        if (op == TOK_ANDAND && !lt) {
+            opt_set_bool(e, 0);
+        } else if (op == TOK_OROR && lt) {
+            opt_set_bool(e, 1);
+        } else if (opt_is_literal(r)) {
+            opt_set_bool(e, opt_literal_truthy(r));
+        }
+        return;
+    }
+    if (op == TOK_COALESCE) {
+        if (!opt_is_literal(l)) return;
+        *e = l->kind == EXPR_NULL ? *r : *l;
+        return;
+    }
+
+    if (op == TOK_STAR) {
+        /* Both operands are evaluated either way; only the literal side may move. */
+        ExprId other = 0;
+        int k = -1;
+        if (r->kind == EXPR_INT && !opt_is_literal(l)) {
+            k = opt_power_of_two(r->as.int_val);
+            other = e->as.binary.left;
+        } else if (l->kind == EXPR_INT && !opt_is_literal(r)) {
+            k = opt_power_of_two(l->as.int_val);
+            other = e->as.binary.right;
+        }
+        if (k > 0) {
+            ExprId shift = e->as.binary.left == other ? e->as.binary.right : e->as.binary.left;
+            opt_set_int(expr_at(shift), k);
+            e->as.binary.left = other;
+            e->as.binary.right = shift;
+            e->as.binary.op = TOK_SHL;
+            return;
+        }
+    }
+
+    if (l->kind == EXPR_INT && r->kind == EXPR_INT) {
+        unsigned long long a = (unsigned long long)l->as.int_val;
+        unsigned long long b = (unsigned long long)r->as.int_val;
+        switch (op) {
+            case TOK_PLUS: opt_set_int(e, (long long)(a + b)); return;
+            case TOK_MINUS: opt_set_int(e, (long long)(a - b)); return;
+            case TOK_STAR: opt_set_int(e, (long long)(a * b)); return;
+            case TOK_SLASH:
+            case TOK_PERCENT:
+                if (r->as.int_val == 0 || (r->as.int_val == -1 && l->as.int_val == LLONG_MIN)) return;
+                opt_set_int(e, op == TOK_SLASH ? l->as.int_val / r->as.int_val : l->as.int_val % r->as.int_val);
+                return;
+            case TOK_LT: opt_set_bool(e, l->as.int_val < r->as.int_val); return;
+            case TOK_GT: opt_set_bool(e, l->as.int_val > r->as.int_val); return;
+            case TOK_LE: opt_set_bool(e, l->as.int_val <= r->as.int_val); return;
+            case TOK_GE: opt_set_bool(e, l->as.int_val >= r->as.int_val); return;
+            default: break;
+        }
+    }
+    if (op == TOK_PLUS && l->kind == EXPR_STRING && r->kind == EXPR_STRING) {
+        char *joined = str_concat(l->as.str_val, r->as.str_val);
+        e->kind = EXPR_STRING;
+        e->as.str_val = joined;
+        return;
+    }
+    if ((op == TOK_EQ || op == TOK_NEQ) && opt_is_literal(l) && opt_is_literal(r)) {
+        int eq = 0;
+        if (l->kind == r->kind) {
+            if (l->kind == EXPR_NULL) eq = 1;
+            if (l->kind == EXPR_INT) eq = l->as.int_val == r->as.int_val;
+            if (l->kind == EXPR_BOOL) eq = l->as.bool_val == r->as.bool_val;
+            if (l->kind == EXPR_STRING) eq = strcmp(l->as.str_val, r->as.str_val) == 0;
+        }
+        opt_set_bool(e, op == TOK_EQ ? eq : !eq);
+    }
+}
+
+static void opt_expr(Expr *e) {
+    switch (e->kind) {
+        case EXPR_INT:
+        case EXPR_STRING:
+        case EXPR_BOOL:
+        case EXPR_NULL:
+        case EXPR_IDENT:
+            return;
+        case EXPR_ARRAY:
+            for (int i = 0; i < e->as.array.count; i++) opt_expr(expr_at(e->as.array.items[i]));
+            return;
+        case EXPR_ARRAY_COMP:
+            opt_expr(expr_at(e->as.array_comp->value_expr));
+            opt_expr(expr_at(e->as.array_comp->iter_expr));
+            if (e->as.array_comp->filter_expr) opt_expr(expr_at(e->as.array_comp->filter_expr));
+            return;
+        case EXPR_OBJECT:
+            for (int i = 0; i < e->as.object.count; i++) opt_expr(expr_at(e->as.object.fields[i].value));
+            return;
+        case EXPR_INDEX:
+            opt_expr(expr_at(e->as.index.left));
+            opt_expr(expr_at(e->as.index.index));
+            return;
+        case EXPR_DOT:
+            opt_expr(expr_at(e->as.dot.left));
+            return;
+        case EXPR_UNARY: {
+            Expr *r = expr_at(e->as.unary.right);
+            opt_expr(r);
+            if (e->as.unary.op == TOK_MINUS && r->kind == EXPR_INT) {
+                opt_set_int(e, (long long)(0ULL - (unsigned long long)r->as.int_val));
+            } else if (e->as.unary.op == TOK_BANG && opt_is_literal(r)) {
+                opt_set_bool(e, !opt_literal_truthy(r));
+            }
+            return;
+        }
+        case EXPR_BINARY:
+            opt_expr(expr_at(e->as.binary.left));
+            opt_expr(expr_at(e->as.binary.right));
+            opt_fold_binary(e);
+            return;
+        case EXPR_CALL:
+            opt_expr(expr_at(e->as.call.callee));
+            for (int i = 0; i < e->as.call.argc; i++) opt_expr(expr_at(e->as.call.args[i]));
+            return;
+    }
+}
+
+static void opt_block(Block *b);
+
+/* Returns 0 when the statement can be dropped from its block. */
+static int opt_stmt(Stmt *s) {
+    switch (s->kind) {
+        case STMT_LET: opt_expr(expr_at(s->as.let_stmt.value)); return 1;
+        case STMT_ASSIGN: opt_expr(expr_at(s->as.assign_stmt.value)); return 1;
+        case STMT_SET_MEMBER:
+            opt_expr(expr_at(s->as.set_member_stmt.object));
+            opt_expr(expr_at(s->as.set_member_stmt.value));
+            return 1;
+        case STMT_SET_INDEX:
+            opt_expr(expr_at(s->as.set_index_stmt.object));
+            opt_expr(expr_at(s->as.set_index_stmt.index));
+            opt_expr(expr_at(s->as.set_index_stmt.value));
+            return 1;
+        case STMT_EXPR: opt_expr(expr_at(s->as.expr_stmt.expr)); return 1;
+        case STMT_IF:
+            opt_expr(expr_at(s->as.if_stmt.cond));
+            opt_block(s->as.if_stmt.then_block);
+            if (s->as.if_stmt.else_block) opt_block(s->as.if_stmt.else_block);
+            if (opt_is_literal(expr_at(s->as.if_stmt.cond))) {
+                /* Keep the if node (its branch still gets its own scope) but with only the live arm. */
+                if (opt_literal_truthy(expr_at(s->as.if_stmt.cond))) {
+                    s->as.if_stmt.else_block = NULL;
+                } else if (s->as.if_stmt.else_block) {
+                    s->as.if_stmt.then_block = s->as.if_stmt.else_block;
+                    s->as.if_stmt.else_block = NULL;
+                    opt_set_bool(expr_at(s->as.if_stmt.cond), 1);
+                } else {
+                    return 0;
+                }
+            }
+            return 1;
+        case STMT_SWITCH:
+            opt_expr(expr_at(s->as.switch_stmt->value));
+            for (int i = 0; i < s->as.switch_stmt->case_count; i++) {
+                opt_expr(expr_at(s->as.switch_stmt->case_values[i]));
+                opt_block(s->as.switch_stmt->case_blocks[i]);
+            }
+            if (s->as.switch_stmt->default_block) opt_block(s->as.switch_stmt->default_block);
+            return 1;
+        case STMT_WHILE:
+            opt_expr(expr_at(s->as.while_stmt.cond));
+            opt_block(s->as.while_stmt.body);
+            return !(opt_is_literal(expr_at(s->as.while_stmt.cond)) && !opt_literal_truthy(expr_at(s->as.while_stmt.cond)));
+        case STMT_FOR:
+            opt_expr(expr_at(s->as.for_stmt.iter_expr));
+            opt_block(s->as.for_stmt.body);
+            return 1;
+        case STMT_CLASS: opt_block(s->as.class_stmt.body); return 1;
+        case STMT_MODULE: opt_block(s->as.module_stmt.body); return 1;
+        case STMT_TYPE: opt_expr(expr_at(s->as.type_stmt.value)); return 1;
+        case STMT_TRY:
+            opt_block(s->as.try_stmt.try_block);
+            opt_block(s->as.try_stmt.catch_block);
+            return 1;
+        case STMT_FN: opt_block(s->as.fn_stmt.body); return 1;
+        case STMT_RETURN: opt_expr(expr_at(s->as.return_stmt.value)); return 1;
+        case STMT_THROW: opt_expr(expr_at(s->as.throw_stmt.value)); return 1;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+        case STMT_IMPORT:
+            return 1;
+    }
+    return 1;
+}
+
+static void opt_block(Block *b) {
+    int out = 0;
+    for (int i = 0; i < b->count; i++) {
+        Stmt *s = b->items[i];
+        if (!opt_stmt(s)) continue;
+        b->items[out++] = s;
+        if (s->kind == STMT_RETURN || s->kind == STMT_THROW || s->kind == STMT_BREAK || s->kind == STMT_CONTINUE) {
+            break;
+        }
+    }
+    b->count = out;
+}
+
+/*
+ * Precompiled AST cache (.nyc). With --cache-dir, each parsed source is stored as
+ * <dir>/<hash>.nyc, keyed by the FNV-1a hash of its text and NYX_LANG_VERSION; later runs map
+ * the file and rebuild the tree from it instead of lexing and parsing again.
+ *
+ * Layout: NycHeader, `node_words` int32 words holding the tree in preorder, then a pool of
+ * NUL-terminated strings. The file stays mapped and the rebuilt tree points into the pool.
+ * Anything that does not validate is ignored and the source is parsed as usual.
+ */
+#define NYC_MAGIC "NYXC"
+#define NYC_FORMAT 1
+#define NYC_ENDIAN_MARK 0x01020304u
+
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    uint32_t endian;
+    uint32_t node_words;
+    uint32_t pool_size;
+    uint32_t reserved;
+    uint64_t source_hash;
+    uint64_t source_len;
+    uint64_t payload_hash; /* over the words and the pool, so a damaged file is never run */
+    char lang_version[32];
+} NycHeader;
+
+/* Open-addressing pointer -> int map; a snapshot can hold far too many nodes for a linear scan. */
+typedef struct {
+    const void **keys;
+    int *vals;
+    int cap;
+    int count;
+} PtrMap;
+
+typedef struct {
+    int32_t *words;
+    uint32_t count;
+    uint32_t cap;
+    char *pool;
+    uint32_t pool_size;
+    uint32_t pool_cap;
+    PtrMap *blocks; /* when set, numbers every Block in the order it is written */
+} NycWriter;
+
+typedef struct {
+    const int32_t *words;
+    uint32_t count;
+    uint32_t pos;
+    const char *pool;
+    uint32_t pool_size;
+    int failed;
+    Block **blocks; /* when tracking, every Block read so far, numbered like NycWriter.blocks */
+    int block_count;
+    int block_cap;
+    int track_blocks;
+} NycReader;
+
+static size_t ptrmap_slot(const void *key, int cap) {
+    uint64_t h = (uint64_t)(uintptr_t)key * 11400714819323198485ULL;
+    return (size_t)(h >> 32) & (size_t)(cap - 1);
+}
+
+static int ptrmap_get(const PtrMap *map, const void *key) {
+    if (map->cap == 0) return -1;
+    for (size_t i = ptrmap_slot(key, map->cap);; i = (i + 1) & (size_t)(map->cap - 1)) {
+        if (map->keys[i] == key) return map->vals[i];
+        if (map->keys[i] == NULL) return -1;
+    }
+}
+
+static void ptrmap_put(PtrMap *map, const void *key, int val) {
+    if ((map->count + 1) * 2 > map->cap) {
+        PtrMap grown;
+        grown.cap = map->cap == 0 ? 64 : map->cap * 2;
+        grown.count = 0;
+        grown.keys = (const void **)xmalloc((size_t)grown.cap * sizeof(void *));
+        grown.vals = (int *)xmalloc((size_t)grown.cap * sizeof(int));
+        memset(grown.keys, 0, (size_t)grown.cap * sizeof(void *));
+        for (int i = 0; i < map->cap; i++) {
+            if (map->keys[i] != NULL) ptrmap_put(&grown, map->keys[i], map->vals[i]);
+        }
+        xfree(map->keys);
+        xfree(map->vals);
+        *map = grown;
+    }
+    size_t i = ptrmap_slot(key, map->cap);
+    while (map->keys[i] != NULL && map->keys[i] != key) i = (i + 1) & (size_t)(map->cap - 1);
+    if (map->keys[i] == NULL) map->count++;
+    map->keys[i] = key;
+    map->vals[i] = val;
+}
+
+static void ptrmap_free(PtrMap *map) {
+    xfree(map->keys);
+    xfree(map->vals);
+    memset(map, 0, sizeof(*map));
+}
+
+static uint64_t nyc_hash(const char *s, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t nyc_payload_hash(const int32_t *words, uint32_t count, const char *pool, uint32_t pool_size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (uint32_t i = 0; i < count; i++) {
+        h ^= (uint32_t)words[i];
+        h *= 1099511628211ULL;
+    }
+    return h ^ nyc_hash(pool, pool_size);
+}
+
+static char *nyc_cache_path(uint64_t hash) {
+    size_t n = strlen(g_cache_dir) + 32;
+    char *path = (char *)xmalloc(n);
+    snprintf(path, n, "%s/%016llx.nyc", g_cache_dir, (unsigned long long)hash);
+    return path;
+}
+
+static void nyc_put(NycWriter *w, int32_t v) {
+    if (w->count == w->cap) {
+        w->cap = w->cap == 0 ? 1024 : w->cap * 2;
+        w->words = (int32_t *)xrealloc(w->words, (size_t)w->cap * sizeof(int32_t));
+    }
+    w->words[w->count++] = v;
+}
+
+static void nyc_put_i64(NycWriter *w, long long v) {
+    uint64_t u = (uint64_t)v;
+    nyc_put(w, (int32_t)(uint32_t)(u & 0xffffffffu));
+    nyc_put(w, (int32_t)(uint32_t)(u >> 32));
+}
+
+static void nyc_put_str(NycWriter *w, const char *s) {
+    if (s == NULL) {
+        nyc_put(w, -1);
+        return;
+    }
+    uint32_t n = (uint32_t)strlen(s) + 1;
+    while (w->pool_size + n > w->pool_cap) {
+        w->pool_cap = w->pool_cap == 0 ? 4096 : w->pool_cap * 2;
+        w->pool = (char *)xrealloc(w->pool, w->pool_cap);
+    }
+    nyc_put(w, (int32_t)w->pool_size);
+    memcpy(w->pool + w->pool_size, s, n);
+    w->pool_size += n;
+}
+
+static void nyc_put_block(NycWriter *w, Block *b);
+
+static void nyc_put_expr(NycWriter *w, Expr *e) {
+    if (e == NULL) {
+        nyc_put(w, -1);
+        return;
+    }
+    nyc_put(w, (int32_t)e->kind);
+    nyc_put(w, e->line);
+    nyc_put(w, e->col);
+    switch (e->kind) {
+        case EXPR_INT: nyc_put_i64(w, e->as.int_val); break;
+        case EXPR_STRING: nyc_put_str(w, e->as.str_val); break;
+        case EXPR_BOOL: nyc_put(w, e->as.bool_val); break;
+        case EXPR_NULL: break;
+        case EXPR_IDENT: nyc_put_str(w, e->as.ident); break;
+        case EXPR_ARRAY:
+            nyc_put(w, e->as.array.count);
+            for (int i = 0; i < e->as.array.count; i++) nyc_put_expr(w, expr_at(e->as.array.items[i]));
+            break;
+        case EXPR_ARRAY_COMP:
+            nyc_put_expr(w, expr_at(e->as.array_comp->value_expr));
+            nyc_put_str(w, e->as.array_comp->iter_name);
+            nyc_put_str(w, e->as.array_comp->iter_value_name);
+            nyc_put_expr(w, expr_at(e->as.array_comp->iter_expr));
+            nyc_put_expr(w, expr_at(e->as.array_comp->filter_expr));
+            break;
+        case EXPR_OBJECT:
+            nyc_put(w, e->as.object.count);
+            for (int i = 0; i < e->as.object.count; i++) {
+                nyc_put_str(w, e->as.object.fields[i].key);
+                nyc_put_expr(w, expr_at(e->as.object.fields[i].value));
+            }
+            break;
+        case EXPR_INDEX:
+            nyc_put_expr(w, expr_at(e->as.index.left));
+            nyc_put_expr(w, expr_at(e->as.index.index));
+            break;
+        case EXPR_DOT:
+            nyc_put_expr(w, expr_at(e->as.dot.left));
+            nyc_put_str(w, e->as.dot.member);
+            break;
+        case EXPR_UNARY:
+            nyc_put(w, (int32_t)e->as.unary.op);
+            nyc_put_expr(w, expr_at(e->as.unary.right));
+            break;
+        case EXPR_BINARY:
+            nyc_put_expr(w, expr_at(e->as.binary.left));
+            nyc_put(w, (int32_t)e->as.binary.op);
+            nyc_put_expr(w, expr_at(e->as.binary.right));
+            break;
+        case EXPR_CALL:
+            nyc_put_expr(w, expr_at(e->as.call.callee));
+            nyc_put(w, e->as.call.argc);
+            for (int i = 0; i < e->as.call.argc; i++) nyc_put_expr(w, expr_at(e->as.call.args[i]));
+            break;
+    }
+}
+
+static void nyc_put_stmt(NycWriter *w, Stmt *s) {
+    nyc_put(w, (int32_t)s->kind);
+    nyc_put(w, s->line);
+    nyc_put(w, s->col);
+    switch (s->kind) {
+        case STMT_LET:
+            nyc_put_str(w, s->as.let_stmt.name);
+            nyc_put_expr(w, expr_at(s->as.let_stmt.value));
+            break;
+        case STMT_ASSIGN:
+            nyc_put_str(w, s->as.assign_stmt.name);
+            nyc_put_expr(w, expr_at(s->as.assign_stmt.value));
+            break;
+        case STMT_SET_MEMBER:
+            nyc_put_expr(w, expr_at(s->as.set_member_stmt.object));
+            nyc_put_str(w, s->as.set_member_stmt.member);
+            nyc_put_expr(w, expr_at(s->as.set_member_stmt.value));
+            break;
+        case STMT_SET_INDEX:
+            nyc_put_expr(w, expr_at(s->as.set_index_stmt.object));
+            nyc_put_expr(w, expr_at(s->as.set_index_stmt.index));
+            nyc_put_expr(w, expr_at(s->as.set_index_stmt.value));
+            break;
+        case STMT_EXPR: nyc_put_expr(w, expr_at(s->as.expr_stmt.expr)); break;
+        case STMT_IF:
+            nyc_put_expr(w, expr_at(s->as.if_stmt.cond));
+            nyc_put_block(w, s->as.if_stmt.then_block);
+            nyc_put_block(w, s->as.if_stmt.else_block);
+            break;
+        case STMT_SWITCH:
+            nyc_put_expr(w, expr_at(s->as.switch_stmt->value));
+            nyc_put(w, s->as.switch_stmt->case_count);
+            for (int i = 0; i < s->as.switch_stmt->case_count; i++) {
+                nyc_put_expr(w, expr_at(s->as.switch_stmt->case_values[i]));
+                nyc_put_block(w, s->as.switch_stmt->case_blocks[i]);
+            }
+            nyc_put_block(w, s->as.switch_stmt->default_block);
+            break;
+        case STMT_WHILE:
+            nyc_put_expr(w, expr_at(s->as.while_stmt.cond));
+            nyc_put_block(w, s->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            nyc_put_str(w, s->as.for_stmt.iter_name);
+            nyc_put_str(w, s->as.for_stmt.iter_value_name);
+            nyc_put_expr(w, expr_at(s->as.for_stmt.iter_expr));
+            nyc_put_block(w, s->as.for_stmt.body);
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+        case STMT_CLASS:
+            nyc_put_str(w, s->as.class_stmt.name);
+            nyc_put_block(w, s->as.class_stmt.body);
+            break;
+        case STMT_MODULE:
+            nyc_put_str(w, s->as.module_stmt.name);
+            nyc_put_block(w, s->as.module_stmt.body);
+            break;
+        case STMT_TYPE:
+            nyc_put_str(w, s->as.type_stmt.name);
+            nyc_put_expr(w, expr_at(s->as.type_stmt.value));
+            break;
+        case STMT_TRY:
+            nyc_put_block(w, s->as.try_stmt.try_block);
+            nyc_put_str(w, s->as.try_stmt.catch_name);
+            nyc_put_block(w, s->as.try_stmt.catch_block);
+            break;
+        case STMT_FN:
+            nyc_put_str(w, s->as.fn_stmt.name);
+            nyc_put(w, s->as.fn_stmt.param_count);
+            for (int i = 0; i < s->as.fn_stmt.param_count; i++) nyc_put_str(w, s->as.fn_stmt.params[i]);
+            nyc_put_block(w, s->as.fn_stmt.body);
+            break;
+        case STMT_RETURN:
+            nyc_put_expr(w, expr_at(s->as.return_stmt.value));
+            nyc_put(w, s->as.return_stmt.tail_call);
+            break;
+        case STMT_THROW: nyc_put_expr(w, expr_at(s->as.throw_stmt.value)); break;
+        case STMT_IMPORT: nyc_put_str(w, s->as.import_stmt.path); break;
+    }
+}
+
+static void nyc_put_block(NycWriter *w, Block *b) {
+    if (b == NULL) {
+        nyc_put(w, -1);
+        return;
+    }
+    if (w->blocks != NULL) ptrmap_put(w->blocks, b, w->blocks->count);
+    nyc_put(w, b->count);
+    for (int i = 0; i < b->count; i++) nyc_put_stmt(w, b->items[i]);
+}
+
+/* Wraps a writer's words and pool in a header; consumes the writer, the caller frees the image. */
+static char *nyc_image(NycWriter *w, const char *magic, uint64_t hash, size_t len, size_t *out_size) {
+    NycHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, magic, 4);
+    h.format = NYC_FORMAT;
+    h.endian = NYC_ENDIAN_MARK;
+    h.node_words = w->count;
+    h.pool_size = w->pool_size;
+    h.source_hash = hash;
+    h.source_len = (uint64_t)len;
+    h.payload_hash = nyc_payload_hash(w->words, w->count, w->pool, w->pool_size);
+    snprintf(h.lang_version, sizeof(h.lang_version), "%s", NYX_LANG_VERSION);
+
+    size_t words_size = (size_t)w->count * sizeof(int32_t);
+    *out_size = sizeof(h) + words_size + w->pool_size;
+    char *image = (char *)xmalloc(*out_size);
+    memcpy(image, &h, sizeof(h));
+    if (words_size > 0) memcpy(image + sizeof(h), w->words, words_size);
+    if (w->pool_size > 0) memcpy(image + sizeof(h) + words_size, w->pool, w->pool_size);
+    xfree(w->words);
+    xfree(w->pool);
+    return image;
+}
+
+/* Serializes a tree into one .nyc image; the caller frees it. */
+static char *nyc_encode(Block *program, uint64_t hash, size_t len, size_t *out_size) {
+    NycWriter w;
+    memset(&w, 0, sizeof(w));
+    nyc_put_block(&w, program);
+    return nyc_image(&w, NYC_MAGIC, hash, len, out_size);
+}
+
+/* Writes an image through a temporary name and a rename, so readers never see a partial file. */
+static int nyc_write_file(const char *path, const char *image, size_t size) {
+    size_t n = strlen(path) + 32;
+    char *tmp = (char *)xmalloc(n);
+#if defined(_WIN32)
+    snprintf(tmp, n, "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+#else
+    /* A unique name per writer: -j threads may store modules whose text hashes to the same image. */
+    snprintf(tmp, n, "%s.XXXXXX", path);
+    FILE *f = NULL;
+    int fd = mkstemp(tmp);
+    if (fd >= 0) {
+        (void)fchmod(fd, 0644);
+        f = fdopen(fd, "wb");
+        if (f == NULL) {
+            close(fd);
+            remove(tmp);
+        }
+    }
+#endif
+    int ok = 0;
+    if (f != NULL) {
+        ok = fwrite(image, 1, size, f) == size;
+        if (fclose(f) != 0) ok = 0;
+        if (ok && rename(tmp, path) != 0) ok = 0;
+        if (!ok) remove(tmp);
+    }
+    xfree(tmp);
+    return ok;
+}
+
+/* Best effort: a cache that cannot be written is just a slower next run. */
+static void nyc_store(const char *path, Block *program, uint64_t hash, size_t len) {
+    size_t size = 0;
+    char *image = nyc_encode(program, hash, len, &size);
+    (void)nyc_write_file(path, image, size);
+    xfree(image);
+}
+
+static int32_t nyc_get(NycReader *r) {
+    if (r->pos >= r->count) {
+        r->failed = 1;
+        return -1;
+    }
+    return r->words[r->pos++];
+}
+
+/* A count can never exceed the words left, which bounds every allocation by the file size. */
+static int nyc_get_count(NycReader *r) {
+    int32_t n = nyc_get(r);
+    if (n < 0 || (uint32_t)n > r->count - r->pos) {
+        r->failed = 1;
+        return 0;
+    }
+    return n;
+}
+
+static char *nyc_get_str(NycReader *r, int nullable) {
+    int32_t off = nyc_get(r);
+    if (off == -1 && nullable) return NULL;
+    if (off < 0 || (uint32_t)off >= r->pool_size) {
+        r->failed = 1;
+        return (char *)"";
+    }
+    return (char *)r->pool + off;
+}
+
+static Block *nyc_get_block(NycReader *r, int nullable);
+
+static ExprId nyc_get_expr(NycReader *r, int nullable) {
+    int32_t kind = nyc_get(r);
+    if (kind == -1 && nullable && !r->failed) return 0;
+    int line = nyc_get(r);
+    int col = nyc_get(r);
+    if (kind < EXPR_INT || kind > EXPR_CALL) {
+        r->failed = 1;
+        kind = EXPR_NULL;
+    }
+    ExprId id = new_expr((ExprKind)kind, line, col);
+    Expr *e = expr_at(id);
+    if (r->failed) {
+        e->kind = EXPR_NULL;
+        return id;
+    }
+    switch (e->kind) {
+        case EXPR_INT: {
+            uint64_t lo = (uint32_t)nyc_get(r);
+            uint64_t hi = (uint32_t)nyc_get(r);
+            e->as.int_val = (long long)(lo | (hi << 32));
+            break;
+        }
+        case EXPR_STRING: e->as.str_val = nyc_get_str(r, 0); break;
+        case EXPR_BOOL: e->as.bool_val = nyc_get(r) != 0; break;
+        case EXPR_NULL: break;
+        case EXPR_IDENT: e->as.ident = nyc_get_str(r, 0); break;
+        case EXPR_ARRAY: {
+            int n = nyc_get_count(r);
+            e->as.array.count = n;
+            e->as.array.items = n > 0 ? (ExprId *)ast_alloc((size_t)n * sizeof(ExprId)) : NULL;
+            for (int i = 0; i < n; i++) e->as.array.items[i] = nyc_get_expr(r, 0);
+            break;
+        }
+        case EXPR_ARRAY_COMP:
+            e->as.array_comp = (struct ArrayComp *)ast_alloc(sizeof(struct ArrayComp));
+            e->as.array_comp->value_expr = nyc_get_expr(r, 0);
+            e->as.array_comp->iter_name = nyc_get_str(r, 0);
+            e->as.array_comp->iter_value_name = nyc_get_str(r, 1);
+            e->as.array_comp->iter_expr = nyc_get_expr(r, 0);
+            e->as.array_comp->filter_expr = nyc_get_expr(r, 1);
+            break;
+        case EXPR_OBJECT: {
+            int n = nyc_get_count(r);
+            e->as.object.count = n;
+            e->as.object.fields = n > 0 ? (ObjectField *)ast_alloc((size_t)n * sizeof(ObjectField)) : NULL;
+            for (int i = 0; i < n; i++) {
+                e->as.object.fields[i].key = nyc_get_str(r, 0);
+                e->as.object.fields[i].value = nyc_get_expr(r, 0);
+            }
+            break;
+        }
+        case EXPR_INDEX:
+            e->as.index.left = nyc_get_expr(r, 0);
+            e->as.index.index = nyc_get_expr(r, 0);
+            break;
+        case EXPR_DOT:
+            e->as.dot.left = nyc_get_expr(r, 0);
+            e->as.dot.member = nyc_get_str(r, 0);
+            break;
+        case EXPR_UNARY:
+            e->as.unary.op = (TokenType)nyc_get(r);
+            e->as.unary.right = nyc_get_expr(r, 0);
+            break;
+        case EXPR_BINARY:
+            e->as.binary.left = nyc_get_expr(r, 0);
+            e->as.binary.op = (TokenType)nyc_get(r);
+            e->as.binary.right = nyc_get_expr(r, 0);
+            break;
+        case EXPR_CALL: {
+            e->as.call.callee = nyc_get_expr(r, 0);
+            int n = nyc_get_count(r);
+            e->as.call.argc = n;
+            e->as.call.args = n > 0 ? (ExprId *)ast_alloc((size_t)n * sizeof(ExprId)) : NULL;
+            for (int i = 0; i < n; i++) e->as.call.args[i] = nyc_get_expr(r, 0);
+            e->core = r->failed ? CORE_NONE : core_builtin_call(e);
+            break;
+        }
+    }
+    return id;
+}
+
+static Stmt *nyc_get_stmt(NycReader *r) {
+    int32_t kind = nyc_get(r);
+    int line = nyc_get(r);
+    int col = nyc_get(r);
+    if (kind < STMT_LET || kind > STMT_IMPORT) {
+        r->failed = 1;
+        kind = STMT_BREAK;
+    }
+    Stmt *s = new_stmt((StmtKind)kind, line, col);
+    if (r->failed) {
+        s->kind = STMT_BREAK;
+        return s;
+    }
+    switch (s->kind) {
+        case STMT_LET:
+            s->as.let_stmt.name = nyc_get_str(r, 0);
+            s->as.let_stmt.value = nyc_get_expr(r, 0);
+            break;
+        case STMT_ASSIGN:
+            s->as.assign_stmt.name = nyc_get_str(r, 0);
+            s->as.assign_stmt.value = nyc_get_expr(r, 0);
+            break;
+        case STMT_SET_MEMBER:
+            s->as.set_member_stmt.object = nyc_get_expr(r, 0);
+            s->as.set_member_stmt.member = nyc_get_str(r, 0);
+            s->as.set_member_stmt.value = nyc_get_expr(r, 0);
+            break;
+        case STMT_SET_INDEX:
+            s->as.set_index_stmt.object = nyc_get_expr(r, 0);
+            s->as.set_index_stmt.index = nyc_get_expr(r, 0);
+            s->as.set_index_stmt.value = nyc_get_expr(r, 0);
+            break;
+        case STMT_EXPR: s->as.expr_stmt.expr = nyc_get_expr(r, 0); break;
+        case STMT_IF:
+            s->as.if_stmt.cond = nyc_get_expr(r, 0);
+            s->as.if_stmt.then_block = nyc_get_block(r, 0);
+            s->as.if_stmt.else_block = nyc_get_block(r, 1);
+            break;
+        case STMT_SWITCH: {
+            s->as.switch_stmt = (struct SwitchStmt *)ast_alloc(sizeof(struct SwitchStmt));
+            s->as.switch_stmt->value = nyc_get_expr(r, 0);
+            int n = nyc_get_count(r);
+            s->as.switch_stmt->case_count = n;
+            s->as.switch_stmt->case_values = n > 0 ? (ExprId *)ast_alloc((size_t)n * sizeof(ExprId)) : NULL;
+            s->as.switch_stmt->case_blocks = n > 0 ? (Block **)ast_alloc((size_t)n * sizeof(Block *)) : NULL;
+            for (int i = 0; i < n; i++) {
+                s->as.switch_stmt->case_values[i] = nyc_get_expr(r, 0);
+                s->as.switch_stmt->case_blocks[i] = nyc_get_block(r, 0);
+            }
+            s->as.switch_stmt->default_block = nyc_get_block(r, 1);
+            s->as.switch_stmt->table = NULL;
+            s->as.switch_stmt->table_checked = 0;
+            break;
+        }
+        case STMT_WHILE:
+            s->as.while_stmt.cond = nyc_get_expr(r, 0);
+            s->as.while_stmt.body = nyc_get_block(r, 0);
+            break;
+        case STMT_FOR:
+            s->as.for_stmt.iter_name = nyc_get_str(r, 0);
+            s->as.for_stmt.iter_value_name = nyc_get_str(r, 1);
+            s->as.for_stmt.iter_expr = nyc_get_expr(r, 0);
+            s->as.for_stmt.body = nyc_get_block(r, 0);
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+        case STMT_CLASS:
+            s->as.class_stmt.name = nyc_get_str(r, 0);
+            s->as.class_stmt.body = nyc_get_block(r, 0);
+            break;
+        case STMT_MODULE:
+            s->as.module_stmt.name = nyc_get_str(r, 0);
+            s->as.module_stmt.body = nyc_get_block(r, 0);
+            break;
+        case STMT_TYPE:
+            s->as.type_stmt.name = nyc_get_str(r, 0);
+            s->as.type_stmt.value = nyc_get_expr(r, 0);
+            break;
+        case STMT_TRY:
+            s->as.try_stmt.try_block = nyc_get_block(r, 0);
+            s->as.try_stmt.catch_name = nyc_get_str(r, 0);
+            s->as.try_stmt.catch_block = nyc_get_block(r, 0);
+            break;
+        case STMT_FN: {
+            s->as.fn_stmt.name = nyc_get_str(r, 0);
+            int n = nyc_get_count(r);
+            s->as.fn_stmt.param_count = n;
+            s->as.fn_stmt.params = n > 0 ? (char **)ast_alloc((size_t)n * sizeof(char *)) : NULL;
+            for (int i = 0; i < n; i++) s->as.fn_stmt.params[i] = nyc_get_str(r, 0);
+            s->as.fn_stmt.body = nyc_get_block(r, 0);
+            break;
+        }
+        case STMT_RETURN:
+            s->as.return_stmt.value = nyc_get_expr(r, 0);
+            s->as.return_stmt.tail_call = nyc_get(r) != 0 && expr_at(s->as.return_stmt.value)->kind == EXPR_CALL;
+            break;
+        case STMT_THROW: s->as.throw_stmt.value = nyc_get_expr(r, 0); break;
+        case STMT_IMPORT: s->as.import_stmt.path = nyc_get_str(r, 0); break;
+    }
+    return s;
+}
+
+static Block *nyc_get_block(NycReader *r, int nullable) {
+    int32_t n = nyc_get(r);
+    if (n == -1 && nullable && !r->failed) return NULL;
+    Block *b = new_block();
+    if (n < 0 || (uint32_t)n > r->count - r->pos) {
+        r->failed = 1;
+        return b;
+    }
+    if (r->track_blocks) {
+        if (r->block_count == r->block_cap) {
+            r->block_cap = r->block_cap == 0 ? 64 : r->block_cap * 2;
+            r->blocks = (Block **)xrealloc(r->blocks, (size_t)r->block_cap * sizeof(Block *));
+        }
+        r->blocks[r->block_count++] = b;
+    }
+    b->items = n > 0 ? (Stmt **)ast_alloc((size_t)n * sizeof(Stmt *)) : NULL;
+    b->cap = n;
+    for (int i = 0; i < n && !r->failed; i++) b->items[b->count++] = nyc_get_stmt(r);
+    return b;
+}
+
+/* Validates an image's header and checksum and points a reader at its words and pool. */
+static int nyc_open(const char *data, size_t size, const char *magic, uint64_t hash, size_t len, NycReader *r) {
+    const NycHeader *h = (const NycHeader *)data;
+    if (size < sizeof(NycHeader) || memcmp(h->magic, magic, 4) != 0 || h->format != NYC_FORMAT ||
+        h->endian != NYC_ENDIAN_MARK || h->source_hash != hash || h->source_len != (uint64_t)len ||
+        strncmp(h->lang_version, NYX_LANG_VERSION, sizeof(h->lang_version)) != 0 ||
+        size != sizeof(NycHeader) + (size_t)h->node_words * sizeof(int32_t) + h->pool_size ||
+        (h->pool_size > 0 && data[size - 1] != '\0')) {
+        return 0;
+    }
+    memset(r, 0, sizeof(*r));
+    r->words = (const int32_t *)(data + sizeof(NycHeader));
+    r->count = h->node_words;
+    r->pool = data + sizeof(NycHeader) + (size_t)h->node_words * sizeof(int32_t);
+    r->pool_size = h->pool_size;
+    return nyc_payload_hash(r->words, r->count, r->pool, r->pool_size) == h->payload_hash;
+}
+
+/* Rebuilds the tree of an image; NULL on any mismatch, and a rejected tree is simply dropped. */
+static Block *nyc_decode(const char *data, size_t size, uint64_t hash, size_t len) {
+    NycReader r;
+    if (!nyc_open(data, size, NYC_MAGIC, hash, len, &r)) return NULL;
+    Block *program = nyc_get_block(&r, 0);
+    if (r.failed || r.pos != r.count) return NULL;
+    return program;
+}
+
+/* Maps a whole file read-only (read into memory on Windows); NULL if it cannot be opened. */
+static const char *nyc_map_file(const char *path, size_t *size) {
+#if defined(_WIN32)
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fclose(f);
+    if (sz < 0) return NULL;
+    *size = (size_t)sz;
+    return read_file(path);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(NycHeader)) {
+        close(fd);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    void *map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return map == MAP_FAILED ? NULL : (const char *)map;
+#endif
+}
+
+static void nyc_unmap_file(const char *data, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    xfree((void *)data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+static Block *nyc_load(const char *path, uint64_t hash, size_t len) {
+    size_t size = 0;
+    const char *data = nyc_map_file(path, &size);
+    if (data == NULL) return NULL;
+    Block *program = nyc_decode(data, size, hash, len);
+    if (program == NULL) nyc_unmap_file(data, size);
+    return program;
+}
+
+/*
+ * Builtin modules precompiled at build time: `make` runs a first-stage binary with
+ * --emit-builtin-snapshot and compiles the generated header into the final one, so their
+ * images live in read-only data shared by every process. Without the header, or if an image
+ * no longer matches its embedded source, the module is parsed as before.
+ */
+typedef struct {
+    const char *name;
+    const uint64_t *image; /* 64-bit words keep the NycHeader fields aligned */
+    size_t size;
+} BuiltinSnapshot;
+
+#ifdef NYX_BUILTIN_SNAPSHOT
+#include NYX_BUILTIN_SNAPSHOT
+#else
+static const BuiltinSnapshot k_builtin_snapshots[] = {{NULL, NULL, 0}};
+#endif
+
+static const char *const k_builtin_module_names[] = {"nymath", "nyarrays", "nyobjects", "nyjson", "nyhttp"};
+
+static Block *builtin_snapshot_program(const char *path, const char *source) {
+    for (size_t i = 0; i < sizeof(k_builtin_snapshots) / sizeof(k_builtin_snapshots[0]); i++) {
+        const BuiltinSnapshot *snap = &k_builtin_snapshots[i];
+        if (snap->name == NULL || strcmp(snap->name, path) != 0) continue;
+        size_t len = strlen(source);
+        return nyc_decode((const char *)snap->image, snap->size, nyc_hash(source, len), len);
+    }
+    return NULL;
+}
+
+static int emit_builtin_snapshot(const char *out_path) {
+    FILE *f = fopen(out_path, "w");
+    if (f == NULL) return 0;
+    size_t count = sizeof(k_builtin_module_names) / sizeof(k_builtin_module_names[0]);
+    size_t sizes[sizeof(k_builtin_module_names) / sizeof(k_builtin_module_names[0])];
+    fprintf(f, "/* Generated by `nyx --emit-builtin-snapshot` (NYX_LANG_VERSION %s); do not edit. */\n", NYX_LANG_VERSION);
+    for (size_t i = 0; i < count; i++) {
+        const char *source = builtin_module_source(k_builtin_module_names[i]);
+        Parser p;
+        parser_init(&p, source);
+        Block *program = parse_program(&p);
+        xfree(p.lx.escaped);
+        size_t len = strlen(source);
+        size_t size = 0;
+        char *image = nyc_encode(program, nyc_hash(source, len), len, &size);
+        sizes[i] = size;
+        fprintf(f, "\nstatic const uint64_t k_builtin_image_%s[] = {", k_builtin_module_names[i]);
+        for (size_t off = 0; off < size; off += 8) {
+            uint64_t word = 0;
+            memcpy(&word, image + off, size - off < 8 ? size - off : 8);
+            fprintf(f, "%s0x%016llxULL,", off % 32 == 0 ? "\n    " : " ", (unsigned long long)word);
+        }
+        fprintf(f, "\n};\n");
+        xfree(image);
+    }
+    fprintf(f, "\nstatic const BuiltinSnapshot k_builtin_snapshots[] = {\n");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(f, "    {\"%s\", k_builtin_image_%s, %lu},\n", k_builtin_module_names[i], k_builtin_module_names[i],
+                (unsigned long)sizes[i]);
+    }
+    fprintf(f, "};\n");
+    return fclose(f) == 0;
+}
+
+/*
+ * Heap snapshots (.nys). --snapshot-out writes, after the script has run, every program tree
+ * it parsed, its import set and the heap reachable from the global Env. --snapshot-in maps
+ * such an image and rebuilds that state instead of running the prelude again. The image uses
+ * the .nyc framing: trees first, then a node kind table, then one record per heap node.
+ */
+#define NYS_MAGIC "NYXS"
+
+typedef enum {
+    SNAP_ENV,
+    SNAP_ARRAY,
+    SNAP_OBJECT,
+    SNAP_FUNCTION,
+    SNAP_BOUND_METHOD
+} SnapNodeKind;
+
+static const char *g_snapshot_out = NULL; /* --snapshot-out path */
+static Block **g_snapshot_roots = NULL;
+static int g_snapshot_root_count = 0;
+
+static void snapshot_add_root(Block *program) {
+    g_snapshot_roots = (Block **)xrealloc(g_snapshot_roots, (size_t)(g_snapshot_root_count + 1) * sizeof(Block *));
+    g_snapshot_roots[g_snapshot_root_count++] = program;
+}
+
+typedef struct {
+    NycWriter w;
+    PtrMap blocks;
+    PtrMap ids;
+    const void **nodes;
+    SnapNodeKind *kinds;
+    int count;
+    int cap;
+    Env *builtins; /* names for builtin function pointers */
+    const char *error;
+} SnapWriter;
+
+static void snap_note(SnapWriter *sw, const void *ptr, SnapNodeKind kind) {
+    if (ptrmap_get(&sw->ids, ptr) >= 0) return;
+    if (sw->count == sw->cap) {
+        sw->cap = sw->cap == 0 ? 256 : sw->cap * 2;
+        sw->nodes = (const void **)xrealloc(sw->nodes, (size_t)sw->cap * sizeof(void *));
+        sw->kinds = (SnapNodeKind *)xrealloc(sw->kinds, (size_t)sw->cap * sizeof(SnapNodeKind));
+    }
+    ptrmap_put(&sw->ids, ptr, sw->count);
+    sw->nodes[sw->count] = ptr;
+    sw->kinds[sw->count] = kind;
+    sw->count++;
+}
+
+static void snap_note_value(SnapWriter *sw, Value v) {
+    switch (v.type) {
+        case VAL_ARRAY: snap_note(sw, v.as.array_val, SNAP_ARRAY); break;
+        case VAL_OBJECT: snap_note(sw, v.as.object_val, SNAP_OBJECT); break;
+        case VAL_FUNCTION: snap_note(sw, v.as.fn_val, SNAP_FUNCTION); break;
+        case VAL_BOUND_METHOD: snap_note(sw, v.as.bound_method_val, SNAP_BOUND_METHOD); break;
+        default: break;
+    }
+}
+
+static void snap_put_value(SnapWriter *sw, Value v) {
+    NycWriter *w = &sw->w;
+    nyc_put(w, (int32_t)v.type);
+    switch (v.type) {
+        case VAL_NULL: break;
+        case VAL_INT: nyc_put_i64(w, v.as.int_val); break;
+        case VAL_BOOL: nyc_put(w, v.as.bool_val); break;
+        case VAL_STRING: nyc_put_str(w, v.as.str_val); break;
+        case VAL_ARRAY: nyc_put(w, ptrmap_get(&sw->ids, v.as.array_val)); break;
+        case VAL_OBJECT: nyc_put(w, ptrmap_get(&sw->ids, v.as.object_val)); break;
+        case VAL_FUNCTION: nyc_put(w, ptrmap_get(&sw->ids, v.as.fn_val)); break;
+        case VAL_BOUND_METHOD: nyc_put(w, ptrmap_get(&sw->ids, v.as.bound_method_val)); break;
+        case VAL_BUILTIN: {
+            const char *name = NULL;
+            for (int i = 0; i < sw->builtins->count && name == NULL; i++) {
+                if (sw->builtins->items[i].value.as.builtin_val == v.as.builtin_val) name = sw->builtins->items[i].name;
+            }
+            if (name == NULL) sw->error = "snapshot cannot name a builtin function";
+            nyc_put_str(w, name != NULL ? name : "");
+            break;
+        }
+    }
+}
+
+static int snapshot_write(const char *path, Env *global, ImportSet *imports) {
+    SnapWriter sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.w.blocks = &sw.blocks;
+    sw.builtins = env_new(NULL);
+    install_builtins(sw.builtins);
+    NycWriter *w = &sw.w;
+
+    nyc_put(w, g_snapshot_root_count);
+    for (int i = 0; i < g_snapshot_root_count; i++) nyc_put_block(w, g_snapshot_roots[i]);
+    nyc_put(w, imports->count);
+    for (int i = 0; i < imports->count; i++) nyc_put_str(w, imports->items[i]);
+
+    /* Number every reachable node first; records can then refer to any node, cycles included. */
+    snap_note(&sw, global, SNAP_ENV);
+    for (int i = 0; i < sw.count; i++) {
+        const void *node = sw.nodes[i];
+        switch (sw.kinds[i]) {
+            case SNAP_ENV: {
+                const Env *env = (const Env *)node;
+                if (env->parent != NULL) snap_note(&sw, env->parent, SNAP_ENV);
+                for (int k = 0; k < env->count; k++) snap_note_value(&sw, env->items[k].value);
+                break;
+            }
+            case SNAP_ARRAY: {
+                const Array *arr = (const Array *)node;
+                for (int k = 0; k < arr->count; k++) snap_note_value(&sw, arr->items[k]);
+                break;
+            }
+            case SNAP_OBJECT: {
+                const Object *obj = (const Object *)node;
+                for (int k = 0; k < obj->count; k++) snap_note_value(&sw, obj->items[k].value);
+                break;
+            }
+            case SNAP_FUNCTION:
+                snap_note(&sw, ((const Function *)node)->closure, SNAP_ENV);
+                break;
+            case SNAP_BOUND_METHOD:
+                snap_note_value(&sw, ((const BoundMethod *)node)->self);
+                snap_note_value(&sw, ((const BoundMethod *)node)->fn);
+                break;
+        }
+    }
+
+    nyc_put(w, sw.count);
+    for (int i = 0; i < sw.count; i++) nyc_put(w, (int32_t)sw.kinds[i]);
+    for (int i = 0; i < sw.count; i++) {
+        const void *node = sw.nodes[i];
+        switch (sw.kinds[i]) {
+            case SNAP_ENV: {
+                const Env *env = (const Env *)node;
+                nyc_put(w, env->parent != NULL ? ptrmap_get(&sw.ids, env->parent) : -1);
+                nyc_put(w, env->count);
+                for (int k = 0; k < env->count; k++) {
+                    nyc_put_str(w, env->items[k].name);
+                    snap_put_value(&sw, env->items[k].value);
+                }
+                break;
+            }
+            case SNAP_ARRAY: {
+                const Array *arr = (const Array *)node;
+                nyc_put(w, arr->count);
+                for (int k = 0; k < arr->count; k++) snap_put_value(&sw, arr->items[k]);
+                break;
+            }
+            case SNAP_OBJECT: {
+                const Object *obj = (const Object *)node;
+                nyc_put(w, (int32_t)obj->kind);
+                nyc_put(w, obj->count);
+                for (int k = 0; k < obj->count; k++) {
+                    nyc_put_str(w, obj->items[k].key);
+                    snap_put_value(&sw, obj->items[k].value);
+                }
+                break;
+            }
+            case SNAP_FUNCTION: {
+                const Function *fn = (const Function *)node;
+                int body = ptrmap_get(&sw.blocks, fn->body);
+                if (body < 0) sw.error = "snapshot function body is not part of a recorded program";
+                nyc_put(w, body);
+                nyc_put(w, fn->param_count);
+                for (int k = 0; k < fn->param_count; k++) nyc_put_str(w, fn->params[k]);
+                nyc_put(w, ptrmap_get(&sw.ids, fn->closure));
+                nyc_put_str(w, fn->def_file);
+                break;
+            }
+            case SNAP_BOUND_METHOD:
+                snap_put_value(&sw, ((const BoundMethod *)node)->self);
+                snap_put_value(&sw, ((const BoundMethod *)node)->fn);
+                break;
+        }
+    }
+
+    size_t size = 0;
+    char *image = nyc_image(w, NYS_MAGIC, 0, 0, &size);
+    int ok = sw.error == NULL && nyc_write_file(path, image, size);
+    if (sw.error != NULL) fprintf(stderr, "Error: %s\n", sw.error);
+    xfree(image);
+    xfree(sw.nodes);
+    xfree(sw.kinds);
+    ptrmap_free(&sw.ids);
+    ptrmap_free(&sw.blocks);
+    return ok;
+}
+
+typedef struct {
+    NycReader r;
+    void **nodes;
+    int32_t *kinds;
+    int count;
+    Env *builtins;
+} SnapReader;
+
+static void *snap_get_node(SnapReader *sr, SnapNodeKind kind) {
+    int32_t id = nyc_get(&sr->r);
+    if (id < 0 || id >= sr->count || sr->kinds[id] != (int32_t)kind) {
+        sr->r.failed = 1;
+        return NULL;
+    }
+    return sr->nodes[id];
+}
+
+static Value snap_get_value(SnapReader *sr) {
+    NycReader *r = &sr->r;
+    int32_t type = nyc_get(r);
+    Value v = value_null();
+    switch (type) {
+        case VAL_NULL: break;
+        case VAL_INT: {
+            uint64_t lo = (uint32_t)nyc_get(r);
+            uint64_t hi = (uint32_t)nyc_get(r);
+            v = value_int((long long)(lo | (hi << 32)));
+            break;
+        }
+        case VAL_BOOL: v = value_bool(nyc_get(r) != 0); break;
+        case VAL_STRING:
+            v.type = VAL_STRING;
+            v.as.str_val = nyc_get_str(r, 0);
+            break;
+        case VAL_ARRAY:
+            v.type = VAL_ARRAY;
+            v.as.array_val = (Array *)snap_get_node(sr, SNAP_ARRAY);
+            break;
+        case VAL_OBJECT:
+            v.type = VAL_OBJECT;
+            v.as.object_val = (Object *)snap_get_node(sr, SNAP_OBJECT);
+            break;
+        case VAL_FUNCTION:
+            v.type = VAL_FUNCTION;
+            v.as.fn_val = (Function *)snap_get_node(sr, SNAP_FUNCTION);
+            break;
+        case VAL_BOUND_METHOD:
+            v.type = VAL_BOUND_METHOD;
+            v.as.bound_method_val = (BoundMethod *)snap_get_node(sr, SNAP_BOUND_METHOD);
+            break;
+        case VAL_BUILTIN: {
+            const char *name = nyc_get_str(r, 0);
+            for (int i = 0; i < sr->builtins->count; i++) {
+                if (strcmp(sr->builtins->items[i].name, name) == 0) return sr->builtins->items[i].value;
+            }
+            r->failed = 1;
+            break;
+        }
+        default:
+            r->failed = 1;
+            break;
+    }
+    if (r->failed) return value_null();
+    return v;
+}
+
+/* Returns the restored global Env, or NULL if the image is missing, foreign or damaged. */
+static Env *snapshot_load(const char *path, ImportSet *imports) {
+    size_t size = 0;
+    const char *data = nyc_map_file(path, &size);
+    if (data == NULL) return NULL;
+    SnapReader sr;
+    memset(&sr, 0, sizeof(sr));
+    if (!nyc_open(data, size, NYS_MAGIC, 0, 0, &sr.r)) {
+        nyc_unmap_file(data, size);
+        return NULL;
+    }
+    NycReader *r = &sr.r;
+    r->track_blocks = 1;
+
+    int roots = nyc_get_count(r);
+    for (int i = 0; i < roots && !r->failed; i++) {
+        Block *program = nyc_get_block(r, 0);
+        if (g_snapshot_out != NULL) snapshot_add_root(program);
+    }
+    int import_count = nyc_get_count(r);
+    for (int i = 0; i < import_count && !r->failed; i++) import_set_add(imports, nyc_get_str(r, 0));
+
+    /* Allocate every node, then fill them in; values may point at any node. */
+    sr.count = nyc_get_count(r);
+    sr.nodes = (void **)xmalloc((size_t)(sr.count > 0 ? sr.count : 1) * sizeof(void *));
+    sr.kinds = (int32_t *)xmalloc((size_t)(sr.count > 0 ? sr.count : 1) * sizeof(int32_t));
+    for (int i = 0; i < sr.count; i++) {
+        sr.kinds[i] = nyc_get(r);
+        switch (sr.kinds[i]) {
+            case SNAP_ENV: sr.nodes[i] = env_new(NULL); break;
+            case SNAP_ARRAY: sr.nodes[i] = value_array(NULL, 0).as.array_val; break;
+            case SNAP_OBJECT: sr.nodes[i] = object_new(); break;
+            case SNAP_FUNCTION: sr.nodes[i] = xmalloc(sizeof(Function)); break;
+            case SNAP_BOUND_METHOD: sr.nodes[i] = value_bound_method(value_null(), value_null()).as.bound_method_val; break;
+            default:
+                r->failed = 1;
+                sr.nodes[i] = NULL;
+                break;
+        }
+    }
+    sr.builtins = env_new(NULL);
+    install_builtins(sr.builtins);
+    for (int i = 0; i < sr.count && !r->failed; i++) {
+        switch (sr.kinds[i]) {
+            case SNAP_ENV: {
+                Env *env = (Env *)sr.nodes[i];
+                int parent = nyc_get(r);
+                if (parent >= 0) {
+                    if (parent >= sr.count || sr.kinds[parent] != SNAP_ENV) r->failed = 1;
+                    else env->parent = (Env *)sr.nodes[parent];
+                }
+                int n = nyc_get_count(r);
+                env->items = n > 0 ? (Binding *)xmalloc((size_t)n * sizeof(Binding)) : NULL;
+                env->cap = n;
+                for (int k = 0; k < n && !r->failed; k++) {
+                    env->items[k].name = nyc_get_str(r, 0);
+                    env->items[k].value = snap_get_value(&sr);
+                    env->count++;
+                    /* The global Env carries the builtins themselves; only a different value rebinds. */
+                    int core = env->items[k].name != NULL ? core_builtin_named(env->items[k].name) : CORE_NONE;
+                    if (core != CORE_NONE && (env->items[k].value.type != VAL_BUILTIN ||
+                                              env->items[k].value.as.builtin_val != k_core_builtin_fns[core])) {
+                        g_core_rebound |= 1u << core;
+                    }
+                }
+                break;
+            }
+            case SNAP_ARRAY: {
+                Array *arr = (Array *)sr.nodes[i];
+                int n = nyc_get_count(r);
+                arr->items = n > 0 ? (Value *)xmalloc((size_t)n * sizeof(Value)) : NULL;
+                for (int k = 0; k < n && !r->failed; k++) {
+                    arr->items[k] = snap_get_value(&sr);
+                    arr->count++;
+                }
                 break;
             }
-            case BC_CALL: {
-                int argc = (int)in.iarg;
-                if (argc < 0 || st.count < argc + 1) runtime_error(in.line, in.col, "invalid call frame");
-                Value *args = NULL;
-                if (argc > 0) args = (Value *)xmalloc((size_t)argc * sizeof(Value));
-                for (int i = argc - 1; i >= 0; i--) {
-                    args[i] = vstack_pop(&st, in.line, in.col);
+            case SNAP_OBJECT: {
+                Object *obj = (Object *)sr.nodes[i];
+                int32_t kind = nyc_get(r);
+                if (kind < OBJ_PLAIN || kind > OBJ_INSTANCE) r->failed = 1;
+                obj->kind = (ObjectKind)kind;
+                int n = nyc_get_count(r);
+                obj->items = n > 0 ? (ObjectEntry *)xmalloc((size_t)n * sizeof(ObjectEntry)) : NULL;
+                obj->cap = n;
+                for (int k = 0; k < n && !r->failed; k++) {
+                    obj->items[k].key = nyc_get_str(r, 0);
+                    obj->items[k].value = snap_get_value(&sr);
+                    obj->count++;
                 }
-                Value callee = vstack_pop(&st, in.line, in.col);
-                Value out = apply_function(callee, args, argc, in.line, in.col, imports, current_file);
-                xfree(args);
-                vstack_push(&st, out);
+                break;
+            }
+            case SNAP_FUNCTION: {
+                Function *fn = (Function *)sr.nodes[i];
+                int32_t body = nyc_get(r);
+                if (body < 0 || body >= r->block_count) r->failed = 1;
+                fn->body = r->failed ? NULL : r->blocks[body];
+                int n = nyc_get_count(r);
+                fn->param_count = n;
+                fn->params = n > 0 ? (char **)xmalloc((size_t)n * sizeof(char *)) : NULL;
+                for (int k = 0; k < n; k++) fn->params[k] = nyc_get_str(r, 0);
+                fn->closure = (Env *)snap_get_node(&sr, SNAP_ENV);
+                fn->def_file = nyc_get_str(r, 0);
+                fn->code = NULL;
+                fn->code_resolved = 0;
+                break;
+            }
+            case SNAP_BOUND_METHOD: {
+                BoundMethod *bm = (BoundMethod *)sr.nodes[i];
+                bm->self = snap_get_value(&sr);
+                bm->fn = snap_get_value(&sr);
                 break;
             }
         }
     }
-
-    if (st.count == 0) return value_null();
-    return st.items[st.count - 1];
-}
-
-static Value eval_expr_vm(Expr *expr, Env *env, ImportSet *imports, const char *current_file) {
-    if (!expr_vm_supported(expr)) {
-        if (g_vm_strict) {
-            runtime_error(expr->line, expr->col, "expression is not supported in strict VM mode");
-        }
-        return eval_expr_ast(expr, env, imports, current_file);
+    Env *global = sr.count > 0 && sr.kinds[0] == SNAP_ENV ? (Env *)sr.nodes[0] : NULL;
+    if (r->failed || r->pos != r->count || global == NULL || global->parent != NULL) global = NULL;
+    xfree(sr.nodes);
+    xfree(sr.kinds);
+    xfree(r->blocks);
+    return global;
+}
+
+/* The tree for a module's text: its builtin image, its --cache-dir image, or a fresh parse. */
+static Block *program_load(const char *source, const char *current_file) {
+    Block *program = NULL;
+    char *cache_path = NULL;
+    uint64_t hash = 0;
+    size_t len = 0;
+    if (is_builtin_module_path(current_file)) program = builtin_snapshot_program(current_file, source);
+    if (program == NULL && g_cache_dir != NULL) {
+        len = strlen(source);
+        hash = nyc_hash(source, len);
+        cache_path = nyc_cache_path(hash);
+        program = nyc_load(cache_path, hash, len);
+    }
+    if (program == NULL) {
+        Parser p;
+        parser_init(&p, source);
+        program = parse_program(&p);
+        xfree(p.lx.escaped);
+        if (cache_path != NULL) nyc_store(cache_path, program, hash, len);
     }
-
-    Bytecode *bc = vm_bytecode_for_expr(expr);
-    return vm_exec(bc, env, imports, current_file);
-}
-
-static Value eval_expr(Expr *expr, Env *env, ImportSet *imports, const char *current_file) {
-    if (g_use_vm) return eval_expr_vm(expr, env, imports, current_file);
-    return eval_expr_ast(expr, env, imports, current_file);
-}
-
-static EvalResult eval_result(Value value, ControlKind control) {
-    EvalResult r;
-    r.value = value;
-    r.control = control;
-    return r;
+    xfree(cache_path);
+    return program;
 }
 
-typedef enum {
-    SBC_EXEC_STMT = 0
-} StmtBytecodeOp;
-
+/*
+ * -j N: before the script runs, N threads read and parse the files it imports, following the
+ * import statements of every module they parse.
+ * Evaluation still imports modules one at a time in program order; an import takes the tree
+ * parsed here only if the file still holds the text that was parsed. A file that could not be
+ * read or parsed is left to the import itself, which then reports the error exactly as without -j.
+ */
 typedef struct {
-    StmtBytecodeOp op;
-    Stmt *stmt;
-} StmtBytecodeInstr;
+    char *path;
+    char *source;
+    Block *program;
+} PrefetchEntry;
 
 typedef struct {
-    StmtBytecodeInstr *items;
+    PrefetchEntry *items;
     int count;
     int cap;
-} StmtBytecode;
+    int next; /* first entry no worker has claimed yet */
+    int busy; /* workers reading or parsing an entry right now */
+    long long ast_bytes;
+    long long ast_nodes;
+    long long ast_lines;
+} ImportPrefetch;
 
-typedef struct {
-    Block *block;
-    StmtBytecode code;
-} StmtVmCacheEntry;
+static ImportPrefetch g_prefetch = {0};
 
-static StmtVmCacheEntry *g_stmt_vm_cache = NULL;
-static int g_stmt_vm_cache_count = 0;
-static int g_stmt_vm_cache_cap = 0;
+#if NYX_THREADS
+static int g_parse_jobs = 1;
+static pthread_mutex_t g_prefetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_prefetch_cond = PTHREAD_COND_INITIALIZER;
 
-static void stmt_bytecode_emit(StmtBytecode *bc, StmtBytecodeOp op, Stmt *stmt) {
-    if (bc->count == bc->cap) {
-        int next_cap = bc->cap == 0 ? 32 : bc->cap * 2;
-        bc->items = (StmtBytecodeInstr *)xrealloc(bc->items, (size_t)next_cap * sizeof(StmtBytecodeInstr));
-        bc->cap = next_cap;
+static void prefetch_add(const char *path, char *source) {
+    for (int i = 0; i < g_prefetch.count; i++) {
+        if (strcmp(g_prefetch.items[i].path, path) == 0) return;
     }
-    bc->items[bc->count].op = op;
-    bc->items[bc->count].stmt = stmt;
-    bc->count++;
-}
-
-static void compile_stmt_bytecode(Block *block, StmtBytecode *bc) {
-    for (int i = 0; i < block->count; i++) {
-        stmt_bytecode_emit(bc, SBC_EXEC_STMT, block->items[i]);
+    if (g_prefetch.count == g_prefetch.cap) {
+        g_prefetch.cap = g_prefetch.cap == 0 ? 64 : g_prefetch.cap * 2;
+        g_prefetch.items = (PrefetchEntry *)xrealloc(g_prefetch.items, (size_t)g_prefetch.cap * sizeof(PrefetchEntry));
     }
+    PrefetchEntry *e = &g_prefetch.items[g_prefetch.count++];
+    e->path = xstrdup(path);
+    e->source = source;
+    e->program = NULL;
 }
 
-static StmtBytecode *vm_bytecode_for_block(Block *block) {
-    for (int i = 0; i < g_stmt_vm_cache_count; i++) {
-        if (g_stmt_vm_cache[i].block == block) {
-            return &g_stmt_vm_cache[i].code;
+static void prefetch_scan_block(Block *block, const char *current_file, ImportSet *found);
+
+static void prefetch_scan_stmt(Stmt *s, const char *current_file, ImportSet *found) {
+    switch (s->kind) {
+        case STMT_IMPORT: {
+            if (is_builtin_module_path(s->as.import_stmt.path)) return;
+            char *path = resolve_path(current_file, s->as.import_stmt.path);
+            if (!import_set_contains(found, path)) import_set_add(found, path);
+            xfree(path);
+            return;
         }
+        case STMT_IF:
+            prefetch_scan_block(s->as.if_stmt.then_block, current_file, found);
+            if (s->as.if_stmt.else_block != NULL) prefetch_scan_block(s->as.if_stmt.else_block, current_file, found);
+            return;
+        case STMT_SWITCH:
+            for (int i = 0; i < s->as.switch_stmt->case_count; i++) {
+                prefetch_scan_block(s->as.switch_stmt->case_blocks[i], current_file, found);
+            }
+            if (s->as.switch_stmt->default_block != NULL) {
+                prefetch_scan_block(s->as.switch_stmt->default_block, current_file, found);
+            }
+            return;
+        case STMT_WHILE: prefetch_scan_block(s->as.while_stmt.body, current_file, found); return;
+        case STMT_FOR: prefetch_scan_block(s->as.for_stmt.body, current_file, found); return;
+        case STMT_CLASS: prefetch_scan_block(s->as.class_stmt.body, current_file, found); return;
+        case STMT_MODULE: prefetch_scan_block(s->as.module_stmt.body, current_file, found); return;
+        case STMT_FN: prefetch_scan_block(s->as.fn_stmt.body, current_file, found); return;
+        case STMT_TRY:
+            prefetch_scan_block(s->as.try_stmt.try_block, current_file, found);
+            prefetch_scan_block(s->as.try_stmt.catch_block, current_file, found);
+            return;
+        default: return;
     }
+}
 
-    if (g_stmt_vm_cache_count == g_stmt_vm_cache_cap) {
-        int next_cap = g_stmt_vm_cache_cap == 0 ? 64 : g_stmt_vm_cache_cap * 2;
-        g_stmt_vm_cache =
-            (StmtVmCacheEntry *)xrealloc(g_stmt_vm_cache, (size_t)next_cap * sizeof(StmtVmCacheEntry));
-        g_stmt_vm_cache_cap = next_cap;
-    }
+static void prefetch_scan_block(Block *block, const char *current_file, ImportSet *found) {
+    for (int i = 0; i < block->count; i++) prefetch_scan_stmt(block->items[i], current_file, found);
+}
 
-    StmtVmCacheEntry *entry = &g_stmt_vm_cache[g_stmt_vm_cache_count++];
-    entry->block = block;
-    entry->code.items = NULL;
-    entry->code.count = 0;
-    entry->code.cap = 0;
-    compile_stmt_bytecode(block, &entry->code);
-    return &entry->code;
+/* program_load on a worker thread; NULL when the text does not parse. */
+static Block *prefetch_parse(const char *source, const char *current_file) {
+    jmp_buf recover;
+    if (setjmp(recover) != 0) {
+        g_die_recover = NULL;
+        return NULL;
+    }
+    g_die_recover = &recover;
+    Block *program = program_load(source, current_file);
+    g_die_recover = NULL;
+    return program;
 }
 
-static EvalResult vm_exec_block(StmtBytecode *bc, Env *env, ImportSet *imports, const char *current_file,
-                                int top_level) {
-    Value last = value_null();
-    for (int pc = 0; pc < bc->count; pc++) {
-        StmtBytecodeInstr in = bc->items[pc];
-        if (in.op != SBC_EXEC_STMT || in.stmt == NULL) {
-            runtime_error(0, 0, "invalid VM statement bytecode");
+static void prefetch_run(void) {
+    pthread_mutex_lock(&g_prefetch_mutex);
+    while (1) {
+        while (g_prefetch.next == g_prefetch.count && g_prefetch.busy > 0) {
+            pthread_cond_wait(&g_prefetch_cond, &g_prefetch_mutex);
         }
-        EvalResult r = eval_statement(in.stmt, env, imports, current_file, top_level);
-        if (r.control != CTRL_NONE) return r;
-        last = r.value;
-    }
-    return eval_result(last, CTRL_NONE);
+        if (g_prefetch.next == g_prefetch.count) break;
+        int index = g_prefetch.next++;
+        char *path = g_prefetch.items[index].path;
+        char *source = g_prefetch.items[index].source;
+        g_prefetch.busy++;
+        pthread_mutex_unlock(&g_prefetch_mutex);
+
+        if (source == NULL) source = read_file(path);
+        Block *program = source != NULL ? prefetch_parse(source, path) : NULL;
+        ImportSet found = {NULL, 0, 0};
+        if (program != NULL) prefetch_scan_block(program, path, &found);
+
+        pthread_mutex_lock(&g_prefetch_mutex);
+        g_prefetch.items[index].source = source;
+        g_prefetch.items[index].program = program;
+        for (int i = 0; i < found.count; i++) {
+            prefetch_add(found.items[i], NULL);
+            xfree(found.items[i]);
+        }
+        xfree(found.items);
+        g_prefetch.busy--;
+        pthread_cond_broadcast(&g_prefetch_cond);
+    }
+    pthread_cond_broadcast(&g_prefetch_cond);
+    pthread_mutex_unlock(&g_prefetch_mutex);
+}
+
+static void *prefetch_thread(void *arg) {
+    (void)arg;
+    prefetch_run();
+    pthread_mutex_lock(&g_prefetch_mutex);
+    g_prefetch.ast_bytes += g_ast_bytes;
+    g_prefetch.ast_nodes += g_ast_nodes;
+    g_prefetch.ast_lines += g_ast_lines;
+    pthread_mutex_unlock(&g_prefetch_mutex);
+    return NULL;
 }
 
-static EvalResult vm_eval_block(Block *block, Env *env, ImportSet *imports, const char *current_file, int top_level) {
-    StmtBytecode *bc = vm_bytecode_for_block(block);
-    return vm_exec_block(bc, env, imports, current_file, top_level);
+/* Parses the import graph of the script on g_parse_jobs threads, the calling one included. */
+static void import_prefetch(const char *script_path, const char *source) {
+    int extra = g_parse_jobs - 1;
+    pthread_t *threads = (pthread_t *)xmalloc((size_t)extra * sizeof(pthread_t));
+    prefetch_add(script_path, xstrdup(source));
+    g_alloc_shared = 1;
+    int started = 0;
+    while (started < extra && pthread_create(&threads[started], NULL, prefetch_thread, NULL) == 0) started++;
+    prefetch_run();
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    g_alloc_shared = 0;
+    xfree(threads);
+    g_ast_bytes += g_prefetch.ast_bytes;
+    g_ast_nodes += g_prefetch.ast_nodes;
+    g_ast_lines += g_prefetch.ast_lines;
+}
+#endif
+
+/* The prefetched tree of `path`, if the text it was parsed from is still `source`. */
+static Block *import_prefetch_take(const char *path, const char *source) {
+    for (int i = 0; i < g_prefetch.count; i++) {
+        PrefetchEntry *e = &g_prefetch.items[i];
+        if (e->program == NULL || strcmp(e->path, path) != 0) continue;
+        Block *program = strcmp(e->source, source) == 0 ? e->program : NULL;
+        e->program = NULL;
+        xfree(e->source);
+        e->source = NULL;
+        return program;
+    }
+    return NULL;
 }
 
 static EvalResult eval_program_source(const char *source, Env *env, ImportSet *imports, const char *current_file,
                                       int top_level) {
-    Parser p;
-    parser_init(&p, source);
-    Block *program = parse_program(&p);
+    Block *program = import_prefetch_take(current_file, source);
+    if (program == NULL) program = program_load(source, current_file);
+    if (g_snapshot_out != NULL) snapshot_add_root(program);
+    if (g_optimize) opt_block(program);
     if (g_use_vm) return vm_eval_block(program, env, imports, current_file, top_level);
     return eval_block(program, env, imports, current_file, top_level);
 }
@@ -3834,147 +8518,196 @@ static void debug_before_statement(Stmt *stmt, Env *env, const char *current_fil
     }
 }
 
-static EvalResult eval_statement(Stmt *stmt, Env *env, ImportSet *imports, const char *current_file, int top_level) {
+static void statement_prologue(Stmt *stmt, Env *env, const char *current_file) {
     debug_before_statement(stmt, env, current_file);
 
     if (g_trace) {
         fprintf(stderr, "[trace] %s at %d:%d\n", stmt_kind_name(stmt->kind), stmt->line, stmt->col);
     }
     step_guard(stmt->line, stmt->col);
+    g_stmt_count++;
+}
+
+static void set_index_value(Value left, Value idx, Value v, int line, int col) {
+    if (left.type == VAL_ARRAY) {
+        if (idx.type != VAL_INT) runtime_error(line, col, "array index assignment expects int");
+        if (idx.as.int_val < 0 || idx.as.int_val >= left.as.array_val->count) {
+            runtime_error(line, col, "array assignment index out of range");
+        }
+        left.as.array_val->items[idx.as.int_val] = v;
+        return;
+    }
+    if (left.type == VAL_OBJECT) {
+        if (idx.type != VAL_STRING) {
+            runtime_error(line, col, "object index assignment expects string key");
+        }
+        object_set(left.as.object_val, idx.as.str_val, v);
+        return;
+    }
+    runtime_error(line, col, "index assignment expects array or object");
+}
+
+static EvalResult eval_statement(Stmt *stmt, Env *env, ImportSet *imports, const char *current_file, int top_level) {
+    statement_prologue(stmt, env, current_file);
 
     switch (stmt->kind) {
         case STMT_LET: {
-            Value v = eval_expr(stmt->as.let_stmt.value, env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.let_stmt.value), env, imports, current_file);
             env_define(env, stmt->as.let_stmt.name, v);
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_ASSIGN: {
-            Value v = eval_expr(stmt->as.assign_stmt.value, env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.assign_stmt.value), env, imports, current_file);
             if (!env_assign(env, stmt->as.assign_stmt.name, v)) {
                 runtime_error(stmt->line, stmt->col, "assignment to undefined variable");
             }
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_SET_MEMBER: {
-            Value obj = eval_expr(stmt->as.set_member_stmt.object, env, imports, current_file);
-            Value v = eval_expr(stmt->as.set_member_stmt.value, env, imports, current_file);
+            Value obj = eval_expr(expr_at(stmt->as.set_member_stmt.object), env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.set_member_stmt.value), env, imports, current_file);
             if (obj.type != VAL_OBJECT) runtime_error(stmt->line, stmt->col, "member assignment expects object");
             object_set(obj.as.object_val, stmt->as.set_member_stmt.member, v);
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_SET_INDEX: {
-            Value left = eval_expr(stmt->as.set_index_stmt.object, env, imports, current_file);
-            Value idx = eval_expr(stmt->as.set_index_stmt.index, env, imports, current_file);
-            Value v = eval_expr(stmt->as.set_index_stmt.value, env, imports, current_file);
-            if (left.type == VAL_ARRAY) {
-                if (idx.type != VAL_INT) runtime_error(stmt->line, stmt->col, "array index assignment expects int");
-                if (idx.as.int_val < 0 || idx.as.int_val >= left.as.array_val->count) {
-                    runtime_error(stmt->line, stmt->col, "array assignment index out of range");
-                }
-                left.as.array_val->items[idx.as.int_val] = v;
-                return eval_result(value_null(), CTRL_NONE);
-            }
-            if (left.type == VAL_OBJECT) {
-                if (idx.type != VAL_STRING) {
-                    runtime_error(stmt->line, stmt->col, "object index assignment expects string key");
-                }
-                object_set(left.as.object_val, idx.as.str_val, v);
-                return eval_result(value_null(), CTRL_NONE);
-            }
-            runtime_error(stmt->line, stmt->col, "index assignment expects array or object");
+            Value left = eval_expr(expr_at(stmt->as.set_index_stmt.object), env, imports, current_file);
+            Value idx = eval_expr(expr_at(stmt->as.set_index_stmt.index), env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.set_index_stmt.value), env, imports, current_file);
+            set_index_value(left, idx, v, stmt->line, stmt->col);
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_EXPR: {
-            Value v = eval_expr(stmt->as.expr_stmt.expr, env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.expr_stmt.expr), env, imports, current_file);
             if (top_level && v.type != VAL_NULL) value_println(v);
             return eval_result(v, CTRL_NONE);
         }
         case STMT_IF: {
-            Value cond = eval_expr(stmt->as.if_stmt.cond, env, imports, current_file);
+            Value cond = eval_expr(expr_at(stmt->as.if_stmt.cond), env, imports, current_file);
             if (is_truthy(cond)) {
                 Env *branch_env = env_new(env);
                 EvalResult r = g_use_vm ? vm_eval_block(stmt->as.if_stmt.then_block, branch_env, imports, current_file, 0)
                                         : eval_block(stmt->as.if_stmt.then_block, branch_env, imports, current_file, 0);
+                if (!block_may_capture(stmt->as.if_stmt.then_block)) env_release(branch_env);
                 if (r.control != CTRL_NONE) return r;
             } else if (stmt->as.if_stmt.else_block != NULL) {
                 Env *branch_env = env_new(env);
                 EvalResult r = g_use_vm ? vm_eval_block(stmt->as.if_stmt.else_block, branch_env, imports, current_file, 0)
                                         : eval_block(stmt->as.if_stmt.else_block, branch_env, imports, current_file, 0);
+                if (!block_may_capture(stmt->as.if_stmt.else_block)) env_release(branch_env);
                 if (r.control != CTRL_NONE) return r;
             }
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_SWITCH: {
-            Value sw = eval_expr(stmt->as.switch_stmt.value, env, imports, current_file);
-            for (int i = 0; i < stmt->as.switch_stmt.case_count; i++) {
-                Value cv = eval_expr(stmt->as.switch_stmt.case_values[i], env, imports, current_file);
-                if (!values_equal(sw, cv)) continue;
+            Value sw = eval_expr(expr_at(stmt->as.switch_stmt->value), env, imports, current_file);
+            SwitchTable *table = switch_table_for(stmt);
+            int first = 0;
+            if (table != NULL) {
+                int found = switch_table_find(table, sw);
+                first = found >= 0 ? found : stmt->as.switch_stmt->case_count;
+            }
+            for (int i = first; i < stmt->as.switch_stmt->case_count; i++) {
+                if (table == NULL) {
+                    Value cv = eval_expr(expr_at(stmt->as.switch_stmt->case_values[i]), env, imports, current_file);
+                    if (!values_equal(sw, cv)) continue;
+                }
                 Env *case_env = env_new(env);
-                EvalResult r = g_use_vm ? vm_eval_block(stmt->as.switch_stmt.case_blocks[i], case_env, imports, current_file, 0)
-                                        : eval_block(stmt->as.switch_stmt.case_blocks[i], case_env, imports, current_file, 0);
+                EvalResult r = g_use_vm ? vm_eval_block(stmt->as.switch_stmt->case_blocks[i], case_env, imports, current_file, 0)
+                                        : eval_block(stmt->as.switch_stmt->case_blocks[i], case_env, imports, current_file, 0);
+                if (!block_may_capture(stmt->as.switch_stmt->case_blocks[i])) env_release(case_env);
                 if (r.control != CTRL_NONE) return r;
                 return eval_result(value_null(), CTRL_NONE);
             }
-            if (stmt->as.switch_stmt.default_block != NULL) {
+            if (stmt->as.switch_stmt->default_block != NULL) {
                 Env *default_env = env_new(env);
                 EvalResult r =
-                    g_use_vm ? vm_eval_block(stmt->as.switch_stmt.default_block, default_env, imports, current_file, 0)
-                             : eval_block(stmt->as.switch_stmt.default_block, default_env, imports, current_file, 0);
+                    g_use_vm ? vm_eval_block(stmt->as.switch_stmt->default_block, default_env, imports, current_file, 0)
+                             : eval_block(stmt->as.switch_stmt->default_block, default_env, imports, current_file, 0);
+                if (!block_may_capture(stmt->as.switch_stmt->default_block)) env_release(default_env);
                 if (r.control != CTRL_NONE) return r;
             }
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_WHILE: {
+            /* A body that cannot capture its Env runs every iteration in the same one. */
+            Env *reused = block_may_capture(stmt->as.while_stmt.body) ? NULL : env_new(env);
+            EvalResult r = eval_result(value_null(), CTRL_NONE);
             while (1) {
-                Value cond = eval_expr(stmt->as.while_stmt.cond, env, imports, current_file);
+                if (g_tiered && tier_is_hot(stmt->as.while_stmt.body, TIER_UP_ITERATIONS)) {
+                    Bytecode *code = vm_loop_code(stmt);
+                    if (code != NULL) {
+                        (void)vm_exec(code, env, imports, current_file);
+                        break;
+                    }
+                    stmt->as.while_stmt.body->hot = -1;
+                }
+                Value cond = eval_expr(expr_at(stmt->as.while_stmt.cond), env, imports, current_file);
                 if (!is_truthy(cond)) break;
-                Env *loop_env = env_new(env);
-                EvalResult r = g_use_vm ? vm_eval_block(stmt->as.while_stmt.body, loop_env, imports, current_file, 0)
-                                        : eval_block(stmt->as.while_stmt.body, loop_env, imports, current_file, 0);
-                if (r.control == CTRL_RETURN) return r;
-                if (r.control == CTRL_BREAK) break;
-                if (r.control == CTRL_CONTINUE) continue;
+                Env *loop_env = reused;
+                if (loop_env != NULL) {
+                    env_truncate(loop_env, 0);
+                } else {
+                    loop_env = env_new(env);
+                }
+                r = g_use_vm ? vm_eval_block(stmt->as.while_stmt.body, loop_env, imports, current_file, 0)
+                             : eval_block(stmt->as.while_stmt.body, loop_env, imports, current_file, 0);
+                if (r.control == CTRL_RETURN || r.control == CTRL_TAIL_CALL || r.control == CTRL_BREAK) break;
             }
+            if (reused != NULL) env_release(reused);
+            if (r.control == CTRL_RETURN || r.control == CTRL_TAIL_CALL) return r;
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_FOR: {
-            Value iter = eval_expr(stmt->as.for_stmt.iter_expr, env, imports, current_file);
-            if (iter.type == VAL_ARRAY) {
-                for (int i = 0; i < iter.as.array_val->count; i++) {
-                    Env *loop_env = env_new(env);
-                    if (stmt->as.for_stmt.iter_value_name != NULL) {
-                        env_define(loop_env, stmt->as.for_stmt.iter_name, value_int(i));
-                        env_define(loop_env, stmt->as.for_stmt.iter_value_name, iter.as.array_val->items[i]);
-                    } else {
-                        env_define(loop_env, stmt->as.for_stmt.iter_name, iter.as.array_val->items[i]);
-                    }
-                    EvalResult r = g_use_vm ? vm_eval_block(stmt->as.for_stmt.body, loop_env, imports, current_file, 0)
-                                            : eval_block(stmt->as.for_stmt.body, loop_env, imports, current_file, 0);
-                    if (r.control == CTRL_RETURN) return r;
-                    if (r.control == CTRL_BREAK) break;
-                    if (r.control == CTRL_CONTINUE) continue;
+            Expr *iter_expr = expr_at(stmt->as.for_stmt.iter_expr);
+            Value iter;
+            long long i = 0;
+            if (iter_expr->kind == EXPR_CALL && iter_expr->core == CORE_RANGE &&
+                core_builtin_intact(CORE_RANGE) && stmt->as.for_stmt.iter_value_name == NULL) {
+                /* for x in range(...): an int bound stands in for the array, as with RANGE_INIT. */
+                int argc = iter_expr->as.call.argc;
+                Value bounds[2] = {value_null(), value_null()};
+                for (int k = 0; k < argc; k++) {
+                    bounds[k] = eval_expr(expr_at(iter_expr->as.call.args[k]), env, imports, current_file);
+                }
+                if (bounds[0].type == VAL_INT && bounds[argc - 1].type == VAL_INT) {
+                    if (argc == 2) i = bounds[0].as.int_val;
+                    iter = bounds[argc - 1];
+                } else {
+                    iter = builtin_range(bounds, argc, iter_expr->line, iter_expr->col, current_file);
+                }
+            } else {
+                iter = eval_expr(iter_expr, env, imports, current_file);
+                if (iter.type != VAL_ARRAY && iter.type != VAL_OBJECT) {
+                    runtime_error(stmt->line, stmt->col, "for loop expects array or object iterable");
                 }
-                return eval_result(value_null(), CTRL_NONE);
             }
-            if (iter.type == VAL_OBJECT) {
-                Object *obj = iter.as.object_val;
-                for (int i = 0; i < obj->count; i++) {
-                    Env *loop_env = env_new(env);
-                    if (stmt->as.for_stmt.iter_value_name != NULL) {
-                        env_define(loop_env, stmt->as.for_stmt.iter_name, value_string(obj->items[i].key));
-                        env_define(loop_env, stmt->as.for_stmt.iter_value_name, obj->items[i].value);
-                    } else {
-                        env_define(loop_env, stmt->as.for_stmt.iter_name, value_string(obj->items[i].key));
-                    }
-                    EvalResult r = g_use_vm ? vm_eval_block(stmt->as.for_stmt.body, loop_env, imports, current_file, 0)
-                                            : eval_block(stmt->as.for_stmt.body, loop_env, imports, current_file, 0);
-                    if (r.control == CTRL_RETURN) return r;
-                    if (r.control == CTRL_BREAK) break;
-                    if (r.control == CTRL_CONTINUE) continue;
+            /* As for while; the loop variables stay the reused Env's first bindings. */
+            Env *reused = block_may_capture(stmt->as.for_stmt.body) ? NULL : env_new(env);
+            int vars = 0;
+            EvalResult r = eval_result(value_null(), CTRL_NONE);
+            for (; i < iter_bound(iter); i++) {
+                Env *loop_env = reused;
+                if (loop_env != NULL) {
+                    env_truncate(loop_env, vars);
+                } else {
+                    loop_env = env_new(env);
                 }
-                return eval_result(value_null(), CTRL_NONE);
+                Value key = iter.type != VAL_OBJECT ? value_int(i) : value_string(iter.as.object_val->items[i].key);
+                if (stmt->as.for_stmt.iter_value_name != NULL) {
+                    env_define(loop_env, stmt->as.for_stmt.iter_name, key);
+                    env_define(loop_env, stmt->as.for_stmt.iter_value_name,
+                               iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : iter.as.object_val->items[i].value);
+                } else {
+                    env_define(loop_env, stmt->as.for_stmt.iter_name, iter.type == VAL_ARRAY ? iter.as.array_val->items[i] : key);
+                }
+                vars = loop_env->count;
+                r = g_use_vm ? vm_eval_block(stmt->as.for_stmt.body, loop_env, imports, current_file, 0)
+                             : eval_block(stmt->as.for_stmt.body, loop_env, imports, current_file, 0);
+                if (r.control == CTRL_RETURN || r.control == CTRL_TAIL_CALL || r.control == CTRL_BREAK) break;
             }
-            runtime_error(stmt->line, stmt->col, "for loop expects array or object iterable");
+            if (reused != NULL) env_release(reused);
+            if (r.control == CTRL_RETURN || r.control == CTRL_TAIL_CALL) return r;
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_BREAK:
@@ -4011,13 +8744,18 @@ static EvalResult eval_statement(Stmt *stmt, Env *env, ImportSet *imports, const
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_TYPE: {
-            Value v = eval_expr(stmt->as.type_stmt.value, env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.type_stmt.value), env, imports, current_file);
             env_define(env, stmt->as.type_stmt.name, v);
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_TRY: {
             ExceptionFrame frame;
             frame.prev = g_exception_top;
+            frame.vm_stack_count = g_vm.stack.count;
+            frame.vm_stack_base = g_vm.stack.base;
+            frame.vm_frame_count = g_vm.frame_count;
+            frame.call_depth = g_call_depth;
+            frame.arg_top = g_arg_top;
             g_exception_top = &frame;
 
             if (setjmp(frame.env) == 0) {
@@ -4029,6 +8767,12 @@ static EvalResult eval_statement(Stmt *stmt, Env *env, ImportSet *imports, const
             }
 
             g_exception_top = frame.prev;
+            /* longjmp skipped the vm_exec epilogues between the throw and here. */
+            g_vm.stack.count = frame.vm_stack_count;
+            g_vm.stack.base = frame.vm_stack_base;
+            g_vm.frame_count = frame.vm_frame_count;
+            g_call_depth = frame.call_depth;
+            g_arg_top = frame.arg_top;
             Env *catch_env = env_new(env);
             env_define(catch_env, stmt->as.try_stmt.catch_name, g_exception_value);
             EvalResult r = g_use_vm ? vm_eval_block(stmt->as.try_stmt.catch_block, catch_env, imports, current_file, 0)
@@ -4043,15 +8787,48 @@ static EvalResult eval_statement(Stmt *stmt, Env *env, ImportSet *imports, const
             fn->body = stmt->as.fn_stmt.body;
             fn->closure = env;
             fn->def_file = xstrdup(current_file ? current_file : "");
+            fn->code = NULL;
+            fn->code_resolved = 0;
             env_define(env, stmt->as.fn_stmt.name, value_function(fn));
             return eval_result(value_null(), CTRL_NONE);
         }
         case STMT_RETURN: {
-            Value v = eval_expr(stmt->as.return_stmt.value, env, imports, current_file);
+            if (stmt->as.return_stmt.tail_call) {
+                /* Operands are evaluated here; apply_function makes the call in place of this one. */
+                Expr *call = expr_at(stmt->as.return_stmt.value);
+                Expr *callee = expr_at(call->as.call.callee);
+                int argc = call->as.call.argc;
+                Value self = value_null();
+                int bind = 0;
+                if (callee->kind == EXPR_DOT) {
+                    self = eval_expr(expr_at(callee->as.dot.left), env, imports, current_file);
+                    g_tail_call.callee = object_get_method(self, callee->as.dot.member, &bind, callee->line, callee->col);
+                } else if (core_builtin_intact(call->core)) {
+                    g_tail_call.callee = value_builtin(k_core_builtin_fns[call->core]);
+                } else {
+                    g_tail_call.callee = eval_expr(callee, env, imports, current_file);
+                }
+                Value *args = arg_window_take(argc) + 1;
+                for (int i = 0; i < argc; i++) {
+                    args[i] = eval_expr(expr_at(call->as.call.args[i]), env, imports, current_file);
+                }
+                g_tail_call.window = args - 1;
+                if (bind) {
+                    args[-1] = self;
+                    args--;
+                    argc++;
+                }
+                g_tail_call.args = args;
+                g_tail_call.argc = argc;
+                g_tail_call.line = call->line;
+                g_tail_call.col = call->col;
+                return eval_result(value_null(), CTRL_TAIL_CALL);
+            }
+            Value v = eval_expr(expr_at(stmt->as.return_stmt.value), env, imports, current_file);
             return eval_result(v, CTRL_RETURN);
         }
         case STMT_THROW: {
-            Value v = eval_expr(stmt->as.throw_stmt.value, env, imports, current_file);
+            Value v = eval_expr(expr_at(stmt->as.throw_stmt.value), env, imports, current_file);
             throw_value(stmt->line, stmt->col, v);
             return eval_result(value_null(), CTRL_NONE);
         }
@@ -4109,9 +8886,43 @@ static EvalResult eval_block(Block *block, Env *env, ImportSet *imports, const c
     return eval_result(last, CTRL_NONE);
 }
 
+/* --lex-bench: tokenizes the script repeatedly for at least a quarter second of CPU time. */
+static void lex_bench(const char *source) {
+    size_t bytes = strlen(source);
+    long long tokens = 0;
+    int passes = 0;
+    clock_t begin = clock();
+    clock_t elapsed;
+    do {
+        Lexer lx;
+        lexer_init(&lx, source);
+        while (lexer_next_token(&lx).type != TOK_EOF) tokens++;
+        xfree(lx.escaped);
+        passes++;
+        elapsed = clock() - begin;
+    } while (elapsed < CLOCKS_PER_SEC / 4);
+    double secs = elapsed > 0 ? (double)elapsed / CLOCKS_PER_SEC : 1e-9;
+    fprintf(stderr, "[lex-bench] bytes=%lu tokens=%lld passes=%d MB/s=%.1f\n", (unsigned long)bytes, tokens / passes,
+            passes, (double)bytes * passes / secs / 1e6);
+}
+
+static void ast_stats_report(void) {
+    double per_line = g_ast_lines > 0 ? (double)g_ast_bytes / (double)g_ast_lines : 0.0;
+    fprintf(stderr, "[ast-stats] lines=%lld nodes=%lld bytes=%lld bytes/line=%.1f (Expr %lu, Stmt %lu, Block %lu bytes)\n",
+            g_ast_lines, g_ast_nodes, g_ast_bytes, per_line, (unsigned long)sizeof(Expr), (unsigned long)sizeof(Stmt),
+            (unsigned long)sizeof(Block));
+}
+
+static void alloc_stats_report(void) {
+    double per_stmt = g_stmt_count > 0 ? (double)g_malloc_calls / (double)g_stmt_count : 0.0;
+    fprintf(stderr, "[alloc-stats] mallocs=%lld statements=%lld mallocs/statement=%.2f\n", g_malloc_calls, g_stmt_count,
+            per_stmt);
+}
+
 int main(int argc, char **argv) {
     int script_arg_index = 1;
     int explicit_debug = 0;
+    const char *snapshot_in = NULL;
 
     while (script_arg_index < argc) {
         const char *arg = argv[script_arg_index];
@@ -4129,6 +8940,16 @@ int main(int argc, char **argv) {
             script_arg_index++;
             continue;
         }
+        if (strcmp(arg, "--ast-stats") == 0) {
+            g_ast_stats = 1;
+            script_arg_index++;
+            continue;
+        }
+        if (strcmp(arg, "--lex-bench") == 0) {
+            g_lex_bench = 1;
+            script_arg_index++;
+            continue;
+        }
         if (strcmp(arg, "--vm") == 0) {
             g_use_vm = 1;
             script_arg_index++;
@@ -4140,6 +8961,83 @@ int main(int argc, char **argv) {
             script_arg_index++;
             continue;
         }
+        if (strcmp(arg, "--alloc-stats") == 0) {
+            g_alloc_stats = 1;
+            script_arg_index++;
+            continue;
+        }
+        if (strcmp(arg, "--emit-builtin-snapshot") == 0) {
+            /* Build step (see Makefile): writes the C header holding the builtin module images. */
+            if (script_arg_index + 1 >= argc) {
+                fprintf(stderr, "Error: --emit-builtin-snapshot expects an output path\n");
+                return 1;
+            }
+            if (!emit_builtin_snapshot(argv[script_arg_index + 1])) {
+                fprintf(stderr, "Error: could not write %s\n", argv[script_arg_index + 1]);
+                return 1;
+            }
+            return 0;
+        }
+        if (strcmp(arg, "--snapshot-out") == 0 || strcmp(arg, "--snapshot-in") == 0) {
+            if (script_arg_index + 1 >= argc) {
+                fprintf(stderr, "Error: %s expects a file path\n", arg);
+                return 1;
+            }
+            if (strcmp(arg, "--snapshot-out") == 0) {
+                g_snapshot_out = argv[script_arg_index + 1];
+            } else {
+                snapshot_in = argv[script_arg_index + 1];
+            }
+            script_arg_index += 2;
+            continue;
+        }
+        if (strcmp(arg, "--cache-dir") == 0) {
+            if (script_arg_index + 1 >= argc) {
+                fprintf(stderr, "Error: --cache-dir expects a directory\n");
+                return 1;
+            }
+            g_cache_dir = argv[script_arg_index + 1];
+#if defined(_WIN32)
+            (void)_mkdir(g_cache_dir);
+#else
+            (void)mkdir(g_cache_dir, 0777);
+#endif
+            script_arg_index += 2;
+            continue;
+        }
+        if (strcmp(arg, "--tiered") == 0) {
+            /* Tier 0 is the AST walker, tier 1 the VM; on NYX_JIT builds tier 2 is --jit. */
+            g_tiered = 1;
+            g_jit = NYX_JIT;
+            script_arg_index++;
+            continue;
+        }
+        if (strcmp(arg, "--jit") == 0) {
+#if NYX_JIT
+            g_jit = 1;
+            g_use_vm = 1;
+#else
+            fprintf(stderr, "Warning: --jit needs an x86-64 Linux build; running the VM without it\n");
+            g_use_vm = 1;
+#endif
+            script_arg_index++;
+            continue;
+        }
+        if (strcmp(arg, "-O") == 0) {
+            g_optimize = 1;
+            script_arg_index++;
+            continue;
+        }
+        if (strcmp(arg, "--dump-bytecode") == 0) {
+            g_dump_bytecode = 1;
+            script_arg_index++;
+            continue;
+        }
+        if (strcmp(arg, "--profile-ops") == 0) {
+            g_profile_ops = 1;
+            script_arg_index++;
+            continue;
+        }
         if (strcmp(arg, "--version") == 0) {
             printf("%s\n", NYX_LANG_VERSION);
             return 0;
@@ -4189,6 +9087,25 @@ int main(int argc, char **argv) {
             script_arg_index += 2;
             continue;
         }
+        if (strcmp(arg, "-j") == 0) {
+            if (script_arg_index + 1 >= argc) {
+                fprintf(stderr, "Error: -j expects a value\n");
+                return 1;
+            }
+            char *endp = NULL;
+            long v = strtol(argv[script_arg_index + 1], &endp, 10);
+            if (endp == argv[script_arg_index + 1] || *endp != '\0' || v < 1 || v > 256) {
+                fprintf(stderr, "Error: -j expects an integer in [1, 256]\n");
+                return 1;
+            }
+#if NYX_THREADS
+            g_parse_jobs = (int)v;
+#else
+            if (v > 1) fprintf(stderr, "Warning: -j needs a pthreads build; parsing imports on demand\n");
+#endif
+            script_arg_index += 2;
+            continue;
+        }
         if (strcmp(arg, "--debug") == 0) {
             g_debug_enabled = 1;
             explicit_debug = 1;
@@ -4259,7 +9176,7 @@ int main(int argc, char **argv) {
         source = read_file(script_path);
         if (!source) {
             fprintf(stderr,
-                    "Usage: nyx [--trace] [--parse-only|--lint] [--vm|--vm-strict] [--max-alloc N] [--max-steps N] [--max-call-depth N] [--debug] [--break lines] [--step] [--step-count N] "
+                    "Usage: nyx [--trace] [--parse-only|--lint] [--lex-bench] [--ast-stats] [--vm|--vm-strict] [-O] [--tiered] [--jit] [--cache-dir DIR] [--snapshot-out FILE] [--snapshot-in FILE] [--max-alloc N] [--max-steps N] [--max-call-depth N] [-j N] [--alloc-stats] [--dump-bytecode] [--profile-ops] [--debug] [--break lines] [--step] [--step-count N] "
                     "[--debug-no-prompt] [--version] "
                     "<file.ny> [args...]\n");
             fprintf(stderr, "Hint: run from a directory that contains main.ny or pass a file path explicitly.\n");
@@ -4279,10 +9196,22 @@ int main(int argc, char **argv) {
         script_argc = argc - script_arg_index;
     }
 
+    if (g_ast_stats && atexit(ast_stats_report) != 0) {
+        fprintf(stderr, "Failed to register AST stats hook\n");
+        return 1;
+    }
+
+    if (g_lex_bench) {
+        lex_bench(source);
+        xfree(source);
+        return 0;
+    }
+
     if (g_parse_only) {
         Parser p;
         parser_init(&p, source);
         (void)parse_program(&p);
+        xfree(p.lx.escaped);
         xfree(source);
         return 0;
     }
@@ -4291,16 +9220,37 @@ int main(int argc, char **argv) {
     g_script_argv = script_argv;
     g_step_count = 0;
     g_call_depth = 0;
-
-    Env *global = env_new(NULL);
-    install_builtins(global);
+    if (g_alloc_stats && atexit(alloc_stats_report) != 0) {
+        fprintf(stderr, "Failed to register allocation stats hook\n");
+        return 1;
+    }
+    if (g_profile_ops && atexit(op_profile_report) != 0) {
+        fprintf(stderr, "Failed to register opcode profile hook\n");
+        return 1;
+    }
 
     ImportSet imports;
     imports.items = NULL;
     imports.count = 0;
     imports.cap = 0;
 
+    Env *global = NULL;
+    if (snapshot_in != NULL) {
+        global = snapshot_load(snapshot_in, &imports);
+        if (global == NULL) {
+            fprintf(stderr, "Error: invalid or incompatible snapshot: %s\n", snapshot_in);
+            return 1;
+        }
+    } else {
+        global = env_new(NULL);
+        install_builtins(global);
+    }
+    if (g_use_vm) vm_state_init();
+
     import_set_add(&imports, script_path);
+#if NYX_THREADS
+    if (g_parse_jobs > 1) import_prefetch(script_path, source);
+#endif
 
     EvalResult r = eval_program_source(source, global, &imports, script_path, 1);
     xfree(source);
@@ -4313,6 +9263,10 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Error: break/continue at top-level is not allowed\n");
         return 1;
     }
+    if (g_snapshot_out != NULL && !snapshot_write(g_snapshot_out, global, &imports)) {
+        fprintf(stderr, "Error: could not write snapshot: %s\n", g_snapshot_out);
+        return 1;
+    }
 
     return 0;
 }
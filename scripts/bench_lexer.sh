@@ -0,0 +1,24 @@
+#!/usr/bin/env sh
+# Lexer throughput in MB/s on generated inputs: config-style literals, indented code with comments,
+# and long string literals.
+set -eu
+
+ROOT_DIR=$(CDPATH= cd -- "$(dirname -- "$0")/.." && pwd)
+cd "$ROOT_DIR"
+
+make >/dev/null
+
+tmpd=$(mktemp -d)
+trap 'rm -rf "$tmpd"' EXIT
+
+awk 'BEGIN { for (i = 0; i < 40000; i++)
+  printf "let cfg_%d = {name: \"service-%d\", host: \"10.0.%d.%d\", port: %d, tags: [\"a\\tb\", \"prod\"], enabled: true};\n", i, i, i % 255, i % 7, 8000 + i % 1000 }' >"$tmpd/config.nx"
+awk 'BEGIN { for (i = 0; i < 40000; i++)
+  printf "        # step %d: accumulate the running total\n        if (total > %d) {\n                total = total - item_%d * 3;\n        }\n", i, i, i }' >"$tmpd/code.nx"
+awk 'BEGIN { d = sprintf("%150s", ""); gsub(/ /, "lorem ", d); for (i = 0; i < 5000; i++)
+  printf "let doc_%d = \"%s\";\n", i, d }' >"$tmpd/strings.nx"
+
+for input in config code strings; do
+  printf '%-8s ' "$input"
+  ./build/nyx --lex-bench "$tmpd/$input.nx" 2>&1
+done
@@ -87,7 +87,7 @@ while (true) {
     $callPath = Join-Path $tmp 'call_limit.ny'
 @"
 fn dive(n) {
-    return dive(n + 1);
+    return 1 + dive(n + 1);
 }
 
 dive(0);
@@ -17,7 +17,7 @@ while (true) {
 }
 CYEOF
 
-if ./nyx --max-steps 120 "$tmpd/step_limit.nx" >/dev/null 2>"$tmpd/step.err"; then
+if ./build/nyx --max-steps 120 "$tmpd/step_limit.nx" >/dev/null 2>"$tmpd/step.err"; then
   echo "FAIL: --max-steps should fail on infinite loop"
   exit 1
 fi
@@ -29,13 +29,13 @@ grep -q "max step count exceeded" "$tmpd/step.err" || {
 
 cat >"$tmpd/call_limit.nx" <<'CYEOF'
 fn dive(n) {
-    return dive(n + 1);
+    return 1 + dive(n + 1);
 }
 
 dive(0);
 CYEOF
 
-if ./nyx --max-call-depth 64 "$tmpd/call_limit.nx" >/dev/null 2>"$tmpd/call.err"; then
+if ./build/nyx --max-call-depth 64 "$tmpd/call_limit.nx" >/dev/null 2>"$tmpd/call.err"; then
   echo "FAIL: --max-call-depth should fail on unbounded recursion"
   exit 1
 fi
@@ -53,11 +53,631 @@ fn add(a, b) {
 print(add(40, 2));
 CYEOF
 
-out=$(./nyx --max-steps 200 --max-call-depth 64 "$tmpd/ok.nx")
+out=$(./build/nyx --max-steps 200 --max-call-depth 64 "$tmpd/ok.nx")
 [ "$out" = "42" ] || {
   echo "FAIL: limited runtime produced unexpected output"
   echo "Got: $out"
   exit 1
 }
 
+cat >"$tmpd/deep.nx" <<'CYEOF'
+fn depth(n) {
+    if (n == 0) {
+        return 0;
+    }
+    return 1 + depth(n - 1);
+}
+
+print(depth(200000));
+CYEOF
+
+# VM calls are heap frame pushes, so depth is bounded by --max-call-depth, not the C stack.
+out=$(./build/nyx --vm --max-call-depth 300000 "$tmpd/deep.nx")
+[ "$out" = "200000" ] || {
+  echo "FAIL: deep VM recursion produced unexpected output"
+  echo "Got: $out"
+  exit 1
+}
+if ./build/nyx --vm --max-call-depth 1000 "$tmpd/deep.nx" >/dev/null 2>"$tmpd/deep.err"; then
+  echo "FAIL: VM --max-call-depth should fail on deep recursion"
+  exit 1
+fi
+grep -q "max call depth exceeded" "$tmpd/deep.err" || {
+  echo "FAIL: missing VM max call depth error"
+  cat "$tmpd/deep.err"
+  exit 1
+}
+
+cat >"$tmpd/tail.nx" <<'CYEOF'
+fn count(n, acc) {
+    if (n == 0) {
+        return acc;
+    }
+    return count(n - 1, acc + 1);
+}
+fn is_even(n) { if (n == 0) { return true; } return is_odd(n - 1); }
+fn is_odd(n) { if (n == 0) { return false; } return is_even(n - 1); }
+fn boom(n) { if (n == 0) { throw "done"; } return boom(n - 1); }
+fn guarded(n) {
+    try { return boom(n); } catch (e) { return "caught " + e; }
+}
+print(count(1000000, 0));
+print(is_even(100001));
+print(guarded(50000));
+CYEOF
+
+# `return f(...)` reuses the caller's activation, so it never counts against the depth limit.
+for mode in "" "--vm"; do
+  out=$(./build/nyx $mode --max-call-depth 1000 "$tmpd/tail.nx" | tr '\n' ' ')
+  [ "$out" = "1000000 false caught done " ] || {
+    echo "FAIL: tail calls ${mode:-ast} produced unexpected output"
+    echo "Got: $out"
+    exit 1
+  }
+done
+
+cat >"$tmpd/fused.nx" <<'CYEOF'
+let i = 0;
+while (i < 3) {
+    i = i + 1;
+}
+print(i);
+let s = "x";
+print(s - 1);
+CYEOF
+
+if ./build/nyx --vm --dump-bytecode "$tmpd/fused.nx" >"$tmpd/fused.out" 2>"$tmpd/fused.err"; then
+  echo "FAIL: fused string arithmetic should fail"
+  exit 1
+fi
+grep -q "LT_LOCAL_IMM" "$tmpd/fused.err" && grep -q "ADD_LOCAL_IMM" "$tmpd/fused.err" || {
+  echo "FAIL: --dump-bytecode did not show superinstructions"
+  cat "$tmpd/fused.err"
+  exit 1
+}
+ast_err=$(./build/nyx "$tmpd/fused.nx" 2>&1 >/dev/null || true)
+grep -q "^$ast_err\$" "$tmpd/fused.err" || {
+  echo "FAIL: superinstruction error differs from AST interpreter"
+  echo "AST: $ast_err"
+  cat "$tmpd/fused.err"
+  exit 1
+}
+
+cat >"$tmpd/cached_lib.nx" <<'CYEOF'
+fn twice(x) { return x * 2; }
+CYEOF
+cat >"$tmpd/cached.nx" <<'CYEOF'
+import "cached_lib.nx";
+fn greet(name) { return "hi " + name; }
+let xs = [twice(v) for v in [1, 2, 3] if v > 1];
+print(greet("nyx"), xs, {k: -4});
+CYEOF
+
+# .nyc files: the second run loads the tree from the cache; damaged or stale files are reparsed.
+want=$(./build/nyx "$tmpd/cached.nx")
+for round in 1 2; do
+  out=$(./build/nyx --cache-dir "$tmpd/cache" "$tmpd/cached.nx")
+  [ "$out" = "$want" ] || {
+    echo "FAIL: --cache-dir run $round produced unexpected output"
+    echo "Got: $out"
+    exit 1
+  }
+done
+[ "$(ls "$tmpd/cache" | grep -c '\.nyc$')" -ge 2 ] || {
+  echo "FAIL: --cache-dir did not write .nyc files for the script and its import"
+  ls -la "$tmpd/cache"
+  exit 1
+}
+for f in "$tmpd"/cache/*.nyc; do
+  printf 'garbage' | dd of="$f" bs=1 seek=100 conv=notrunc 2>/dev/null
+done
+out=$(./build/nyx --cache-dir "$tmpd/cache" "$tmpd/cached.nx")
+[ "$out" = "$want" ] || {
+  echo "FAIL: damaged .nyc file was not rejected"
+  echo "Got: $out"
+  exit 1
+}
+sed -i.bak 's/hi /hello /' "$tmpd/cached.nx"
+out=$(./build/nyx --cache-dir "$tmpd/cache" "$tmpd/cached.nx")
+case "$out" in
+  "hello nyx"*) ;;
+  *)
+    echo "FAIL: edited source ran from a stale cache entry"
+    echo "Got: $out"
+    exit 1
+    ;;
+esac
+
+cat >"$tmpd/prelude.nx" <<'CYEOF'
+import "nymath";
+let config = {name: "svc", tags: ["a", "b"]};
+fn make_counter(start) {
+    let n = start;
+    fn next() { n = n + 1; return n; }
+    return next;
+}
+let counter = make_counter(10);
+class Point {
+    fn init(self, x, y) { object_set(self, "x", x); object_set(self, "y", y); }
+    fn sum(self) { return self.x + self.y; }
+}
+let origin = new(Point, 1, 2);
+let loop = {};
+let tmp = object_set(loop, "me", loop);
+let size = len;
+print("prelude");
+CYEOF
+cat >"$tmpd/job.nx" <<'CYEOF'
+print(config.name, config.tags, counter(), counter());
+print(origin.sum(), new(Point, 5, 6).sum(), size([1, 2]), loop.me.me == loop);
+CYEOF
+
+# A heap snapshot restores globals, closures, classes, cycles and builtins without rerunning the prelude.
+out=$(./build/nyx --snapshot-out "$tmpd/prelude.nys" "$tmpd/prelude.nx")
+[ "$out" = "prelude" ] || {
+  echo "FAIL: --snapshot-out did not run the prelude"
+  echo "Got: $out"
+  exit 1
+}
+for mode in "" "--vm"; do
+  out=$(./build/nyx $mode --snapshot-in "$tmpd/prelude.nys" "$tmpd/job.nx" | tr '\n' ' ')
+  [ "$out" = "svc [a, b] 11 12 3 11 2 true " ] || {
+    echo "FAIL: --snapshot-in ${mode:-ast} produced unexpected output"
+    echo "Got: $out"
+    exit 1
+  }
+done
+head -c 200 "$tmpd/prelude.nys" >"$tmpd/broken.nys"
+if ./build/nyx --snapshot-in "$tmpd/broken.nys" "$tmpd/job.nx" >/dev/null 2>"$tmpd/snap.err"; then
+  echo "FAIL: truncated snapshot should be rejected"
+  exit 1
+fi
+grep -q "invalid or incompatible snapshot" "$tmpd/snap.err" || {
+  echo "FAIL: missing snapshot rejection error"
+  cat "$tmpd/snap.err"
+  exit 1
+}
+
+# make links the builtin modules in precompiled; importing them must not need the parser.
+for mod in nymath nyarrays nyobjects nyjson nyhttp; do
+  grep -q "k_builtin_image_$mod" build/nyx_builtins.h || {
+    echo "FAIL: builtin snapshot is missing $mod"
+    exit 1
+  }
+done
+printf 'import "nymath";\nimport "nyjson";\nprint(1);\n' >"$tmpd/snap.nx"
+stage0=$(./build/nyx-stage0 --alloc-stats "$tmpd/snap.nx" 2>&1 | sed -n 's/.*mallocs=\([0-9]*\).*/\1/p')
+final=$(./build/nyx --alloc-stats "$tmpd/snap.nx" 2>&1 | sed -n 's/.*mallocs=\([0-9]*\).*/\1/p')
+[ -n "$final" ] && [ "$final" -lt "$stage0" ] || {
+  echo "FAIL: builtin imports did not load from the snapshot ($final vs $stage0 mallocs)"
+  exit 1
+}
+
+# --tiered starts everything in the AST walker; warm functions and while loops move to the VM.
+cat >"$tmpd/tier.nx" <<'CYEOF'
+fn sq(x) {
+    return x * x;
+}
+fn first_over(limit) {
+    let i = 0;
+    while (true) {
+        if (sq(i) > limit) {
+            return i;
+        }
+        i = i + 1;
+    }
+}
+let total = 0;
+let i = 0;
+while (i < 2000) {
+    i = i + 1;
+    if (i % 7 == 0) {
+        continue;
+    }
+    if (i > 1500) {
+        break;
+    }
+    let t = sq(i) % 10;
+    total = total + t;
+}
+print(total, i, first_over(100000));
+CYEOF
+out=$(./build/nyx --tiered "$tmpd/tier.nx")
+[ "$out" = "5785 1501 317" ] || {
+  echo "FAIL: --tiered produced unexpected output"
+  echo "Got: $out"
+  exit 1
+}
+tiers=$(./build/nyx --tiered --dump-bytecode "$tmpd/tier.nx" 2>&1 | grep -c '^\[bytecode\] \(fn at 2:\|loop at 15:\)' || true)
+[ "$tiers" = "2" ] || {
+  echo "FAIL: --tiered did not move the hot function and loop to the VM"
+  exit 1
+}
+
+# --jit runs hot functions natively; guard misses and unsupported opcodes fall back to the VM.
+if [ "$(uname -s)" = "Linux" ] && [ "$(uname -m)" = "x86_64" ]; then
+  cat >"$tmpd/jit.nx" <<'CYEOF'
+fn add(a, b) {
+    return a + b;
+}
+fn count_to(n) {
+    let i = 0;
+    let hits = 0;
+    while (i < n) {
+        if (i % 3 == 0) {
+            hits = hits + 1;
+        }
+        i = i + 1;
+    }
+    return hits;
+}
+fn keys(o) {
+    let out = "";
+    for (k, v in o) {
+        out = out + k + ";";
+    }
+    return out;
+}
+let total = 0;
+let r = 0;
+while (r < 40) {
+    total = add(total, count_to(r));
+    r = r + 1;
+}
+print(total, add("deopt ", "strings"), keys({"a": 1, "b": 2}));
+print(add(1, true));
+CYEOF
+  expected=$(./build/nyx "$tmpd/jit.nx" 2>&1 || true)
+  out=$(./build/nyx --jit "$tmpd/jit.nx" 2>&1 || true)
+  [ "$out" = "$expected" ] || {
+    echo "FAIL: --jit output differs from the AST walker"
+    echo "Expected: $expected"
+    echo "Got: $out"
+    exit 1
+  }
+  pid_map=$(sh -c 'echo $$; exec ./build/nyx --jit "$1" >/dev/null 2>&1' sh "$tmpd/jit.nx" | head -n 1)
+  grep -q "nyx:$tmpd/jit.nx:2" "/tmp/perf-$pid_map.map" || {
+    echo "FAIL: --jit did not write a perf map entry for add()"
+    exit 1
+  }
+  rm -f "/tmp/perf-$pid_map.map"
+fi
+
+# try/catch in VM frame code unwinds frames and call depth without a setjmp per try.
+cat >"$tmpd/catch.nx" <<'CYEOF'
+fn boom(n) {
+    if (n == 0) {
+        throw "done";
+    }
+    let r = boom(n - 1);
+    return r;
+}
+fn deep(n) {
+    try {
+        boom(n);
+    } catch (e) {
+        return 1;
+    }
+    return 0;
+}
+fn nested(x) {
+    let out = [];
+    for (v in [1, 2, 3]) {
+        try {
+            try {
+                if (v == x) { throw v * 10; }
+                push(out, v);
+            } catch (e) {
+                push(out, "inner " + str(e));
+                throw "outer";
+            }
+        } catch (e) {
+            push(out, e);
+        }
+    }
+    return out;
+}
+let k = 0;
+let total = 0;
+while (k < 20) {
+    total = total + deep(400);
+    k = k + 1;
+}
+print(total, nested(2));
+CYEOF
+for mode in "" "--vm"; do
+  out=$(./build/nyx $mode --max-call-depth 1000 "$tmpd/catch.nx" 2>&1)
+  [ "$out" = "20 [1, inner 20, outer, 3]" ] || {
+    echo "FAIL: try/catch ${mode:-ast} produced unexpected output"
+    echo "Got: $out"
+    exit 1
+  }
+done
+./build/nyx --vm --dump-bytecode "$tmpd/catch.nx" 2>&1 | grep -q '^  catch ' || {
+  echo "FAIL: try in frame code has no handler table"
+  exit 1
+}
+
+# VM comprehensions loop inline: one scope for the loop variables and a presized result.
+cat >"$tmpd/comp.nx" <<'CYEOF'
+let xs = range(-50000, 50000);
+let ys = [x * 2 for x in xs if x > 0];
+print(len(ys), ys[0], [k + str(v) for k, v in {"a": 1, "b": 2} if v > 1], [[a * b for b in [1, 2]] for a in [1, 3]]);
+CYEOF
+out=$(./build/nyx --vm --alloc-stats "$tmpd/comp.nx" 2>"$tmpd/comp.err")
+[ "$out" = "49999 2 [b2] [[1, 2], [3, 6]]" ] || {
+  echo "FAIL: VM comprehension produced unexpected output"
+  echo "Got: $out"
+  exit 1
+}
+mallocs=$(sed -n 's/.*mallocs=\([0-9]*\).*/\1/p' "$tmpd/comp.err")
+[ -n "$mallocs" ] && [ "$mallocs" -lt 1000 ] || {
+  echo "FAIL: VM comprehension allocated per element"
+  cat "$tmpd/comp.err"
+  exit 1
+}
+
+# Loop bodies that cannot capture their scope reuse one Env for every iteration.
+cat >"$tmpd/loopenv.nx" <<'CYEOF'
+let y = 100;
+let i = 0;
+let s = 0;
+while (i < 50000 && y == 100) {
+    let y = i;
+    s = s + y;
+    i = i + 1;
+}
+for (k, v in range(0, 50000)) {
+    s = s + v - k;
+}
+fn keep() {
+    let fs = [];
+    for (n in [1, 2, 3]) {
+        fn get() { return n; }
+        push(fs, get);
+    }
+    return [f() for f in fs];
+}
+print(s, y, keep());
+CYEOF
+for mode in "" "--vm"; do
+  out=$(./build/nyx $mode --alloc-stats "$tmpd/loopenv.nx" 2>"$tmpd/loopenv.err")
+  [ "$out" = "1249975000 100 [1, 2, 3]" ] || {
+    echo "FAIL: reused loop Env ${mode:-ast} produced unexpected output"
+    echo "Got: $out"
+    exit 1
+  }
+  mallocs=$(sed -n 's/.*mallocs=\([0-9]*\).*/\1/p' "$tmpd/loopenv.err")
+  [ -n "$mallocs" ] && [ "$mallocs" -lt 60000 ] || {
+    echo "FAIL: ${mode:-ast} loop allocated an Env per iteration"
+    cat "$tmpd/loopenv.err"
+    exit 1
+  }
+done
+
+# A switch over literal labels dispatches through a table; results match the sequential scan.
+cat >"$tmpd/switch.nx" <<'EOF'
+fn kind(x) {
+  switch (x) {
+    case 0: { return "zero"; }
+    case -2: { return "neg"; }
+    case "a": { return "A"; }
+    case 0: { return "dup"; }
+    case 9223372036854775807: { return "max"; }
+    default: { return "other"; }
+  }
+}
+let out = [];
+for (v in [0, -2, "a", 9223372036854775807, 1, "0", null]) { push(out, kind(v)); }
+print(out);
+EOF
+for mode in "" --vm; do
+  out=$(./build/nyx $mode "$tmpd/switch.nx")
+  [ "$out" = "[zero, neg, A, max, other, other, other]" ] || {
+    echo "FAIL: switch jump table ($mode) printed: $out"
+    exit 1
+  }
+done
+./build/nyx --vm --dump-bytecode "$tmpd/switch.nx" 2>&1 | grep -q 'SWITCH_TABLE *5 cases' || {
+  echo "FAIL: literal switch did not compile to SWITCH_TABLE"
+  exit 1
+}
+
+# Call arguments live in a reusable window, call Envs are recycled and obj.m(...) passes obj
+# straight to m: neither method calls nor plain calls allocate.
+cat >"$tmpd/args.nx" <<'EOF'
+class Counter {
+  fn init(self, start) { self.n = start; }
+  fn add(self, k, m) { self.n = self.n + k * m; return self.n; }
+}
+fn twice(x) { return x * 2; }
+let c = new(Counter, 0);
+let i = 0;
+let t = 0;
+while (i < 20000) { t = c.add(i, 2) + twice(i); i = i + 1; }
+print(c.n, t);
+EOF
+for mode in "" --vm; do
+  out=$(./build/nyx $mode --alloc-stats "$tmpd/args.nx" 2>"$tmpd/args.err")
+  mallocs=$(sed -n 's/.*mallocs=\([0-9]*\).*/\1/p' "$tmpd/args.err")
+  [ "$out" = "399980000 400019998" ] && [ -n "$mallocs" ] && [ "$mallocs" -lt 1000 ] || {
+    echo "FAIL: calls allocated per call ($mode): $out, $mallocs mallocs"
+    exit 1
+  }
+done
+./build/nyx --vm --dump-bytecode "$tmpd/args.nx" 2>&1 | grep -q 'METHOD_GET *add' || {
+  echo "FAIL: obj.m(...) did not compile to METHOD_GET/CALL_METHOD"
+  exit 1
+}
+
+# Method lookups are cached per class; redefining a method or shadowing it on the instance
+# must be seen by the very next call.
+cat >"$tmpd/mcache.nx" <<'EOF'
+class P {
+  fn init(self, x) { self.x = x; }
+  fn get(self) { return self.x; }
+}
+fn get2(self) { return self.x * 10; }
+fn get3(self) { return self.x * 100; }
+fn own(s) { return 7; }
+let p = new(P, 2);
+let r = [];
+let i = 0;
+while (i < 6) {
+  push(r, p.get());
+  if (i == 1) { class_set_method(P, "get", get2); }
+  if (i == 2) { P.get = get3; }
+  if (i == 3) { p.get = own; }
+  if (i == 4) { p.get = null; }
+  i = i + 1;
+}
+print(r);
+EOF
+for mode in "" --vm; do
+  out=$(./build/nyx $mode "$tmpd/mcache.nx")
+  [ "$out" = "[2, 2, 20, 200, 7, 200]" ] || {
+    echo "FAIL: method cache invalidation ($mode) printed: $out"
+    exit 1
+  }
+done
+
+# len/push/pop/has/object_get and `for (x in range(...))` take fast paths until the name is rebound.
+cat >"$tmpd/core.nx" <<'EOF'
+fn run(n) {
+  let xs = [];
+  for (i in range(n)) { push(xs, i); }
+  push(xs, 20);
+  push(xs, 30);
+  let t = 0;
+  let k = 0;
+  while (k < len(xs)) { t = t + xs[k]; k = k + 1; }
+  return [t, len(xs), pop(xs), has({a: 1}, "a"), object_get({a: 5}, "a")];
+}
+fn span(a, b) {
+  let s = 0;
+  for (i in range(a, b)) { s = s + i; }
+  return s;
+}
+print(run(4), span(2, 5), span(5, 2));
+fn len(x) { return 2; }
+fn range(n) { return [n]; }
+print(run(4));
+EOF
+for mode in "" --vm "--vm --jit"; do
+  out=$(./build/nyx $mode "$tmpd/core.nx" | tr '\n' ' ')
+  [ "$out" = "[56, 6, 30, true, 5] 9 0 [24, 2, 30, true, 5] " ] || {
+    echo "FAIL: core builtin fast paths ($mode) printed: $out"
+    exit 1
+  }
+done
+./build/nyx --vm --dump-bytecode "$tmpd/core.nx" 2>&1 | grep -q 'RANGE_INIT *range' || {
+  echo "FAIL: --dump-bytecode did not show RANGE_INIT"
+  exit 1
+}
+
+# Token text is a span of the source: literals and identifiers have no length cap.
+awk 'BEGIN { v = sprintf("%2000s", ""); gsub(/ /, "v", v); t = sprintf("%3000s", ""); gsub(/ /, "ab", t);
+  printf "let %s = \"%s\\n\";\nprint(len(%s));\n", v, t, v }' >"$tmpd/long.nx"
+out=$(./build/nyx "$tmpd/long.nx")
+[ "$out" = "6001" ] || {
+  echo "FAIL: long literal printed: $out"
+  exit 1
+}
+echo 'print(9223372036854775807); print(92233720368547758070);' >"$tmpd/intlit.nx"
+if ./build/nyx "$tmpd/intlit.nx" >"$tmpd/intlit.out" 2>&1 || ! grep -q 'invalid integer literal' "$tmpd/intlit.out"; then
+  echo "FAIL: out-of-range integer literal was not rejected"
+  exit 1
+fi
+
+# --lex-bench tokenizes without running the script.
+printf 'let  s = "a\\tb"; # comment\nif (s != null) { print(s); }\n' >"$tmpd/lexb.nx"
+./build/nyx --lex-bench "$tmpd/lexb.nx" 2>&1 | grep -q 'tokens=18 .*MB/s=' || {
+  echo "FAIL: --lex-bench did not report the token count"
+  exit 1
+}
+
+# --ast-stats reports arena usage of the parsed program.
+./build/nyx --ast-stats --parse-only "$tmpd/lexb.nx" 2>&1 | grep -q '^\[ast-stats\] lines=2 nodes=[1-9][0-9]* bytes=' || {
+  echo "FAIL: --ast-stats did not report the AST size"
+  exit 1
+}
+
+# -j parses the import graph up front; output and errors match a sequential run.
+mkdir -p "$tmpd/jobs/lib"
+printf 'import "lib/b.nx";\nimport "lib/c.nx";\nprint(b + c);\nif (false) { import "lib/missing.nx"; }\n' >"$tmpd/jobs/main.nx"
+printf 'import "c.nx";\nlet b = c * 2;\n' >"$tmpd/jobs/lib/b.nx"
+printf 'let c = 7;\n' >"$tmpd/jobs/lib/c.nx"
+printf 'import "lib/b.nx";\nimport "lib/bad.nx";\n' >"$tmpd/jobs/err.nx"
+printf 'let x = (;\n' >"$tmpd/jobs/lib/bad.nx"
+for j in 1 4; do
+  out="$(./build/nyx -j "$j" "$tmpd/jobs/main.nx" 2>&1)"
+  [ "$out" = "21" ] || { echo "FAIL: -j $j changed the output: $out"; exit 1; }
+  out="$(./build/nyx -j "$j" "$tmpd/jobs/err.nx" 2>&1 || true)"
+  [ "$out" = "Error at 1:10: unexpected token in expression" ] || { echo "FAIL: -j $j changed the parse error: $out"; exit 1; }
+done
+# Workers storing modules with identical text write the same .nyc image through separate temp files.
+printf 'let d = 1;\n' >"$tmpd/jobs/lib/d1.nx"
+cp "$tmpd/jobs/lib/d1.nx" "$tmpd/jobs/lib/d2.nx"
+printf 'import "lib/d1.nx";\nimport "lib/d2.nx";\nprint(d);\n' >"$tmpd/jobs/dup.nx"
+for pass in 1 2; do
+  out="$(./build/nyx -j 4 --cache-dir "$tmpd/jobs/cache" "$tmpd/jobs/dup.nx" 2>&1)"
+  [ "$out" = "1" ] || { echo "FAIL: -j with --cache-dir (pass $pass) printed: $out"; exit 1; }
+done
+if ls "$tmpd/jobs/cache" | grep -v '\.nyc$' | grep -q .; then
+  echo "FAIL: -j left temporary files in the cache directory"
+  ls "$tmpd/jobs/cache"
+  exit 1
+fi
+
+# The VM inlines small non-capturing callees; rebinding the callee falls back to a real call.
+cat >"$tmpd/inline.nx" <<'CYEOF'
+fn sq(x) {
+    let y = x * x;
+    return y;
+}
+fn twice(x) {
+    return x * 2;
+}
+fn sum_sq(n) {
+    let i = 0;
+    let acc = 0;
+    while (i < n) {
+        acc = acc + sq(i);
+        i = i + 1;
+    }
+    return acc;
+}
+print(sum_sq(10));
+sq = twice;
+print(sum_sq(10));
+CYEOF
+out=$(./build/nyx --vm "$tmpd/inline.nx" 2>&1 | tr '\n' ' ')
+if [ "$out" != "285 90 " ]; then
+  echo "FAIL: inlined call produced unexpected output"
+  echo "Got: $out"
+  exit 1
+fi
+./build/nyx --vm --dump-bytecode "$tmpd/inline.nx" 2>&1 | grep -q 'INLINE_ENTER *sq/1' || {
+  echo "FAIL: sq() was not inlined into sum_sq()"
+  exit 1
+}
+
+# Frame code must stay put while more functions get compiled under a running frame.
+{
+  i=0
+  while [ "$i" -lt 40 ]; do echo "fn f$i(x) { return x + $i; }"; i=$((i + 1)); done
+  echo "fn run() {"
+  echo "    let t = 0;"
+  i=0
+  while [ "$i" -lt 40 ]; do echo "    t = t + f$i(1);"; i=$((i + 1)); done
+  echo "    return t;"
+  echo "}"
+  echo "print(run());"
+} >"$tmpd/fn40.nx"
+out=$(./build/nyx --vm "$tmpd/fn40.nx" 2>&1)
+if [ "$out" != "820" ]; then
+  echo "FAIL: calls past the first 32 compiled functions returned: $out"
+  exit 1
+fi
+
 echo "[hardening] PASS"
@@ -231,6 +231,13 @@ if [ "$out_prog" != "$expected_prog" ]; then
   exit 1
 fi
 
+# -j parses the import graph on threads first; the generated C must not change.
+"$tmpd/compiler_stage1" "$tmpd/program.ny" "$tmpd/program_j.c" -j 4 >/dev/null
+if ! cmp -s "$tmpd/program.c" "$tmpd/program_j.c"; then
+  echo "FAIL: -j 4 changed the generated C"
+  exit 1
+fi
+
 # 3) Rebuild-and-compare deterministic loop.
 # stage1 binary compiles compiler source -> stage2.c (self mode)
 "$tmpd/compiler_stage1" compiler/v3_seed.ny "$tmpd/compiler_stage2.c" --emit-self >/dev/null
@@ -20,6 +20,7 @@ trap 'rm -rf "$tmpd"' EXIT
 
 RANDOM="$seed"
 ops=( '+' '-' '*' '==' '!=' '<' '>' '<=' '>=' )
+logic_ops=( '&&' '||' )
 
 rand_int() {
   echo $((RANDOM % 41 - 20))
@@ -34,7 +35,7 @@ gen_int_expr() {
     return
   fi
 
-  choice=$((RANDOM % 5))
+  choice=$((RANDOM % 6))
   case "$choice" in
     0)
       rand_int
@@ -45,6 +46,14 @@ gen_int_expr() {
     2)
       echo "($(gen_int_expr $((depth - 1))))"
       ;;
+    3)
+      # '??' must only evaluate its right side when the left side is null.
+      if [ $((RANDOM % 2)) -eq 0 ]; then
+        echo "(null ?? trap($(gen_int_expr $((depth - 1)))))"
+      else
+        echo "(($(gen_int_expr $((depth - 1)))) ?? trap($(gen_int_expr $((depth - 1)))))"
+      fi
+      ;;
     *)
       op="${ops[$((RANDOM % 3))]}" # + - *
       left="$(gen_int_expr $((depth - 1)))"
@@ -66,7 +75,7 @@ gen_bool_expr() {
     return
   fi
 
-  choice=$((RANDOM % 5))
+  choice=$((RANDOM % 6))
   case "$choice" in
     0)
       op="${ops[$((3 + RANDOM % 6))]}"
@@ -80,6 +89,13 @@ gen_bool_expr() {
     2)
       echo "($(gen_bool_expr $((depth - 1))))"
       ;;
+    3)
+      # Short-circuit operators: the traced right side must run only when needed.
+      op="${logic_ops[$((RANDOM % 2))]}"
+      left="$(gen_bool_expr $((depth - 1)))"
+      right="$(gen_bool_expr $((depth - 1)))"
+      echo "(($left) $op trap($right))"
+      ;;
     *)
       # Equality on bools is valid and VM-supported.
       op="${ops[$((3 + RANDOM % 2))]}" # == !=
@@ -104,16 +120,19 @@ for i in $(seq 1 "$cases"); do
   depth=$((RANDOM % 4 + 1))
   expr="$(gen_expr "$depth")"
   file="$tmpd/case_$i.ny"
-  printf '%s;\n' "$expr" > "$file"
+  {
+    printf 'fn trap(x) {\n    print("trap", x);\n    return x;\n}\n'
+    printf '%s;\n' "$expr"
+  } > "$file"
 
-  if ! out_ast=$(./nyx "$file" 2>&1); then
+  if ! out_ast=$(./build/nyx "$file" 2>&1); then
     echo "FAIL: AST run failed on case $i"
     echo "expr: $expr"
     printf '%s\n' "$out_ast"
     exit 1
   fi
 
-  if ! out_vm=$(./nyx --vm "$file" 2>&1); then
+  if ! out_vm=$(./build/nyx --vm "$file" 2>&1); then
     echo "FAIL: VM run failed on case $i"
     echo "expr: $expr"
     printf '%s\n' "$out_vm"
@@ -127,6 +146,15 @@ for i in $(seq 1 "$cases"); do
     echo "VM:  $out_vm"
     exit 1
   fi
+
+  # Literal-heavy cases exercise -O constant folding and strength reduction.
+  if ! out_opt=$(./build/nyx -O --vm "$file" 2>&1) || [ "$out_ast" != "$out_opt" ]; then
+    echo "FAIL: AST/-O mismatch on case $i"
+    echo "expr: $expr"
+    echo "AST: $out_ast"
+    echo "-O:  $out_opt"
+    exit 1
+  fi
 done
 
 echo "[vm-consistency] PASS"
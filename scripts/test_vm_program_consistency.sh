@@ -68,18 +68,42 @@ try {
     acc = acc + 1;
 }
 
+let maybe = null;
+if (maybe != null && maybe.v > $threshold) {
+    acc = acc + 1000;
+}
+if (maybe == null || maybe.v > $threshold) {
+    acc = acc + 1;
+}
+let fallback = maybe ?? mul($factor, 2);
+
 let b = new(Box, acc);
+print(fallback);
 print(mul(Math.inc(b.get()), $factor) + sum + len(arr));
+
+fn join(x, y) {
+    return x + y;
+}
+let joined = "";
+let j = 0;
+while (j < $n) {
+    j = j + 1;
+    if (j == $skip) {
+        joined = joined + join("s", "t");
+    }
+    print(join(j, acc));
+}
+print(joined);
 CYEOF
 
-  if ! out_ast=$(./nyx "$file" 2>&1); then
+  if ! out_ast=$(./build/nyx "$file" 2>&1); then
     echo "FAIL: AST run failed on case $i"
     cat "$file"
     printf '%s\n' "$out_ast"
     exit 1
   fi
 
-  if ! out_vm=$(./nyx --vm-strict "$file" 2>&1); then
+  if ! out_vm=$(./build/nyx --vm-strict "$file" 2>&1); then
     echo "FAIL: VM strict run failed on case $i"
     cat "$file"
     printf '%s\n' "$out_vm"